@@ -25,12 +25,14 @@
 #include <regex>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <utility>
 #include <vector>
 
 #include "utils/base64.h"
 #include "api/rpc_error.h"
+#include "api/response_cache.h"
 #include "api/interface/rpc_tx.h"
 #include <boost/math/constants/constants.hpp>
 #include <boost/multiprecision/cpp_bin_float.hpp>
@@ -71,8 +73,15 @@
 #include "transaction.pb.h"
 #include "utils/envelop.h"
 #include "ca/interface.h"
+#include "ca/block_json_writer.h"
+#include "utils/json_stream_writer.h"
 #include "rpc_create_transaction.h"
 
+static const size_t kMaxJsonRpcBatchSize = 100;
+static const uint32_t kJsonRpcConcurrency = 8;
+static const uint32_t kBlockQueryConcurrency = 8;
+static const uint32_t kBlockRangeConcurrency = 2;
+
 #define CHECK_PARSE_REQ\
     std::string PaseRet = req_t._paseFromJson(req.body);\
     if(PaseRet != "OK") {\
@@ -94,7 +103,7 @@
         }
 
 void _CaRegisterHttpCallbacks() {
-    HttpServer::RegisterCallback("/", _ApiJsonRpc);
+    HttpServer::RegisterCallback("/", _ApiJsonRpc, kJsonRpcConcurrency);
     HttpServer::RegisterCallback("/GetPublicIp", _GetRequesterIP);
     HttpServer::RegisterCallback("/GetTxInfo", _ApiGetTxInfo);    
     HttpServer::RegisterCallback("/GetDisinvestUtxo", _GetDisinvestUtxo);
@@ -126,13 +135,13 @@ void _CaRegisterHttpCallbacks() {
     HttpServer::RegisterCallback("/GetPeerList", _GetPeerList);
 
     HttpServer::RegisterCallback("/GetTransactionByHash", _ApiGetTransactionInfo);
-    HttpServer::RegisterCallback("/GetBlockByHash", _ApiGetBlockByHash);
-    HttpServer::RegisterCallback("/GetBlockByHeight", _ApiGetBlockByHeight);
+    HttpServer::RegisterCallback("/GetBlockByHash", _ApiGetBlockByHash, kBlockQueryConcurrency);
+    HttpServer::RegisterCallback("/GetBlockByHeight", _ApiGetBlockByHeight, kBlockRangeConcurrency);
     HttpServer::RegisterCallback("/GetDelegateInfo", _ApiGetDelegateInfoReq);
 
     #if DEVCHAIN || TESTCHAIN
     HttpServer::RegisterCallback("/block", _ApiPrintBlock);
-    HttpServer::RegisterCallback("/get_block", _ApiGetBlock);
+    HttpServer::RegisterCallback("/get_block", _ApiGetBlock, kBlockRangeConcurrency);
     HttpServer::RegisterCallback("/pub", _ApiPub);
 
     #endif
@@ -141,14 +150,20 @@ void _CaRegisterHttpCallbacks() {
 }
 
 
-void _ApiJsonRpc(const Request &req, Response &res) 
+static nlohmann::json _JsonRpcDispatch(const nlohmann::json &json)
 {
     nlohmann::json ret;
     ret["jsonrpc"] = "2.0";
     try {
-        auto json = nlohmann::json::parse(req.body);
+        if (!json.is_object() || !json.contains("method") || !json["method"].is_string())
+        {
+            ret["error"]["code"] = -32600;
+            ret["error"]["message"] = "Invalid Request";
+            ret["id"] = "";
+            return ret;
+        }
 
-        std::string method = json["method"];
+        const std::string &method = json["method"].get_ref<const std::string &>();
 
         auto p = HttpServer::rpcCbs.find(method);
         if (p == HttpServer::rpcCbs.end()) 
@@ -159,14 +174,13 @@ void _ApiJsonRpc(const Request &req, Response &res)
         } 
         else 
         {
-            auto params = json["params"];
-            ret = HttpServer::rpcCbs[method](params);
+            ret = p->second(json.contains("params") ? json["params"] : nlohmann::json());
             try {
-                ret["id"] = json["id"].get<int>();
+                ret["id"] = json.at("id").get<int>();
             } 
             catch (const std::exception &e) 
             {
-                ret["id"] = json["id"].get<std::string>();
+                ret["id"] = json.value("id", std::string());
             }
             ret["jsonrpc"] = "2.0";
         }
@@ -177,7 +191,128 @@ void _ApiJsonRpc(const Request &req, Response &res)
         ret["error"]["message"] = "Internal error";
         ret["id"] = "";
     }
-    res.set_content(ret.dump(4), "application/json");
+    return ret;
+}
+
+static void _WriteAckHead(JsonStreamWriter &writer, const std::string &id, const std::string &method, const std::string &jsonrpc)
+{
+    writer.BeginObject();
+    writer.Key("id").String(id);
+    writer.Key("jsonrpc").String(jsonrpc);
+    writer.Key("method").String(method);
+    writer.Key("result");
+}
+
+// If-None-Match is a comma separated list of entity tags, compared weakly as RFC 7232 requires
+static bool _IfNoneMatch(const std::string &header, const std::string &etag)
+{
+    auto opaque = [](std::string_view tag) {
+        if (tag.substr(0, 2) == "W/")
+        {
+            tag.remove_prefix(2);
+        }
+        return tag;
+    };
+    const std::string_view target = opaque(etag);
+
+    std::string_view rest = header;
+    while (!rest.empty())
+    {
+        auto comma = rest.find(',');
+        std::string_view item = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+
+        auto begin = item.find_first_not_of(" \t");
+        if (begin == std::string_view::npos)
+        {
+            continue;
+        }
+        item = item.substr(begin, item.find_last_not_of(" \t") - begin + 1);
+        if (item == "*" || opaque(item) == target)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void _SetAckResult(const Request &req, Response &res, const std::string &id, const std::string &method,
+                          const std::string &jsonrpc, const std::string &result, const std::string &etag)
+{
+    if (!etag.empty())
+    {
+        res.set_header("ETag", etag);
+        if (_IfNoneMatch(req.get_header_value("If-None-Match"), etag))
+        {
+            res.status = 304;
+            return;
+        }
+    }
+
+    JsonStreamWriter writer;
+    writer.Reserve(result.size() + 128);
+    _WriteAckHead(writer, id, method, jsonrpc);
+    writer.Raw(result);
+    writer.EndObject();
+    res.set_content(writer.Take(), "application/json");
+}
+
+static void _SetCacheableAckResult(const Request &req, Response &res, const std::string &id, const std::string &method,
+                                   const std::string &jsonrpc, const std::string &route, const std::string &hash,
+                                   const std::string &blockHash, uint64_t blockHeight, const std::string &result)
+{
+    auto entry = MagicSingleton<ApiResponseCache>::GetInstance()->Put(route, hash, blockHash, blockHeight, result);
+    _SetAckResult(req, res, id, method, jsonrpc, result, entry ? entry->etag : std::string());
+}
+
+static bool _SetCachedAckResult(const Request &req, Response &res, const std::string &id, const std::string &method,
+                                const std::string &jsonrpc, const std::string &route, const std::string &hash)
+{
+    auto entry = MagicSingleton<ApiResponseCache>::GetInstance()->Get(route, hash);
+    if (!entry)
+    {
+        return false;
+    }
+    _SetAckResult(req, res, id, method, jsonrpc, entry->result, entry->etag);
+    return true;
+}
+
+void _ApiJsonRpc(const Request &req, Response &res) 
+{
+    nlohmann::json ret;
+    try {
+        auto json = nlohmann::json::parse(req.body);
+        if (json.is_array())
+        {
+            if (json.empty() || json.size() > kMaxJsonRpcBatchSize)
+            {
+                ret["jsonrpc"] = "2.0";
+                ret["error"]["code"] = -32600;
+                ret["error"]["message"] = "Invalid Request";
+                ret["id"] = "";
+            }
+            else
+            {
+                ret = nlohmann::json::array();
+                for (const auto &call : json)
+                {
+                    ret.push_back(_JsonRpcDispatch(call));
+                }
+            }
+        }
+        else
+        {
+            ret = _JsonRpcDispatch(json);
+        }
+    } 
+    catch (const std::exception &e) 
+    {
+        ret["jsonrpc"] = "2.0";
+        ret["error"]["code"] = -32700;
+        ret["error"]["message"] = "Internal error";
+        ret["id"] = "";
+    }
+    res.set_content(ret.dump(), "application/json");
 }
 
 
@@ -191,6 +326,11 @@ void _ApiGetTxInfo(const Request &req, Response &res)
     ack_t.id = req_t.id;
     ack_t.jsonrpc = req_t.jsonrpc;
     ack_t.method = "getTxInfo";
+    if (_SetCachedAckResult(req, res, ack_t.id, ack_t.method, ack_t.jsonrpc, "/GetTxInfo", req_t.txhash))
+    {
+        return;
+    }
+
     DBReader dbReader;
     std::string BlockHash;
     std::string strHeader;
@@ -241,12 +381,16 @@ void _ApiGetTxInfo(const Request &req, Response &res)
         return;
     }
 
-    ack_t.code = 0;
-    ack_t.message = "success";
-    ack_t.tx = TxInvet(tx);
-    ack_t.blockhash = BlockHash;
-    ack_t.blockheight = BlockHeight;
-    res.set_content(ack_t._paseToString(), "application/json");
+    JsonStreamWriter result;
+    result.BeginObject();
+    result.Key("blockhash").String(BlockHash);
+    result.Key("blockheight").Uint(BlockHeight);
+    result.Key("code").Int(0);
+    result.Key("message").String("success");
+    result.Key("tx").String(TxInvet(tx));
+    result.EndObject();
+    _SetCacheableAckResult(req, res, ack_t.id, ack_t.method, ack_t.jsonrpc, "/GetTxInfo", req_t.txhash,
+                           BlockHash, BlockHeight, result.Buffer());
 }
 
 void _GetStake(const Request &req, Response &res) 
@@ -1101,9 +1245,15 @@ void _ApiGetTransactionInfo(const Request &req,Response &res)
     ack_t.jsonrpc = req_t.jsonrpc;
     ack_t.method = "GetTransactionByHash";
 
+    const std::string txHash = remove0xPrefix(req_t.txHash);
+    if (_SetCachedAckResult(req, res, ack_t.id, ack_t.method, ack_t.jsonrpc, "/GetTransactionByHash", txHash))
+    {
+        return;
+    }
+
     DBReader dbReader;
 	std::string strTx;
-	if (DBStatus::DB_SUCCESS != dbReader.GetTransactionByHash(remove0xPrefix(req_t.txHash), strTx))
+	if (DBStatus::DB_SUCCESS != dbReader.GetTransactionByHash(txHash, strTx))
 	{
         ack_t.code = -1;
         ack_t.message = "Tx hash error";
@@ -1120,11 +1270,24 @@ void _ApiGetTransactionInfo(const Request &req,Response &res)
 		return;
 	}
 
-    ack_t.code = 0;
-    ack_t.message = "success";
-    ack_t.tx = nlohmann::json::parse(TxInvet(tx));
-    
-    res.set_content(ack_t._paseToString(), "application/json");
+    JsonStreamWriter result;
+    result.BeginObject();
+    result.Key("code").Int(0);
+    result.Key("message").String("success");
+    result.Key("tx");
+    WriteTxJson(result, tx);
+    result.EndObject();
+
+    std::string blockHash;
+    unsigned int blockHeight = 0;
+    if (DBStatus::DB_SUCCESS != dbReader.GetBlockHashByTransactionHash(txHash, blockHash)
+        || DBStatus::DB_SUCCESS != dbReader.GetBlockHeightByBlockHash(blockHash, blockHeight))
+    {
+        _SetAckResult(req, res, ack_t.id, ack_t.method, ack_t.jsonrpc, result.Buffer(), "");
+        return;
+    }
+    _SetCacheableAckResult(req, res, ack_t.id, ack_t.method, ack_t.jsonrpc, "/GetTransactionByHash", txHash,
+                           blockHash, blockHeight, result.Buffer());
 }
 
 void _ApiGetBlockByHash(const Request &req,Response &res)
@@ -1137,9 +1300,15 @@ void _ApiGetBlockByHash(const Request &req,Response &res)
     ack_t.jsonrpc = req_t.jsonrpc;
     ack_t.method = "GetBlockByHash";
 
+    const std::string blockHash = remove0xPrefix(req_t.blockHash);
+    if (_SetCachedAckResult(req, res, ack_t.id, ack_t.method, ack_t.jsonrpc, "/GetBlockByHash", blockHash))
+    {
+        return;
+    }
+
     DBReader dbReader;
 	std::string strBlock;
-	if (DBStatus::DB_SUCCESS != dbReader.GetBlockByBlockHash(remove0xPrefix(req_t.blockHash), strBlock))
+	if (DBStatus::DB_SUCCESS != dbReader.GetBlockByBlockHash(blockHash, strBlock))
 	{
         ack_t.code = -1;
         ack_t.message = "Block hash error";
@@ -1147,13 +1316,24 @@ void _ApiGetBlockByHash(const Request &req,Response &res)
         return;
 	}
 
-    nlohmann::json block;
-    BlockInvert(strBlock, block);
+    CBlock block;
+    if (!block.ParseFromString(strBlock))
+    {
+        ack_t.code = -2;
+        ack_t.message = "Failed to parse block body";
+        res.set_content(ack_t._paseToString(), "application/json");
+        return;
+    }
 
-    ack_t.code = 0;
-    ack_t.message = "success";
-    ack_t.blockInfo = nlohmann::json::parse(block.dump());
-    res.set_content(ack_t._paseToString(), "application/json");
+    JsonStreamWriter result;
+    result.BeginObject();
+    result.Key("blockInfo");
+    WriteBlockJson(result, block);
+    result.Key("code").Int(0);
+    result.Key("message").String("success");
+    result.EndObject();
+    _SetCacheableAckResult(req, res, ack_t.id, ack_t.method, ack_t.jsonrpc, "/GetBlockByHash", blockHash,
+                           blockHash, block.height(), result.Buffer());
 }
 
 
@@ -1213,26 +1393,60 @@ void _ApiGetBlockByHeight(const Request &req,Response &res)
         return;
 	}
 
-    std::string strBlock;
-    for(const auto& t : blockHashes)
+    auto rawBlocks = std::make_shared<std::vector<std::string>>(blockHashes.size());
+    for(size_t i = 0; i < blockHashes.size(); ++i)
     {
-        if (DBStatus::DB_SUCCESS != dbReader.GetBlockByBlockHash(t, strBlock))
+        if (DBStatus::DB_SUCCESS != dbReader.GetBlockByBlockHash(blockHashes[i], rawBlocks->at(i)))
         {
             ack_t.code = -4;
-            ack_t.message = "Database abnormal, Get block by block hash error, block hash: " + t;
+            ack_t.message = "Database abnormal, Get block by block hash error, block hash: " + blockHashes[i];
             res.set_content(ack_t._paseToString(), "application/json");
-            ack_t.blocks.clear();
             return;
         }
-        
-        nlohmann::json block;
-        BlockInvert(strBlock, block);
-        ack_t.blocks.emplace_back(std::move(nlohmann::json::parse(block.dump())));
     }
 
-    ack_t.code = 0;
-    ack_t.message = "success";
-    res.set_content(ack_t._paseToString(), "application/json");
+    // Only the raw blocks are held, each one is rendered into its own chunk
+    auto writer = std::make_shared<JsonStreamWriter>();
+    _WriteAckHead(*writer, ack_t.id, ack_t.method, ack_t.jsonrpc);
+    writer->BeginObject();
+    writer->Key("blocks").BeginArray();
+    auto next = std::make_shared<size_t>(0);
+
+    res.set_header("Content-Type", "application/json");
+    res.set_chunked_content_provider([rawBlocks, writer, next](size_t offset, DataSink &sink)
+    {
+        bool finished = *next >= rawBlocks->size();
+        if (!finished)
+        {
+            std::string &strBlock = rawBlocks->at((*next)++);
+            CBlock block;
+            if (block.ParseFromString(strBlock))
+            {
+                WriteBlockJson(*writer, block);
+            }
+            else
+            {
+                ERRORLOG("block_raw parse fail!");
+                writer->Null();
+            }
+            std::string().swap(strBlock);
+        }
+        else
+        {
+            writer->EndArray();
+            writer->Key("code").Int(0);
+            writer->Key("message").String("success");
+            writer->EndObject().EndObject();
+        }
+
+        std::string chunk = writer->Take();
+        sink.write(chunk.data(), chunk.size());
+        if (finished)
+        {
+            sink.done();
+        }
+        return true;
+    });
 }
 
 void _ApiSendMessage(const Request &req, Response &res) 
@@ -1456,8 +1670,8 @@ void ApiInfo(const Request &req, Response &res)
 }
 
 void _ApiGetBlock(const Request &req, Response &res) {
-    nlohmann::json block;
-    nlohmann::json blocks;
+    JsonStreamWriter writer;
+    writer.BeginArray();
 
     int top = 0;
     if (req.has_param("top")) {
@@ -1482,7 +1696,6 @@ void _ApiGetBlock(const Request &req, Response &res) {
         ERRORLOG("_ApiGetBlock begin > myTop");
         return;
     }
-    int k = 0;
     uint64_t countNum = top + num;
     if (countNum > myTop) {
         countNum = myTop;
@@ -1504,12 +1717,18 @@ void _ApiGetBlock(const Request &req, Response &res) {
             {
                 return;
             }
-            BlockInvert(strHeader, block);
-            blocks[k++] = block;
+            CBlock block;
+            if (!block.ParseFromString(strHeader))
+            {
+                ERRORLOG("block_raw parse fail!");
+                writer.Null();
+                continue;
+            }
+            WriteBlockJson(writer, block);
         }
     }
-    std::string str = blocks.dump();
-    res.set_content(str, "application/json");
+    writer.EndArray();
+    res.set_content(writer.Take(), "application/json");
 }
 
 void _ApiPub(const Request &req, Response &res) 
@@ -1544,7 +1763,7 @@ void _ApiPub(const Request &req, Response &res)
     double total = .0f;
     uint64_t n64Count = 0;
     oss << "------------------------------------------" << std::endl;
-    for (auto &item : global::g_reqCntMap) {
+    for (auto &item : MagicSingleton<ProtobufDispatcher>::GetInstance()->GetReqCount()) {
         total += (double)item.second.second; // data size
         oss.precision(3);                    // Keep 3 decimal places
         // Type of data		        Number of calls convert MB
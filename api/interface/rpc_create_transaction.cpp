@@ -279,7 +279,9 @@ void ReplaceCreateTxTransaction(const std::vector<std::string>& fromAddr,
 		outTx.set_identity(id);
 
 	}
+	// Same hash as TxHelper::CreateTxTransaction records, the returned tx itself is left without one
 	_usings.time = outTx.time();
+	_usings.txHash = Getsha256hash(outTx.SerializeAsString());
 	if(MagicSingleton<DoubleSpendCache>::GetInstance()->AddFromAddr(std::make_pair(*fromAddr.rbegin(),_usings)) != 0)
 	{
 		ackT->message = "utxo is using!";
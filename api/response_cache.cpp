@@ -0,0 +1,125 @@
+#include "api/response_cache.h"
+
+#include "db/db_api.h"
+#include "include/logging.h"
+
+
+std::shared_ptr<const ApiResponseCache::Entry> ApiResponseCache::Get(const std::string &route, const std::string &hash)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _entries.find(_Key(route, hash));
+    if (found == _entries.end())
+    {
+        return nullptr;
+    }
+    _lru.splice(_lru.begin(), _lru, found->second);
+    return found->second->second;
+}
+
+std::shared_ptr<const ApiResponseCache::Entry> ApiResponseCache::Put(const std::string &route, const std::string &hash, const std::string &blockHash,
+                                                                     uint64_t blockHeight, const std::string &result)
+{
+    DBReader dbReader;
+    uint64_t top = 0;
+    if (DBStatus::DB_SUCCESS != dbReader.GetBlockTop(top) || blockHeight + kStableDepth > top)
+    {
+        return nullptr;
+    }
+
+    auto entry = std::make_shared<Entry>();
+    entry->result = result;
+    // The containing block is part of the tag, so a rollback that moves the object to another block changes it
+    entry->etag = "W/\"" + route.substr(route.find_last_of('/') + 1) + "-" + hash;
+    if (blockHash != hash)
+    {
+        entry->etag += "-" + blockHash;
+    }
+    entry->etag += "\"";
+    entry->blockHash = blockHash;
+
+    std::string key = _Key(route, hash);
+    uint64_t cost = _Cost(key, *entry);
+    if (cost > kMaxBytes)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _entries.find(key);
+    if (found != _entries.end())
+    {
+        _Erase(found->second);
+    }
+    while (!_lru.empty() && _bytes + cost > kMaxBytes)
+    {
+        _Erase(std::prev(_lru.end()));
+    }
+
+    _lru.emplace_front(key, entry);
+    _entries[key] = _lru.begin();
+    _blockKeys[blockHash].insert(key);
+    _bytes += cost;
+    return entry;
+}
+
+void ApiResponseCache::InvalidateBlock(const std::string &blockHash)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _blockKeys.find(blockHash);
+    if (found == _blockKeys.end())
+    {
+        return;
+    }
+
+    std::unordered_set<std::string> keys = std::move(found->second);
+    for (const auto &key : keys)
+    {
+        auto entry = _entries.find(key);
+        if (entry != _entries.end())
+        {
+            _Erase(entry->second);
+        }
+    }
+    _blockKeys.erase(blockHash);
+    DEBUGLOG("invalidate {} cached api responses of block {}", keys.size(), blockHash.substr(0, 6));
+}
+
+void ApiResponseCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _lru.clear();
+    _entries.clear();
+    _blockKeys.clear();
+    _bytes = 0;
+}
+
+uint64_t ApiResponseCache::GetSize()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+uint64_t ApiResponseCache::GetBytes()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _bytes;
+}
+
+void ApiResponseCache::_Erase(LruList::iterator it)
+{
+    const std::string &key = it->first;
+    const auto &entry = it->second;
+    _bytes -= _Cost(key, *entry);
+
+    auto blockKeys = _blockKeys.find(entry->blockHash);
+    if (blockKeys != _blockKeys.end())
+    {
+        blockKeys->second.erase(key);
+        if (blockKeys->second.empty())
+        {
+            _blockKeys.erase(blockKeys);
+        }
+    }
+    _entries.erase(key);
+    _lru.erase(it);
+}
@@ -0,0 +1,89 @@
+/**
+ * *****************************************************************************
+ * @file        response_cache.h
+ * @brief       Cache of rendered api results for blocks and transactions that
+ *              are deep enough in the chain to no longer change
+ * @date        2024-06-14
+ * @copyright   tfsc
+ * *****************************************************************************
+ */
+#ifndef _RESPONSE_CACHE_H_
+#define _RESPONSE_CACHE_H_
+
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+class ApiResponseCache
+{
+public:
+    struct Entry
+    {
+        std::string result;     // rendered "result" object of the api ack
+        std::string etag;
+        std::string blockHash;  // block the cached object belongs to, used for rollback invalidation
+    };
+
+    ApiResponseCache() = default;
+    ~ApiResponseCache() = default;
+    ApiResponseCache(ApiResponseCache &&) = delete;
+    ApiResponseCache(const ApiResponseCache &) = delete;
+    ApiResponseCache &operator=(ApiResponseCache &&) = delete;
+    ApiResponseCache &operator=(const ApiResponseCache &) = delete;
+
+    /**
+     * @brief
+     *
+     * @param       route:
+     * @param       hash: block or transaction hash without 0x prefix
+     * @return      nullptr when not cached
+     */
+    std::shared_ptr<const Entry> Get(const std::string &route, const std::string &hash);
+
+    /**
+     * @brief       Cache a rendered result, ignored unless blockHeight is below the stable depth
+     *
+     * @param       route:
+     * @param       hash:
+     * @param       blockHash:
+     * @param       blockHeight:
+     * @param       result:
+     * @return      the cached entry, or nullptr if it was not cached
+     */
+    std::shared_ptr<const Entry> Put(const std::string &route, const std::string &hash, const std::string &blockHash,
+                                     uint64_t blockHeight, const std::string &result);
+
+    /**
+     * @brief       Drop the block and every transaction cached from it
+     *
+     * @param       blockHash:
+     */
+    void InvalidateBlock(const std::string &blockHash);
+
+    void Clear();
+
+    uint64_t GetSize();
+    uint64_t GetBytes();
+
+    static const uint64_t kMaxBytes = 64 * 1024 * 1024;
+    static const uint64_t kStableDepth = 10;
+
+private:
+    using LruList = std::list<std::pair<std::string, std::shared_ptr<const Entry>>>;
+
+    static std::string _Key(const std::string &route, const std::string &hash) { return route + '/' + hash; }
+    static uint64_t _Cost(const std::string &key, const Entry &entry) { return key.size() + entry.result.size() + entry.etag.size() + entry.blockHash.size(); }
+    void _Erase(LruList::iterator it);
+
+    std::mutex _mutex;
+    LruList _lru;
+    std::unordered_map<std::string, LruList::iterator> _entries;
+    std::unordered_map<std::string, std::unordered_set<std::string>> _blockKeys;
+    uint64_t _bytes = 0;
+};
+
+#endif
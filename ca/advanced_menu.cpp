@@ -5,6 +5,7 @@
 #include <thread>
 #include <ostream>
 #include <fstream>
+#include <functional>
 
 #include "ca/ca.h"
 #include "ca/test.h"
@@ -19,6 +20,7 @@
 #include "ca/block_monitor.h"
 
 #include "net/api.h"
+#include "net/dispatcher.h"
 #include "net/peer_node.h"
 
 #include "include/scope_guard.h"
@@ -34,8 +36,11 @@
 #include "utils/base64.h"
 
 #include "db/db_api.h"
+#include "db/cache.h"
 #include "ca/evm/evm_manager.h"
 #include "openssl/rand.h"
+#include <evmc/mocked_host.hpp>
+#include <evmone/evmone.h>
 
 struct contractJob{
     std::string fromAddr;
@@ -412,7 +417,7 @@ void PrintReqAndAck()
 {
     double total = .0f;
     std::cout << "------------------------------------------" << std::endl;
-    for (auto &item : global::g_reqCntMap)
+    for (auto &item : MagicSingleton<ProtobufDispatcher>::GetInstance()->GetReqCount())
     {
         total += (double)item.second.second;
         std::cout.precision(3);
@@ -1921,10 +1926,7 @@ void PrintVerifyNode()
     std::vector<Node> resultNode;
     for (const auto &node : nodelist)
     {
-        int ret = VerifyBonusAddr(node.address);
-
-        int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-        if (stakeTime > 0 && ret == 0)
+        if (MagicSingleton<QualifiedNodeCache>::GetInstance()->IsQualified(node.address))
         {
             resultNode.push_back(node);
         }
@@ -2366,3 +2368,62 @@ void TestSign()
     }
 }
 
+void TestEvmExecuteBenchmark()
+{
+    int rounds = 0;
+    std::cout << "Please input the number of rounds:" << std::endl;
+    std::cin >> rounds;
+    if (rounds <= 0)
+    {
+        std::cout << "input invalid" << std::endl;
+        return;
+    }
+
+    // Runtime code counts to 64 in a loop, padded with data to the size of a typical contract
+    evmc::bytes runtimeCode = evmc::from_hex("60005b600101806040116002570000").value();
+    runtimeCode.resize(8 * 1024, 0x5b);
+    // Init code: CODECOPY the runtime code appended after it into memory and RETURN it
+    evmc::bytes initCode = {0x61, (uint8_t)(runtimeCode.size() >> 8), (uint8_t)runtimeCode.size(),
+                            0x80, 0x60, 0x0c, 0x60, 0x00, 0x39, 0x60, 0x00, 0xf3};
+    initCode += runtimeCode;
+
+    evmc_message deployMsg{};
+    deployMsg.kind = EVMC_CREATE;
+    deployMsg.gas = 10000000;
+    evmc_message callMsg{};
+    callMsg.kind = EVMC_CALL;
+    callMsg.gas = 10000000;
+
+    evmc::MockedHost host;
+    auto run = [&](const std::string &name, const std::function<evmc::Result(const evmc_message &, const evmc::bytes &)> &execute)
+    {
+        uint64_t start = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
+        for (int i = 0; i < rounds; ++i)
+        {
+            auto deployResult = execute(deployMsg, initCode);
+            auto callResult = execute(callMsg, runtimeCode);
+            if (deployResult.status_code != EVMC_SUCCESS || callResult.status_code != EVMC_SUCCESS)
+            {
+                std::cout << name << " execution failed, deploy: " << deployResult.status_code << ", call: " << callResult.status_code << std::endl;
+                return;
+            }
+        }
+        uint64_t elapsed = std::max<uint64_t>(MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp() - start, 1);
+        std::cout << name << ": " << rounds << " deploy+call in " << elapsed / 1000 << " ms, "
+                  << (double)rounds * 1000000 / elapsed << " per second" << std::endl;
+    };
+
+    run("fresh vm", [&host](const evmc_message &msg, const evmc::bytes &code)
+    {
+        evmc::VM vm{evmc_create_evmone()};
+        if (!vm.is_abi_compatible())
+        {
+            return evmc::Result{EVMC_INTERNAL_ERROR, 0, 0};
+        }
+        return vm.execute(host, EVMC_MAX_REVISION, msg, code.data(), code.size());
+    });
+    run("pooled vm", [&host](const evmc_message &msg, const evmc::bytes &code)
+    {
+        return Evmone::ExecuteCode(host, EVMC_MAX_REVISION, msg, code);
+    });
+}
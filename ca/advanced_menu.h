@@ -195,6 +195,12 @@ void OpenLog();
 void CloseLog();
 
 void TestSign();
+
+/**
+ * @brief       Compare deploy and call throughput of a fresh evmone instance per
+ *              execution against the pooled instance and cached code analysis
+ */
+void TestEvmExecuteBenchmark();
 namespace ThreadTest
 {
     /**
@@ -7,6 +7,7 @@
 #include "ca/block_http_callback.h"
 #include "ca/transaction_cache.h"
 #include "ca/double_spend_cache.h"
+#include "ca/failed_transaction_cache.h"
 #include "ca/sync_block.h"
 
 #include "common.pb.h"
@@ -19,11 +20,16 @@
 #include "utils/contract_utils.h"
 
 #include "db/db_api.h"
+#include "api/response_cache.h"
 #include "net/interface.h"
 #include "include/scope_guard.h"
 #include "ca/evm/evm_manager.h"
+#include "db/cache.h"
 
 static global::ca::SaveType g_syncType = global::ca::SaveType::Unknow;
+// Set while a block is written into a sync group. A failure there is not acted on, the block
+// is retried on its own after the group commits and that attempt reacts if it fails again
+static thread_local bool g_inSyncGroup = false;
 
 BlockHelper::BlockHelper() : _missingPrehash(false){}
 
@@ -65,18 +71,14 @@ int SendBlockByUtxoReq(const std::string &utxo)
             return -2;
         }
 
-        std::vector<Node> nodelist = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-
-        for (const auto &node : nodelist)
+        auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+        std::vector<std::string> nodeAddrs;
+        nodeAddrs.reserve(peerTable->byAddress.size());
+        for (const auto &[addr, node] : peerTable->byAddress)
         {
-            int ret = VerifyBonusAddr(node.address);
-
-            int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-            if (stakeTime > 0 && ret == 0)
-            {
-                pledgeAddr.push_back(node.address);
-            }
+            nodeAddrs.push_back(addr);
         }
+        MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, pledgeAddr);
     }
     
     if (GetUtxoFindNode(global::ca::KMinSyncQualNodes, chainHeight, pledgeAddr, sendNodeIds) != 0)
@@ -255,18 +257,14 @@ int SendBlockByHashReq(const std::map<std::string, bool> &missingHashs)
         {
             return -2;
         }
-        std::vector<Node> nodelist = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-        
-        for (const auto &node : nodelist)
+        auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+        std::vector<std::string> nodeAddrs;
+        nodeAddrs.reserve(peerTable->byAddress.size());
+        for (const auto &[addr, node] : peerTable->byAddress)
         {
-            int ret = VerifyBonusAddr(node.address);
-
-            int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-            if (stakeTime > 0 && ret == 0)
-            {
-                pledgeAddr.push_back(node.address);
-            }
+            nodeAddrs.push_back(addr);
         }
+        MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, pledgeAddr);
     }
     
     if (GetUtxoFindNode(global::ca::KMinSyncQualNodes, chainHeight, pledgeAddr, sendNodeIds) != 0)
@@ -375,18 +373,14 @@ int SeekBlockByContractPreHashReq(const std::string &seekBlockHash, std::string&
             return -2;
         }
 
-        std::vector<Node> nodelist = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-
-        for (const auto &node : nodelist)
+        auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+        std::vector<std::string> nodeAddrs;
+        nodeAddrs.reserve(peerTable->byAddress.size());
+        for (const auto &[addr, node] : peerTable->byAddress)
         {
-            int ret = VerifyBonusAddr(node.address);
-
-            int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-            if (stakeTime > 0 && ret == 0)
-            {
-                pledgeAddr.push_back(node.address);
-            }
+            nodeAddrs.push_back(addr);
         }
+        MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, pledgeAddr);
     }
     
     if (GetUtxoFindNode(global::ca::KMinSyncQualNodes, chainHeight, pledgeAddr, sendNodeIds) != 0)
@@ -590,9 +584,26 @@ int BlockHelper::SaveBlock(const CBlock& block, global::ca::SaveType saveType, g
         }
     };
 
+    int ret = WriteBlock(*dbWriterPtr, block, saveType, obtainMean);
+    if (ret != 0)
+    {
+        // > 0 means it was saved before
+        return ret > 0 ? 0 : ret;
+    }
+    if(DBStatus::DB_SUCCESS != dbWriterPtr->TransactionCommit())
+    {     
+        ERRORLOG("Transaction commit fail");
+        return -9;   
+    }
+    PostCommitProcess(block);
+
+    return 0;
+}
 
+int BlockHelper::WriteBlock(DBReadWriter& dbWriter, const CBlock& block, global::ca::SaveType saveType, global::ca::BlockObtainMean obtainMean)
+{
     uint64_t nodeHeight = 0;
-    if (DBStatus::DB_SUCCESS != dbWriterPtr->GetBlockTop(nodeHeight))
+    if (DBStatus::DB_SUCCESS != dbWriter.GetBlockTop(nodeHeight))
     {
          ERRORLOG("GetBlockTop error!");
         return -3;
@@ -607,11 +618,11 @@ int BlockHelper::SaveBlock(const CBlock& block, global::ca::SaveType saveType, g
     int ret = 0;
     std::string blockRaw;
     std::string blockHash = block.hash();
-    ret = dbWriterPtr->GetBlockByBlockHash(block.hash(), blockRaw);
+    ret = dbWriter.GetBlockByBlockHash(block.hash(), blockRaw);
     if (DBStatus::DB_SUCCESS == ret)
     {
         INFOLOG("BlockHelper block {} already in saved , skip",block.hash().substr(0, 6));
-        return 0;
+        return 1;
     }
 
     ret = PreSaveProcess(block, saveType, obtainMean);
@@ -624,10 +635,14 @@ int BlockHelper::SaveBlock(const CBlock& block, global::ca::SaveType saveType, g
     
     ResetMissingPrehash();
     uint64_t blockHeight = block.height();
-    ret = ca_algorithm::SaveBlock(*dbWriterPtr, block, saveType, obtainMean);
+    ret = ca_algorithm::SaveBlock(dbWriter, block, saveType, obtainMean);
     if (0 != ret)
     {
         ERRORLOG("save block ret:{}:{}:{}", ret, blockHeight, blockHash);
+        if (g_inSyncGroup)
+        {
+            return -8;
+        }
         if(saveType == global::ca::SaveType::SyncNormal || saveType == global::ca::SaveType::SyncFromZero)
         {
             DEBUGLOG("run new sync, start height: {}", blockHeight);
@@ -647,22 +662,149 @@ int BlockHelper::SaveBlock(const CBlock& block, global::ca::SaveType saveType, g
         }
         return -8;
     }
-    if(DBStatus::DB_SUCCESS != dbWriterPtr->TransactionCommit())
-    {     
-        ERRORLOG("Transaction commit fail");
-        return -9;   
-    }
+    return 0;
+}
+
+void BlockHelper::PostCommitProcess(const CBlock& block)
+{
     //TODO::
     MagicSingleton<DoubleSpendCache>::GetInstance()->Detection(block);
 
-    INFOLOG("save block ret:{}:{}:{}", ret, blockHeight, blockHash);
+    INFOLOG("save block ret:{}:{}:{}", 0, block.height(), block.hash());
     auto startTime = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
     PostSaveProcess(block);
     auto endTime = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp(); 
     postCommitCost += (endTime - startTime);
     postCommitCount++;
+}
 
-    return 0;
+int BlockHelper::SaveSyncBlocks(uint64_t chainHeight)
+{
+    std::unique_ptr<DBReadWriter> groupWriter;
+    std::unique_ptr<DBReadThrough> readThrough;
+    std::vector<const CBlock*> grouped;
+    auto groupStart = std::chrono::steady_clock::now();
+    // Nothing of a group reaches the database or the caches before its commit, so a crash
+    // part way through leaves the node at the previous commit and sync fetches the rest again
+    auto commitGroup = [&]() -> int {
+        if (!groupWriter)
+        {
+            return 0;
+        }
+        readThrough.reset();
+        auto status = grouped.empty() ? DBStatus::DB_SUCCESS : groupWriter->TransactionCommit();
+        groupWriter.reset();
+        if (DBStatus::DB_SUCCESS != status)
+        {
+            ERRORLOG("Transaction commit fail, {} blocks from height {}", grouped.size(), grouped.front()->height());
+            grouped.clear();
+            return -9;
+        }
+        DEBUGLOG("group commit {} blocks, heights {} - {}", grouped.size(), grouped.front()->height(), grouped.back()->height());
+        for (auto block : grouped)
+        {
+            PostCommitProcess(*block);
+        }
+        grouped.clear();
+        return 0;
+    };
+
+    for(const auto& block : _syncBlocks)
+    {
+        if(!_stopBlocking)
+        {
+            return commitGroup();
+        }
+
+        DEBUGLOG("chain height: {}, height: {}, sync type: {}", chainHeight, block.height(), g_syncType);
+        DEBUGLOG("_syncBlocks SaveBlock Hash: {}, height: {}, PreHash:{}", block.hash().substr(0, 6), block.height(), block.prevhash().substr(0, 6));
+        // Near the tip every block is committed on its own
+        if (block.height() + _kGroupCommitDistance > chainHeight)
+        {
+            int ret = commitGroup();
+            if (ret != 0)
+            {
+                return ret;
+            }
+            ret = SaveBlock(block, g_syncType, global::ca::BlockObtainMean::Normal);
+            if (ret != 0)
+            {
+                return ret;
+            }
+            continue;
+        }
+
+        if (!groupWriter)
+        {
+            groupWriter = std::make_unique<DBReadWriter>();
+            readThrough = std::make_unique<DBReadThrough>(*groupWriter);
+            groupStart = std::chrono::steady_clock::now();
+        }
+        if (DBStatus::DB_SUCCESS != groupWriter->SetSavePoint())
+        {
+            commitGroup();
+            return -10;
+        }
+        bool missingPrehash = _missingPrehash;
+        std::stack<std::string> missingUtxos;
+        {
+            std::lock_guard<std::mutex> lock(_missingUtxosMutex);
+            missingUtxos = _missingUtxos;
+        }
+        int ret = 0;
+        {
+            g_inSyncGroup = true;
+            ON_SCOPE_EXIT{
+                g_inSyncGroup = false;
+            };
+            ret = WriteBlock(*groupWriter, block, g_syncType, global::ca::BlockObtainMean::Normal);
+        }
+        if (ret < 0)
+        {
+            // What the failed attempt found missing is left for the retry to find again
+            _missingPrehash = missingPrehash;
+            {
+                std::lock_guard<std::mutex> lock(_missingUtxosMutex);
+                _missingUtxos = std::move(missingUtxos);
+            }
+
+            // Keep the blocks before it, then give it one more try on its own in case
+            // something in its verification did not read through the group
+            if (DBStatus::DB_SUCCESS != groupWriter->RollbackToSavePoint())
+            {
+                readThrough.reset();
+                groupWriter.reset();
+                grouped.clear();
+                return ret;
+            }
+            int commitRet = commitGroup();
+            if (commitRet != 0)
+            {
+                return commitRet;
+            }
+            ret = SaveBlock(block, g_syncType, global::ca::BlockObtainMean::Normal);
+            if (ret != 0)
+            {
+                return ret;
+            }
+            continue;
+        }
+        if (ret == 0)
+        {
+            grouped.push_back(&block);
+        }
+        if (grouped.size() >= _kGroupCommitSize
+            || groupWriter->GetLockedKeyCount() >= _kGroupCommitMaxLockedKeys
+            || std::chrono::steady_clock::now() - groupStart >= std::chrono::milliseconds(_kGroupCommitMaxMs))
+        {
+            ret = commitGroup();
+            if (ret != 0)
+            {
+                return ret;
+            }
+        }
+    }
+    return commitGroup();
 }
 
 bool BlockHelper::VerifyHeight(const CBlock& block, uint64_t ownblockHeight)
@@ -740,6 +882,10 @@ void BlockHelper::PostMembershipCancellationProcess(const CBlock &block)
                             {
                                 ERRORLOG("rollback hash {} fail, ret: ", heightBlock.hash(), ret);
                             }
+                            else
+                            {
+                                MagicSingleton<ApiResponseCache>::GetInstance()->InvalidateBlock(heightBlock.hash());
+                            }
                         }                    
                     }
                 }
@@ -820,6 +966,7 @@ std::pair<doubleSpendType, CBlock> BlockHelper::DealDoubleSpend(const CBlock& bl
                                         ERRORLOG("PBlock rollback hash {} fail, ret:{}", PBlock.hash(), ret);
                                         return {doubleSpendType::err,{}};
                                     }
+                                    MagicSingleton<ApiResponseCache>::GetInstance()->InvalidateBlock(PBlock.hash());
                                     CheckDoubleBlooming({doubleSpendType::oldDoubleSpend, std::move(PBlock)}, block);
                                     return {doubleSpendType::oldDoubleSpend,std::move(PBlock)};
                                 }
@@ -847,6 +994,10 @@ int BlockHelper::PreSaveProcess(const CBlock& block, global::ca::SaveType saveTy
         if (0 != ret)
         {
             ERRORLOG("verify block ret:{}:{}:{}", ret, blockHeight, blockHash);
+            if (g_inSyncGroup)
+            {
+                return -3;
+            }
             if (_missingPrehash)
             {
                 ResetMissingPrehash();
@@ -961,6 +1112,7 @@ void BlockHelper::PostSaveProcess(const CBlock &block)
 {
     MagicSingleton<TFSbenchmark>::GetInstance()->AddBlockPoolSaveMapEnd(block.hash());
     MagicSingleton<TaskPool>::GetInstance()->CommitCaTask(std::bind(&BlockHelper::PostTransactionProcess, this, block));
+    MagicSingleton<FailedTransactionCache>::GetInstance()->BlockSaved(block);
 
     auto found = _pendingBlocks.find(block.height() + 1);
     if (found != _pendingBlocks.end())
@@ -1121,6 +1273,7 @@ int BlockHelper::RollbackBlocks()
                 ERRORLOG("rollback hash {} fail, ret: ", sit->hash(), ret);
                 return -1;
             }
+            MagicSingleton<ApiResponseCache>::GetInstance()->InvalidateBlock(sit->hash());
             
         }
     }
@@ -1353,20 +1506,10 @@ void BlockHelper::Process()
     }
     _utxoMissingBlocks.clear();
 
-    for(const auto& block : _syncBlocks)
+    result = SaveSyncBlocks(chainHeight);
+    if(!_stopBlocking)
     {
-        if(!_stopBlocking)
-        {
-            return;
-        }
-
-        DEBUGLOG("chain height: {}, height: {}, sync type: {}", chainHeight, block.height(), g_syncType);
-        DEBUGLOG("_syncBlocks SaveBlock Hash: {}, height: {}, PreHash:{}", block.hash().substr(0, 6), block.height(), block.prevhash().substr(0, 6));
-        result = SaveBlock(block, g_syncType, global::ca::BlockObtainMean::Normal);
-        if(result != 0)
-        {
-            break;
-        }
+        return;
     }
 
     for(const auto& block : _broadcastBlocks)
@@ -1535,28 +1678,14 @@ void BlockHelper::MakeTxStatusMsg(const CBlock &oldBlock, const CBlock &newBlock
 {
     DEBUGLOG("AAAC MakeTxStatusMsg oldBlock:{}, newBlock:{}", oldBlock.hash().substr(0,6), newBlock.hash().substr(0,6));
     BlockStatus blockStatus;
-    for(const auto& tx1 : oldBlock.txs())
+    for(const auto& [i, j] : Checker::FindConflicts(oldBlock, newBlock))
     {
-        if(GetTransactionType(tx1) != kTransactionType_Tx)
-        {
-            continue;
-        }
-
-        for(const auto& tx2 : newBlock.txs())
-        {
-            if(GetTransactionType(tx2) != kTransactionType_Tx)
-            {
-                continue;
-            }
-
-            if(Checker::CheckConflict(tx1, tx2) == true)
-            {
-                DEBUGLOG("AAAC MakeTxStatusMsg oldBlocktx1:{}, newBlocktx2:{}", tx1.hash().substr(0,10), tx2.hash().substr(0,10));
-                auto txStatus = blockStatus.add_txstatus();
-                txStatus->set_txhash(tx2.hash());
-                txStatus->set_status(global::ca::DoubleSpend::DoubleBlock);
-            }
-        }
+        const auto& tx1 = oldBlock.txs(i);
+        const auto& tx2 = newBlock.txs(j);
+        DEBUGLOG("AAAC MakeTxStatusMsg oldBlocktx1:{}, newBlocktx2:{}", tx1.hash().substr(0,10), tx2.hash().substr(0,10));
+        auto txStatus = blockStatus.add_txstatus();
+        txStatus->set_txhash(tx2.hash());
+        txStatus->set_status(global::ca::DoubleSpend::DoubleBlock);
     }
 
     std::string defaultAddr = MagicSingleton<AccountManager>::GetInstance()->GetDefaultAddr();
@@ -1729,6 +1858,7 @@ int BlockHelper::checkContractBlock(const CBlock& block, std::string& contractTx
                         ERRORLOG("contractBlock rollback hash {} fail, ret:{}", DBBlockHash, ret);
                         return -4;
                     }
+                    MagicSingleton<ApiResponseCache>::GetInstance()->InvalidateBlock(DBBlockHash);
                     continue;
                 }
                 else if(preHashStatus == ContractPreHashStatus::Waiting)
@@ -1971,46 +2101,43 @@ bool BlockHelper::ObtainChainHeight(uint64_t& chainHeight)
         return false;
     }
 
-    std::vector<Node> nodes = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
+    auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
     // uint64_t nodeAmount = nodes.size();
-    if (nodes.empty())
+    if (peerTable->byAddress.empty())
     {
         DEBUGLOG("nodes.empty() == true, chainHeight:{}", chainHeight);
         chainHeight = top;
         return true;
     }
 
-    std::vector<Node> qualifyingNode;
-
+    std::vector<uint64_t> nodeHeights;
     if(top < global::ca::kMinUnstakeHeight)
     {
-        qualifyingNode = nodes;
+        for (const auto &[addr, node] : peerTable->byAddress)
+        {
+            nodeHeights.push_back(node->height);
+        }
     }
     else
     {
-        for (const auto &node : nodes)
+        std::vector<std::string> nodeAddrs;
+        nodeAddrs.reserve(peerTable->byAddress.size());
+        for (const auto &[addr, node] : peerTable->byAddress)
         {
-            int ret = VerifyBonusAddr(node.address);
-
-            int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-            if (stakeTime > 0 && ret == 0)
-            {
-                qualifyingNode.push_back(node);
-            }
+            nodeAddrs.push_back(addr);
         }
-        if(qualifyingNode.empty())
+        std::vector<std::string> qualifiedAddrs;
+        MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, qualifiedAddrs);
+        for (const auto &addr : qualifiedAddrs)
         {
-            DEBUGLOG("qualifyingNode.empty() == true, chainHeight:{}", chainHeight);
-            chainHeight = top;
-            return true;
+            nodeHeights.push_back(peerTable->byAddress.at(addr)->height);
         }
     }
-
-
-    std::vector<uint64_t> nodeHeights;
-    for (auto &node : qualifyingNode)
+    if(nodeHeights.empty())
     {
-        nodeHeights.push_back(node.height);
+        DEBUGLOG("qualifyingNode.empty() == true, chainHeight:{}", chainHeight);
+        chainHeight = top;
+        return true;
     }
     std::sort(nodeHeights.begin(), nodeHeights.end());
     //const static int malicious_node_tolerated_amount = 25;
@@ -2055,6 +2182,7 @@ void BlockHelper::RollbackTest()
                           << "ca_algorithm::RollBackToHeight:" << ret << std::endl;
                 break;
             }
+            MagicSingleton<ApiResponseCache>::GetInstance()->Clear();
             MagicSingleton<PeerNode>::GetInstance()->SetSelfHeight();
             break;
         }
@@ -22,6 +22,8 @@
 #include "ca/block_compare.h"
 #include "global.h"
 
+class DBReadWriter;
+
 namespace compator
 {
     struct BlockTimeAscending
@@ -381,6 +383,34 @@ class BlockHelper
          * @return      int 
          */
         int PreSaveProcess(const CBlock& block, global::ca::SaveType saveType, global::ca::BlockObtainMean obtainMean);
+
+        /**
+         * @brief       Verify block and write it into dbWriter without committing
+         * 
+         * @param       dbWriter: 
+         * @param       block: 
+         * @param       saveType: 
+         * @param       obtainMean: 
+         * @return      int 0 written, 1 already saved, < 0 error
+         */
+        int WriteBlock(DBReadWriter& dbWriter, const CBlock& block, global::ca::SaveType saveType, global::ca::BlockObtainMean obtainMean);
+
+        /**
+         * @brief       What follows a committed block
+         * 
+         * @param       block: 
+         */
+        void PostCommitProcess(const CBlock& block);
+
+        /**
+         * @brief       Save the polled sync blocks. Up to _kGroupCommitSize consecutive blocks far
+         *              from the chain tip share one transaction, the ones near it are committed
+         *              one by one.
+         * 
+         * @param       chainHeight: 
+         * @return      int 
+         */
+        int SaveSyncBlocks(uint64_t chainHeight);
         
         /**
          * @brief       
@@ -412,6 +442,13 @@ class BlockHelper
         const static int _kMaxMissingBlockSize = 10;
         const static int _kMaxMissingUxtoSize = 10;
         const static int _kSyncSaveFailTolerance = 2;
+        // Blocks per group commit, and how far below the chain height a block must be to join one
+        const static size_t _kGroupCommitSize = 100;
+        const static uint64_t _kGroupCommitDistance = 100;
+        // Other writers wait for the keys a group has locked, at most for the 1 s default lock
+        // timeout of the TransactionDB, so a group is also committed at these bounds
+        const static uint64_t _kGroupCommitMaxLockedKeys = 100000;
+        const static int _kGroupCommitMaxMs = 500;
         std::atomic<bool> _stopBlocking = true;
         std::atomic<bool> _whetherRunSendBlockByUtxoReq = true;
 
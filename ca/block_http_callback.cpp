@@ -1,5 +1,12 @@
 #include <sstream>
 #include <random>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
 
 #include "ca/global.h"
 #include "ca/block_http_callback.h"
@@ -11,17 +18,18 @@
 #include "net/httplib.h"
 #include "common/config.h"
 #include "utils/magic_singleton.h"
-#include "test.h"
+#include "block_json_writer.h"
 #include "ca.h"
 
 
-CBlockHttpCallback::CBlockHttpCallback() : _running(false),_ip("localhost"),_port(11190),_path("/tfsBrowser/block")
+CBlockHttpCallback::CBlockHttpCallback() : _running(false),_overflow(false),_overflowBegin(0),_overflowEnd(0),_highestHeight(0),_checkpoint(0),
+                                           _ip("localhost"),_port(11190),_path("/tfsBrowser/block"),_batchSize(1),_maxInFlight(1)
 {
     Config::HttpCallback httpCallback = {};
     MagicSingleton<Config>::GetInstance()->GetHttpCallback(httpCallback);
     if (!httpCallback.ip.empty() && httpCallback.port > 0)
     {
-        this->Start(httpCallback.ip, httpCallback.port, httpCallback.path);
+        this->Start(httpCallback.ip, httpCallback.port, httpCallback.path, httpCallback.batchSize, httpCallback.maxInFlight);
     }
     else
     {
@@ -29,21 +37,45 @@ CBlockHttpCallback::CBlockHttpCallback() : _running(false),_ip("localhost"),_por
     }
 }
 
+CBlockHttpCallback::~CBlockHttpCallback()
+{
+    Stop();
+}
+
 bool CBlockHttpCallback::AddBlock(const std::string& block)
 {
     if (block.empty())
         return false;
-    std::unique_lock<std::mutex> lck(_addMutex);
-    _addblocks.push_back( block );
-    _cvadd.notify_all();
-
+    _PushAddItem({0, false, block});
     return true;
 }
 
 bool CBlockHttpCallback::AddBlock(const CBlock& block)
 {
+    uint64_t height = block.height();
+    {
+        std::unique_lock<std::mutex> lck(_addMutex);
+        _highestHeight = std::max(_highestHeight, height);
+        if (_overflow || _addblocks.size() >= kMaxBufferedBlocks)
+        {
+            // Keep only the height, the block is rendered again from the database once the buffer drains
+            if (!_overflow)
+            {
+                DEBUGLOG("http callback buffer is full, spill from height {}", height);
+                _overflow = true;
+                _overflowBegin = height;
+                _overflowEnd = height;
+            }
+            _overflowBegin = std::min(_overflowBegin, height);
+            _overflowEnd = std::max(_overflowEnd, height);
+            _cvadd.notify_one();
+            return true;
+        }
+    }
+
     std::string json = ToJson(block);
-    return AddBlock(json);
+    _PushAddItem({height, true, std::move(json)});
+    return true;
 }
 
 bool CBlockHttpCallback::RollbackBlockStr(const std::string& block)
@@ -65,66 +97,340 @@ bool CBlockHttpCallback::RollbackBlock(const CBlock& block)
     return RollbackBlockStr(json);
 }
 
+void CBlockHttpCallback::_PushAddItem(PushItem&& item)
+{
+    std::unique_lock<std::mutex> lck(_addMutex);
+    if (item.tracked)
+    {
+        _pendingHeights.insert(item.height);
+    }
+    _addblocks.push_back(std::move(item));
+    _cvadd.notify_one();
+}
+
+void CBlockHttpCallback::_RefillFromOverflow(std::unique_lock<std::mutex>& lck)
+{
+    uint64_t begin = _overflowBegin;
+    uint64_t end = std::min<uint64_t>(_overflowEnd, begin + (uint64_t)_batchSize * _maxInFlight - 1);
+    _overflowBegin = end + 1;
+    if (_overflowBegin > _overflowEnd)
+    {
+        _overflow = false;
+    }
+    // Hold the checkpoint below the range until the re-read blocks are acknowledged
+    for (uint64_t height = begin; height <= end; ++height)
+    {
+        _pendingHeights.insert(height);
+    }
+
+    lck.unlock();
+    std::vector<PushItem> items;
+    std::vector<uint64_t> missing;
+    DBReader dbReader;
+    for (uint64_t height = begin; height <= end; ++height)
+    {
+        std::vector<std::string> hashes;
+        if (DBStatus::DB_SUCCESS != dbReader.GetBlockHashsByBlockHeight(height, hashes) || hashes.empty())
+        {
+            ERRORLOG("http callback GetBlockHashsByBlockHeight failed, height: {}", height);
+            missing.push_back(height);
+            continue;
+        }
+
+        bool first = true;
+        for (const auto &hash : hashes)
+        {
+            std::string blockRaw;
+            CBlock block;
+            if (DBStatus::DB_SUCCESS != dbReader.GetBlockByBlockHash(hash, blockRaw) || !block.ParseFromString(blockRaw))
+            {
+                ERRORLOG("http callback GetBlockByBlockHash failed, hash: {}", hash);
+                continue;
+            }
+            // Only one entry per height is counted in _pendingHeights, the others are pushed untracked
+            items.push_back({height, first, ToJson(block)});
+            first = false;
+        }
+        if (first)
+        {
+            missing.push_back(height);
+        }
+    }
+    lck.lock();
+
+    for (auto height : missing)
+    {
+        auto found = _pendingHeights.find(height);
+        if (found != _pendingHeights.end())
+        {
+            _pendingHeights.erase(found);
+        }
+    }
+    for (auto &item : items)
+    {
+        _addblocks.push_back(std::move(item));
+    }
+    _cvadd.notify_all();
+}
+
+void CBlockHttpCallback::_Acknowledge(const std::vector<PushItem>& batch)
+{
+    uint64_t checkpoint = 0;
+    {
+        std::unique_lock<std::mutex> lck(_addMutex);
+        for (const auto &item : batch)
+        {
+            if (!item.tracked)
+            {
+                continue;
+            }
+            auto found = _pendingHeights.find(item.height);
+            if (found != _pendingHeights.end())
+            {
+                _pendingHeights.erase(found);
+            }
+        }
+
+        uint64_t next = _highestHeight + 1;
+        if (!_pendingHeights.empty())
+        {
+            next = std::min(next, *_pendingHeights.begin());
+        }
+        if (_overflow)
+        {
+            next = std::min(next, _overflowBegin);
+        }
+        if (next == 0 || next - 1 <= _checkpoint)
+        {
+            return;
+        }
+        _checkpoint = next - 1;
+
+        // Acks come per batch, the file is written at most once per interval and Stop() writes the last one
+        auto now = std::chrono::steady_clock::now();
+        if (now < _nextCheckpointSave)
+        {
+            return;
+        }
+        _nextCheckpointSave = now + std::chrono::milliseconds(kCheckpointIntervalMs);
+        checkpoint = _checkpoint;
+    }
+    _SaveCheckpoint(checkpoint);
+}
+
+void CBlockHttpCallback::_LoadCheckpoint()
+{
+    DBReader dbReader;
+    uint64_t top = 0;
+    if (DBStatus::DB_SUCCESS != dbReader.GetBlockTop(top))
+    {
+        ERRORLOG("http callback GetBlockTop failed");
+        return;
+    }
+
+    std::ifstream file(kCheckpointFile);
+    uint64_t checkpoint = 0;
+    if (!file.is_open() || !(file >> checkpoint))
+    {
+        // Nothing was pushed before, start from the current top instead of replaying the chain
+        _checkpoint = top;
+        _highestHeight = top;
+        _SaveCheckpoint(top);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lck(_addMutex);
+    _checkpoint = checkpoint;
+    _highestHeight = std::max(checkpoint, top);
+    if (top > checkpoint)
+    {
+        INFOLOG("http callback resumes from height {} to {}", checkpoint + 1, top);
+        _overflow = true;
+        _overflowBegin = checkpoint + 1;
+        _overflowEnd = top;
+    }
+}
+
+void CBlockHttpCallback::_SaveCheckpoint(uint64_t height)
+{
+    std::unique_lock<std::mutex> lck(_checkpointMutex);
+    // Senders save outside _addMutex, a late one must not move the file backwards
+    if (_savedCheckpoint && *_savedCheckpoint >= height)
+    {
+        return;
+    }
+
+    // Write a temporary file, sync it and rename it over the old one, so a crash leaves either checkpoint whole
+    std::string tmpFile = std::string(kCheckpointFile) + ".tmp";
+    std::string content = std::to_string(height);
+    int fd = open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        ERRORLOG("http callback open checkpoint file failed: {}", strerror(errno));
+        return;
+    }
+    bool written = write(fd, content.data(), content.size()) == (ssize_t)content.size() && fsync(fd) == 0;
+    close(fd);
+    if (!written)
+    {
+        ERRORLOG("http callback save checkpoint {} failed: {}", height, strerror(errno));
+        return;
+    }
+    if (rename(tmpFile.c_str(), kCheckpointFile) != 0)
+    {
+        ERRORLOG("http callback rename checkpoint failed: {}", strerror(errno));
+        return;
+    }
+    auto dir = std::filesystem::path(kCheckpointFile).parent_path();
+    int dirFd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd >= 0)
+    {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    _savedCheckpoint = height;
+}
 
 void CBlockHttpCallback::AddBlockWork(const std::string &method)
 {
+    httplib::Client client(_ip, _port);
+    _InitClient(client);
+
     while (_running)
     {
-        std::string currentBlock;
+        std::vector<PushItem> batch;
         {
             std::unique_lock<std::mutex> lck(_addMutex);
-            while (_addblocks.empty())
+            _cvadd.wait(lck, [this]() { return !_running || !_addblocks.empty() || _overflow; });
+            if (!_running)
             {
-                DEBUGLOG("Enter waiting for condition variable.");
-                _cvadd.wait(lck);
+                break;
+            }
+            if (_addblocks.empty())
+            {
+                _RefillFromOverflow(lck);
+            }
+            while (!_addblocks.empty() && batch.size() < _batchSize)
+            {
+                batch.push_back(std::move(_addblocks.front()));
+                _addblocks.pop_front();
             }
-            DEBUGLOG("Handle the first block...");
-            currentBlock = _addblocks.front();
-            _addblocks.erase(_addblocks.begin());
+        }
+        if (batch.empty())
+        {
+            continue;
         }
 
-        SendBlockHttp(currentBlock,method);
+        std::string body;
+        if (_batchSize == 1)
+        {
+            body = std::move(batch.front().json);
+        }
+        else
+        {
+            body.push_back('[');
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                if (i != 0)
+                {
+                    body.push_back(',');
+                }
+                body += batch[i].json;
+                batch[i].json.clear();
+            }
+            body.push_back(']');
+        }
+
+        if (!SendWithRetry(client, body, method))
+        {
+            break;
+        }
+        _Acknowledge(batch);
     }
 }
 
 
 void CBlockHttpCallback::RollbackBlockWork(const std::string &method)
 {
+    httplib::Client client(_ip, _port);
+    _InitClient(client);
+
     while (_running)
     {
         std::string currentBlock;
         {
             std::unique_lock<std::mutex> lck(_rollbackMutex);
-            while (_rollbackblocks.empty())
+            _cvrollback.wait(lck, [this]() { return !_running || !_rollbackblocks.empty(); });
+            if (!_running)
             {
-                DEBUGLOG("Enter waiting for condition variable.");
-                _cvrollback.wait(lck);
+                break;
             }
             DEBUGLOG("Handle the first block...");
-            currentBlock = _rollbackblocks.front();
-            _rollbackblocks.erase(_rollbackblocks.begin());
+            currentBlock = std::move(_rollbackblocks.front());
+            _rollbackblocks.pop_front();
+        }
+        if (!SendWithRetry(client, currentBlock, method))
+        {
+            break;
         }
-        SendBlockHttp(currentBlock,method);
     }
 }
 
-void CBlockHttpCallback::Start(const std::string& ip, int port,const std::string& path)
+void CBlockHttpCallback::Start(const std::string& ip, int port,const std::string& path, uint32_t batchSize, uint32_t maxInFlight)
 {
+    if (_running)
+    {
+        return;
+    }
     _ip = ip;
     _port = port;
     _path = path;
+    _batchSize = std::max<uint32_t>(batchSize, 1);
+    _maxInFlight = std::max<uint32_t>(maxInFlight, 1);
+    _LoadCheckpoint();
+
     _running = true;
     const std::string method1 = "/addblock";
     const std::string method2 = "/rollbackblock";
-    _workAddblockThread = std::thread(std::bind(&CBlockHttpCallback::AddBlockWork, this, method1));
+    for (uint32_t i = 0; i < _maxInFlight; ++i)
+    {
+        _workAddblockThreads.emplace_back(std::bind(&CBlockHttpCallback::AddBlockWork, this, method1));
+    }
     _workRollbackThread = std::thread(std::bind(&CBlockHttpCallback::RollbackBlockWork, this, method2));
-    _workAddblockThread.detach();
-    _workRollbackThread.detach();
 }
 
 void CBlockHttpCallback::Stop()
 {
-    _running = false;
+    {
+        std::unique_lock<std::mutex> addLck(_addMutex);
+        std::unique_lock<std::mutex> rollbackLck(_rollbackMutex);
+        _running = false;
+    }
+    _cvadd.notify_all();
+    _cvrollback.notify_all();
+
+    for (auto &thread : _workAddblockThreads)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+    _workAddblockThreads.clear();
+    if (_workRollbackThread.joinable())
+    {
+        _workRollbackThread.join();
+    }
+
+    uint64_t checkpoint = 0;
+    {
+        std::unique_lock<std::mutex> lck(_addMutex);
+        checkpoint = _checkpoint;
+    }
+    if (checkpoint != 0)
+    {
+        _SaveCheckpoint(checkpoint);
+    }
 }
 
 bool CBlockHttpCallback::IsRunning()
@@ -132,132 +438,58 @@ bool CBlockHttpCallback::IsRunning()
     return _running;
 }
 
-bool CBlockHttpCallback::SendBlockHttp(const std::string& block,const std::string &method)
+void CBlockHttpCallback::_InitClient(httplib::Client& client)
 {
-    httplib::Client client(_ip, _port);
-    std::string path = _path + method;
-    auto res = client.Post(path.data(), block, "application/json");
-    if (res)
-    {
-        DEBUGLOG("status:{}, Content-Type:{}, body:{}", res->status, res->get_header_value("Content-Type"), res->body);
-    }
-    else
-    {
-        DEBUGLOG("Client post failed");
-    }
-
-    return (bool)res;
+    client.set_keep_alive(true);
+    client.set_connection_timeout(kRequestTimeoutSecond);
+    client.set_read_timeout(kRequestTimeoutSecond);
+    client.set_write_timeout(kRequestTimeoutSecond);
 }
 
-std::string CBlockHttpCallback::ToJson(const CBlock& block)
+bool CBlockHttpCallback::SendWithRetry(httplib::Client& client, const std::string& body, const std::string& method)
 {
-    nlohmann::json allTx;
-    nlohmann::json jsonBlock;
-    jsonBlock["hash"] = addHexPrefix(block.hash());
-    jsonBlock["height"] = block.height();
-    jsonBlock["time"] = block.time();
-    if(!block.data().empty())
+    uint32_t intervalMs = 100;
+    while (_running)
     {
-        nlohmann::json blockdataJson = nlohmann::json::parse(block.data());
-        nlohmann::json modifiedJsonData;
-
-
-        for (auto it = blockdataJson.begin(); it != blockdataJson.end(); ++it) {
-
-            std::string originalKey = it.key();
-            auto value = it.value();
-            std::string modifiedKey = addHexPrefix(originalKey);
-            modifiedJsonData[modifiedKey] = value;
+        int status = SendBlockHttp(client, body, method);
+        if (status > 0 && status < 500)
+        {
+            if (status >= 300)
+            {
+                ERRORLOG("http callback {} rejected with status {}, dropped", method, status);
+            }
+            return true;
         }
-        blockdataJson = modifiedJsonData;
 
-        if(blockdataJson.contains("dependentCTx") && !blockdataJson["dependentCTx"].get<std::string>().empty()){
-            blockdataJson["dependentCTx"] = addHexPrefix(blockdataJson["dependentCTx"].get<std::string>());
-        }
-        else
+        // Sleep in short slices so that Stop() is not held up by a long backoff
+        for (uint32_t slept = 0; slept < intervalMs && _running; slept += 100)
         {
-            blockdataJson["dependentCTx"] = "";
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
-        jsonBlock["blockdata"] = blockdataJson;
-        
+        intervalMs = std::min(intervalMs * 2, kMaxRetryIntervalMs);
     }
-    else
+    return false;
+}
+
+int CBlockHttpCallback::SendBlockHttp(httplib::Client& client, const std::string& body, const std::string &method)
+{
+    std::string path = _path + method;
+    auto res = client.Post(path.data(), body, "application/json");
+    if (res)
     {
-        jsonBlock["blockdata"] = "";
+        DEBUGLOG("status:{}, Content-Type:{}, body:{}", res->status, res->get_header_value("Content-Type"), res->body);
+        return res->status;
     }
-    int k = 0;
-    for(auto & tx : block.txs())
-    {
-        nlohmann::json Tx;
-        if(tx.type() == global::ca::kTxSign)
-        {   
-            if((global::ca::TxType)tx.txtype() != global::ca::TxType::kTxTypeTx)
-            {
-                
-                nlohmann::json dataJson = nlohmann::json::parse(tx.data());
-                if (dataJson.contains("TxInfo") && dataJson["TxInfo"].contains("BonusAddr")) 
-                {
-                    std::string bonusAddr = dataJson["TxInfo"]["BonusAddr"].get<std::string>();
-                    dataJson["TxInfo"]["BonusAddr"] = addHexPrefix(bonusAddr);
-                }
-                
-                if (dataJson.contains("TxInfo") && dataJson["TxInfo"].contains("DisinvestUtxo")) 
-                {
-                    std::string disinvestUtxo = dataJson["TxInfo"]["DisinvestUtxo"].get<std::string>();
-                    dataJson["TxInfo"]["DisinvestUtxo"] = addHexPrefix(disinvestUtxo);
-                }
-                Tx["data"] = dataJson;
-                
-            }
-            
-            Tx["time"] = tx.time();
-            Tx["hash"] = addHexPrefix(tx.hash());
-
-            for(auto & owner: tx.utxo().owner())
-            {
-                Tx["from"].push_back(addHexPrefix(owner));
-            }
-
-            for(auto & vout : tx.utxo().vout())
-            {
-                nlohmann::json utxoVout;
-                utxoVout["pub"] = addHexPrefix(vout.addr());
-                utxoVout["value"] = vout.value();
-
-                Tx["to"].push_back(utxoVout); 
-            }
-
-            Tx["type"] = tx.txtype();
-
-            allTx[k++] = FixTxField(Tx);
-        }
-        else if(tx.type() == global::ca::kGenesisSign)
-        {
-            Tx["time"] = tx.time();
-            Tx["hash"] = addHexPrefix(tx.hash());
-
-            for(auto & owner: tx.utxo().owner())
-            {
-                Tx["from"].push_back(addHexPrefix(owner));
-            }
 
-            for(auto & vout : tx.utxo().vout())
-            {
-                nlohmann::json utxoVout;
-                utxoVout["addr"] = addHexPrefix(vout.addr());
-                utxoVout["value"] = vout.value();
+    DEBUGLOG("Client post failed");
+    return -1;
+}
 
-                Tx["to"].push_back(utxoVout); 
-            }
-            Tx["type"] = tx.txtype();
-            allTx[k++] = FixTxField(Tx);
-        }
-    }
-    
-    jsonBlock["tx"] = allTx;
-    
-    std::string json = jsonBlock.dump(4);
-    return json;
+std::string CBlockHttpCallback::ToJson(const CBlock& block)
+{
+    JsonStreamWriter writer;
+    WriteCallbackBlockJson(writer, block);
+    return writer.Take();
 }
 
 void CBlockHttpCallback::Test()
@@ -271,4 +503,3 @@ void CBlockHttpCallback::Test()
     std::string testStr = stream.str();
     AddBlock(testStr);
 }
-
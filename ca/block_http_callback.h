@@ -10,23 +10,36 @@
 #ifndef __CA_BLOCK_HTTP_CALLBACK_H__
 #define __CA_BLOCK_HTTP_CALLBACK_H__
 
+#include <set>
+#include <deque>
 #include <vector>
 #include <string>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <optional>
 
 #include "block.pb.h"
+#include "net/httplib.h"
 
 /**
- * @brief       
- * 
+ * @brief       Pushes saved and rolled back blocks to the configured http endpoint.
+ *              Saved blocks are posted in batches by several senders, retried until
+ *              acknowledged, and the highest fully acknowledged height is persisted so
+ *              that a restarted node resumes from it. When the in-memory buffer is full
+ *              only the heights are kept and the blocks are re-read from the database.
+ *
+ *              Delivery is at least once. With maxInFlight > 1 batches are sent concurrently
+ *              and may arrive out of height order, so the endpoint has to accept blocks in
+ *              any order; use maxInFlight = 1 for strictly ordered delivery.
  */
 class CBlockHttpCallback
 {
 public:
     CBlockHttpCallback();
+    ~CBlockHttpCallback();
 
     /**
      * @brief       
@@ -70,8 +83,10 @@ public:
      * @param       ip: 
      * @param       port: 
      * @param       path: 
+     * @param       batchSize: blocks per add request, 1 posts the block object itself
+     * @param       maxInFlight: concurrent add requests, above 1 blocks may arrive out of order
      */
-    void Start(const std::string& ip, int port, const std::string& path);
+    void Start(const std::string& ip, int port, const std::string& path, uint32_t batchSize = 1, uint32_t maxInFlight = 1);
 
     /**
      * @brief       
@@ -107,15 +122,20 @@ public:
      */
     void Test();
 
-    /**
-     * @brief       
-     * 
-     * @param       self: 
-     * @return      int 
-     */
-    static int Process(CBlockHttpCallback* self);
-     
+    static constexpr size_t kMaxBufferedBlocks = 1000;
+    static constexpr uint32_t kMaxRetryIntervalMs = 10 * 1000;
+    static constexpr time_t kRequestTimeoutSecond = 10;
+    static constexpr const char *kCheckpointFile = "./http_callback_checkpoint";
+    static constexpr uint32_t kCheckpointIntervalMs = 1000;
+
 private:
+    struct PushItem
+    {
+        uint64_t height;
+        bool tracked;
+        std::string json;
+    };
+
     /**
      * @brief       
      * 
@@ -127,12 +147,38 @@ private:
     /**
      * @brief       
      * 
-     * @param       block: 
+     * @param       client: 
+     * @param       body: 
+     * @param       method: 
+     * @return      int http status, -1 if the request did not complete
+     */
+    int SendBlockHttp(httplib::Client& client, const std::string& body, const std::string& method);
+
+    /**
+     * @brief       Post until answered or stopped, backing off between attempts.
+     *              Transport failures and 5xx answers are retried, any other answer is final.
+     * 
+     * @param       client: 
+     * @param       body: 
      * @param       method: 
      * @return      true 
-     * @return      false 
+     * @return      false stopped before the endpoint answered
      */
-    bool SendBlockHttp(const std::string& block, const std::string& method);
+    bool SendWithRetry(httplib::Client& client, const std::string& body, const std::string& method);
+
+    void _InitClient(httplib::Client& client);
+
+    /**
+     * @brief       Re-read blocks of overflowed heights from the database, called with _addMutex held
+     * 
+     * @param       lck: 
+     */
+    void _RefillFromOverflow(std::unique_lock<std::mutex>& lck);
+
+    void _PushAddItem(PushItem&& item);
+    void _Acknowledge(const std::vector<PushItem>& batch);
+    void _LoadCheckpoint();
+    void _SaveCheckpoint(uint64_t height);
 
 private:
     /**
@@ -143,9 +189,9 @@ private:
      */
     friend std::string PrintCache(int where);
 
-    std::vector<std::string>    _addblocks;
-    std::vector<std::string>    _rollbackblocks;
-    std::thread                 _workAddblockThread;
+    std::deque<PushItem>        _addblocks;
+    std::deque<std::string>     _rollbackblocks;
+    std::vector<std::thread>    _workAddblockThreads;
     std::thread                 _workRollbackThread;
     std::mutex                  _addMutex;
     std::mutex                  _rollbackMutex;
@@ -153,9 +199,25 @@ private:
     std::condition_variable     _cvrollback;
     volatile std::atomic_bool   _running;
 
+    // heights queued or in flight, the checkpoint is just below the lowest of them
+    std::multiset<uint64_t>     _pendingHeights;
+    // heights dropped from memory while the buffer was full, [_overflowBegin, _overflowEnd]
+    bool                        _overflow;
+    uint64_t                    _overflowBegin;
+    uint64_t                    _overflowEnd;
+    uint64_t                    _highestHeight;
+    uint64_t                    _checkpoint;
+    std::chrono::steady_clock::time_point _nextCheckpointSave;
+
+    // Serializes checkpoint file writes
+    std::mutex                  _checkpointMutex;
+    std::optional<uint64_t>     _savedCheckpoint;
+
     std::string _ip;
     uint32_t _port;
     std::string _path;
+    uint32_t _batchSize;
+    uint32_t _maxInFlight;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,341 @@
+#include "ca/block_json_writer.h"
+
+#include <set>
+
+#include "ca/ca.h"
+#include "ca/global.h"
+#include "include/logging.h"
+#include "utils/json.hpp"
+#include "utils/account_manager.h"
+
+// Keys are written in the order nlohmann::json used to sort them so that
+// responses stay byte-compatible with the former DOM based output.
+
+static bool _IsVirtualAddr(const std::string &addr)
+{
+    return addr == global::ca::kVirtualStakeAddr || addr == global::ca::kVirtualInvestAddr
+        || addr == global::ca::kVirtualBurnGasAddr || addr == global::ca::kVirtualDeployContractAddr
+        || addr == global::ca::kVirtualCallContractAddr;
+}
+
+static void _PrefixJsonString(nlohmann::json &object, const char *key)
+{
+    object[key] = addHexPrefix(object[key].get<std::string>());
+}
+
+static void _WriteTxData(JsonStreamWriter &writer, const std::string &data)
+{
+    try
+    {
+        nlohmann::json dataJson = nlohmann::json::parse(data);
+        if (dataJson.contains("TxInfo"))
+        {
+            auto &txInfo = dataJson["TxInfo"];
+            if (txInfo.contains("BonusAddr"))
+            {
+                _PrefixJsonString(txInfo, "BonusAddr");
+            }
+            if (txInfo.contains("DisinvestUtxo"))
+            {
+                _PrefixJsonString(txInfo, "DisinvestUtxo");
+            }
+            if (txInfo.contains("recipient") && txInfo.contains("sender"))
+            {
+                _PrefixJsonString(txInfo, "recipient");
+                _PrefixJsonString(txInfo, "sender");
+            }
+            if (txInfo.contains("contractDeployer"))
+            {
+                _PrefixJsonString(txInfo, "contractDeployer");
+            }
+        }
+        writer.Raw(dataJson.dump());
+    }
+    catch (const std::exception &e)
+    {
+        ERRORLOG("tx data is not valid json: {}", e.what());
+        writer.Null();
+    }
+}
+
+static void _WriteSign(JsonStreamWriter &writer, const CSign &sign, bool withAddr)
+{
+    writer.BeginObject();
+    writer.Key("pub").String(Base64Encode(sign.pub()));
+    writer.Key("sign").String(Base64Encode(sign.sign()));
+    if (withAddr)
+    {
+        writer.Key("signaddr").String(addHexPrefix(GenerateAddr(sign.pub())));
+    }
+    writer.EndObject();
+}
+
+static void _WriteTxUtxo(JsonStreamWriter &writer, const CTxUtxo &utxo, bool isGenesis)
+{
+    if (utxo.owner_size() == 0 && utxo.vin_size() == 0 && utxo.vout_size() == 0 && utxo.multisign_size() == 0)
+    {
+        return;
+    }
+
+    writer.Key("utxo").BeginObject();
+    if (utxo.multisign_size() > 0)
+    {
+        writer.Key("multisign").BeginArray();
+        for (auto &multiSign : utxo.multisign())
+        {
+            _WriteSign(writer, multiSign, false);
+        }
+        writer.EndArray();
+    }
+
+    if (utxo.owner_size() > 0)
+    {
+        writer.Key("owner").BeginArray();
+        for (auto &owner : utxo.owner())
+        {
+            writer.String(addHexPrefix(owner));
+        }
+        writer.EndArray();
+    }
+
+    if (utxo.vin_size() > 0)
+    {
+        writer.Key("vin").BeginObject();
+        bool hasPrevout = false;
+        for (auto &vin : utxo.vin())
+        {
+            for (auto &prevout : vin.prevout())
+            {
+                if (!hasPrevout)
+                {
+                    writer.Key("prevout").BeginObject().Key("hash").BeginArray();
+                    hasPrevout = true;
+                }
+                writer.String(addHexPrefix(prevout.hash()));
+            }
+        }
+        if (hasPrevout)
+        {
+            writer.EndArray().EndObject();
+        }
+
+        writer.Key("vinsign").BeginArray();
+        for (auto &vin : utxo.vin())
+        {
+            _WriteSign(writer, vin.vinsign(), false);
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+
+    if (utxo.vout_size() > 0)
+    {
+        writer.Key("vout").BeginArray();
+        for (auto &vout : utxo.vout())
+        {
+            bool rawAddr = isGenesis ? _IsVirtualAddr(vout.addr()) : vout.addr().substr(0, 6) == "Virtua";
+            writer.BeginObject();
+            writer.Key("addr").String(rawAddr ? vout.addr() : addHexPrefix(vout.addr()));
+            writer.Key("value").Int(vout.value());
+            writer.EndObject();
+        }
+        writer.EndArray();
+    }
+    writer.EndObject();
+}
+
+void WriteTxJson(JsonStreamWriter &writer, const CTransaction &tx)
+{
+    if (tx.type() == global::ca::kTxSign)
+    {
+        writer.BeginObject();
+        writer.Key("Consensus").Uint(tx.consensus());
+        writer.Key("Type").String(tx.type());
+        if ((global::ca::TxType)tx.txtype() != global::ca::TxType::kTxTypeTx)
+        {
+            writer.Key("data");
+            _WriteTxData(writer, tx.data());
+        }
+        writer.Key("identity").String(addHexPrefix(tx.identity()));
+        writer.Key("info").String(tx.info());
+        writer.Key("time").Uint(tx.time());
+        writer.Key("txHash").String(addHexPrefix(tx.hash()));
+        writer.Key("txType").Uint(tx.txtype());
+        _WriteTxUtxo(writer, tx.utxo(), false);
+        if (tx.verifysign_size() > 0)
+        {
+            writer.Key("verifySign").BeginArray();
+            for (auto &verifySign : tx.verifysign())
+            {
+                _WriteSign(writer, verifySign, true);
+            }
+            writer.EndArray();
+        }
+        writer.EndObject();
+    }
+    else if (tx.type() == global::ca::kGenesisSign)
+    {
+        writer.BeginObject();
+        writer.Key("Type").String(tx.type());
+        writer.Key("identity").String(addHexPrefix(tx.identity()));
+        writer.Key("time").Uint(tx.time());
+        writer.Key("txHash").String(addHexPrefix(tx.hash()));
+        _WriteTxUtxo(writer, tx.utxo(), true);
+        writer.EndObject();
+    }
+    else
+    {
+        writer.Null();
+    }
+}
+
+void WriteBlockJson(JsonStreamWriter &writer, const CBlock &block)
+{
+    writer.BeginObject();
+    writer.Key("block").BeginObject();
+    if (block.sign_size() > 0)
+    {
+        writer.Key("blocksign").BeginArray();
+        for (auto &blockSign : block.sign())
+        {
+            _WriteSign(writer, blockSign, true);
+        }
+        writer.EndArray();
+    }
+    writer.Key("bytes").Uint(block.ByteSizeLong());
+
+    writer.Key("data");
+    if (block.data().empty())
+    {
+        writer.String("");
+    }
+    else
+    {
+        try
+        {
+            nlohmann::json blockdataJson = nlohmann::json::parse(block.data());
+            nlohmann::json modifiedJsonData = nlohmann::json::object();
+            for (auto it = blockdataJson.begin(); it != blockdataJson.end(); ++it)
+            {
+                auto value = it.value();
+                if (value.contains("dependentCTx"))
+                {
+                    std::set<std::string> tempVec;
+                    for (auto &dep : value["dependentCTx"])
+                    {
+                        tempVec.insert(addHexPrefix(dep));
+                    }
+                    value["dependentCTx"] = tempVec;
+                }
+                modifiedJsonData[addHexPrefix(it.key())] = std::move(value);
+            }
+            writer.Raw(modifiedJsonData.dump());
+        }
+        catch (const std::exception &e)
+        {
+            ERRORLOG("block data is not valid json: {}", e.what());
+            writer.String("");
+        }
+    }
+
+    writer.Key("hash").String(addHexPrefix(block.hash()));
+    writer.Key("height").Int(block.height());
+    writer.Key("merkleroot").String(addHexPrefix(block.merkleroot()));
+    writer.Key("prevhash").String(addHexPrefix(block.prevhash()));
+    writer.Key("time").Uint(block.time());
+    writer.EndObject();
+
+    writer.Key("tx").BeginArray();
+    for (auto &tx : block.txs())
+    {
+        if (tx.type() == global::ca::kTxSign || tx.type() == global::ca::kGenesisSign)
+        {
+            WriteTxJson(writer, tx);
+        }
+    }
+    writer.EndArray();
+    writer.EndObject();
+}
+
+void WriteCallbackBlockJson(JsonStreamWriter &writer, const CBlock &block)
+{
+    writer.BeginObject();
+    writer.Key("blockdata");
+    if (block.data().empty())
+    {
+        writer.String("");
+    }
+    else
+    {
+        try
+        {
+            nlohmann::json blockdataJson = nlohmann::json::parse(block.data());
+            nlohmann::json modifiedJsonData = nlohmann::json::object();
+            for (auto it = blockdataJson.begin(); it != blockdataJson.end(); ++it)
+            {
+                modifiedJsonData[addHexPrefix(it.key())] = it.value();
+            }
+            if (modifiedJsonData.contains("dependentCTx") && !modifiedJsonData["dependentCTx"].get<std::string>().empty())
+            {
+                _PrefixJsonString(modifiedJsonData, "dependentCTx");
+            }
+            else
+            {
+                modifiedJsonData["dependentCTx"] = "";
+            }
+            writer.Raw(modifiedJsonData.dump());
+        }
+        catch (const std::exception &e)
+        {
+            ERRORLOG("block data is not valid json: {}", e.what());
+            writer.String("");
+        }
+    }
+    writer.Key("hash").String(addHexPrefix(block.hash()));
+    writer.Key("height").Int(block.height());
+    writer.Key("time").Uint(block.time());
+
+    writer.Key("tx").BeginArray();
+    for (auto &tx : block.txs())
+    {
+        bool isTxSign = tx.type() == global::ca::kTxSign;
+        if (!isTxSign && tx.type() != global::ca::kGenesisSign)
+        {
+            continue;
+        }
+
+        writer.BeginObject();
+        if (isTxSign && (global::ca::TxType)tx.txtype() != global::ca::TxType::kTxTypeTx)
+        {
+            writer.Key("data");
+            _WriteTxData(writer, tx.data());
+        }
+        if (tx.utxo().owner_size() > 0)
+        {
+            writer.Key("from").BeginArray();
+            for (auto &owner : tx.utxo().owner())
+            {
+                writer.String(addHexPrefix(owner));
+            }
+            writer.EndArray();
+        }
+        writer.Key("hash").String(addHexPrefix(tx.hash()));
+        writer.Key("time").Uint(tx.time());
+        if (tx.utxo().vout_size() > 0)
+        {
+            writer.Key("to").BeginArray();
+            for (auto &vout : tx.utxo().vout())
+            {
+                writer.BeginObject();
+                writer.Key(isTxSign ? "pub" : "addr").String(addHexPrefix(vout.addr()));
+                writer.Key("value").Int(vout.value());
+                writer.EndObject();
+            }
+            writer.EndArray();
+        }
+        writer.Key("type").Uint(tx.txtype());
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+}
@@ -0,0 +1,41 @@
+/**
+ * *****************************************************************************
+ * @file        block_json_writer.h
+ * @brief       Render blocks and transactions for the http api and the block
+ *              http callback directly from protobuf into a JsonStreamWriter
+ * @date        2024-06-12
+ * @copyright   tfsc
+ * *****************************************************************************
+ */
+#ifndef __CA_BLOCK_JSON_WRITER_H__
+#define __CA_BLOCK_JSON_WRITER_H__
+
+#include "utils/json_stream_writer.h"
+#include "proto/block.pb.h"
+#include "proto/transaction.pb.h"
+
+/**
+ * @brief       Write one transaction in the format of the transaction query api
+ *
+ * @param       writer:
+ * @param       tx:
+ */
+void WriteTxJson(JsonStreamWriter &writer, const CTransaction &tx);
+
+/**
+ * @brief       Write one block ({"block":{...},"tx":[...]}) in the format of the block query api
+ *
+ * @param       writer:
+ * @param       block:
+ */
+void WriteBlockJson(JsonStreamWriter &writer, const CBlock &block);
+
+/**
+ * @brief       Write one block in the format posted to the block http callback
+ *
+ * @param       writer:
+ * @param       block:
+ */
+void WriteCallbackBlockJson(JsonStreamWriter &writer, const CBlock &block);
+
+#endif
@@ -14,6 +14,8 @@
 #include "net/peer_node.h"
 #include "utils/tfs_bench_mark.h"
 #include "utils/contract_utils.h"
+#include "db/cache.h"
+#include "common/proto_arena.h"
 
 void BlockStroage::_StartTimer()
 {
@@ -26,14 +28,26 @@ void BlockStroage::_StartTimer()
 
 int BlockStroage::AddBlock(const BlockMsg &msg)
 {
-	std::unique_lock<std::shared_mutex> lck(_blockMutex);
-
-    CBlock block;
-    block.ParseFromString(msg.block());
+    auto aggregate = BlockSignAggregate();
+    if (!aggregate.block.ParseFromString(msg.block()))
+    {
+        ERRORLOG("fail to parse block");
+        return -1;
+    }
+    const int64_t kTenSecond = (int64_t)1000000 * 10;
+    aggregate.deadline = aggregate.block.time() + kTenSecond;
+    std::string hash = aggregate.block.hash();
+    // The packager signs the block itself, its signature must not be counted again
+    if (aggregate.block.sign_size() > 0)
+    {
+        aggregate.signers.insert(GenerateAddr(aggregate.block.sign(0).pub()));
+    }
 
-	std::vector<BlockMsg> msgVec;
-	msgVec.push_back(msg); 
-    _blockCnt.insert(std::pair<std::string,std::vector<BlockMsg>>(block.hash(),msgVec));
+	std::unique_lock<std::shared_mutex> lck(_blockMutex);
+    if (_blockCnt.emplace(hash, std::move(aggregate)).second)
+    {
+        _blockDeadlines.emplace(_blockCnt[hash].deadline, hash);
+    }
 	DEBUGLOG("add TransactionCache");
 	lck.unlock();
 
@@ -42,106 +56,142 @@ int BlockStroage::AddBlock(const BlockMsg &msg)
 
 int BlockStroage::UpdateBlock(const BlockMsg &msg)
 {
-    std::unique_lock<std::shared_mutex> lck(_blockMutex);
-
-    CBlock block;
-    block.ParseFromString(msg.block());
-    INFOLOG("recv block sign addr = {}, blockhash:{}",GenerateAddr(block.sign(1).pub()), block.hash());
+    // Every signer sends the whole block back, only its hash and signature are kept
+    ScratchArena arena;
+    auto &block = *arena.Create<CBlock>();
+    if (!block.ParseFromString(msg.block()))
+    {
+        ERRORLOG("fail to parse block");
+        return -2;
+    }
 
     if(block.sign_size() != 2)
     {
 		ERRORLOG("sign  size != 2");
         return -1;
     }
-		
-    auto it = _blockCnt.find(block.hash());
-    if (it != _blockCnt.end())
+    std::string signer = GenerateAddr(block.sign(1).pub());
+    INFOLOG("recv block sign addr = {}, blockhash:{}", signer, block.hash());
+
+    // Only the signature is aggregated, so it has to be valid for the block hash and come from a VRF selected node
+    if (ca_algorithm::VerifySign(block.sign(1), block.hash()) != 0)
     {
-        _blockCnt[block.hash()].push_back(msg);
+        ERRORLOG("block sign verify failed, addr = {}, blockhash:{}", signer, block.hash());
+        return -3;
+    }
+    std::pair<std::string, std::vector<std::string>> nodesPair;
+    MagicSingleton<VRF>::GetInstance()->getVerifyNodes(block.hash(), nodesPair);
+    if (std::find(nodesPair.second.begin(), nodesPair.second.end(), signer) == nodesPair.second.end())
+    {
+        ERRORLOG("block sign addr = {} is not a verify node of blockhash:{}", signer, block.hash());
+        return -4;
+    }
+
+    std::shared_ptr<BlockSignAggregate> ready;
+    {
+        std::unique_lock<std::shared_mutex> lck(_blockMutex);
+        auto found = _blockCnt.find(block.hash());
+        if (found == _blockCnt.end())
+        {
+            return 0;
+        }
+
+        auto &aggregate = found->second;
+        if (!aggregate.signers.insert(signer).second)
+        {
+            ERRORLOG("repeated block sign addr = {}, blockhash:{}", signer, block.hash());
+            return -5;
+        }
+        aggregate.signs.push_back(block.sign(1));
+
+        // The own block message counts as the first of the kConsensus messages
+        if (aggregate.signs.size() + 1 < global::ca::kConsensus)
+        {
+            return 0;
+        }
+        if (MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp() > aggregate.deadline)
+        {
+            ERRORLOG("Block Flow Timeout! block hash : {}", block.hash());
+            _blockCnt.erase(found);
+            return 0;
+        }
+        DEBUGLOG("Block hash : {} Recv block sign node size : {}", block.hash(), aggregate.signs.size() + 1);
+        ready = std::make_shared<BlockSignAggregate>(std::move(aggregate));
+        _blockCnt.erase(found);
     }
-    
-	lck.unlock();
 
+    MagicSingleton<TaskPool>::GetInstance()->CommitBlockTask(std::bind(&BlockStroage::_FinalizeBlock, this, ready));
 	return 0;
 }
 
+void BlockStroage::_FinalizeBlock(const std::shared_ptr<BlockSignAggregate> &aggregate)
+{
+    BlockMsg outMsg;
+    if(_ComposeEndBlockmsg(*aggregate, outMsg, true) != 0)
+    {
+        ERRORLOG("Compose blockMsg failed!");
+        return;
+    }
+
+    CBlock block;
+    block.ParseFromString(outMsg.block());
+    int ret = VerifyBlockFlowSignNode(block);
+    if(ret != 0)
+    {
+        ERRORLOG("Verify Block Flow SignNode Failed! ret : {}",ret);
+        return;
+    }
+
+    //After the verification is passed, the broadcast block is directly built
+    if(block.version() >= global::ca::kInitBlockVersion){
+        {
+            std::unique_lock<std::mutex> lck(_statusMutex);
+            if(_blockStatusMap.find(block.hash()) == _blockStatusMap.end())
+            {
+                _blockStatusMap[block.hash()] = {block.hash(), block};
+            }
+        }
+        auto NowTime = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
+        MagicSingleton<TFSbenchmark>::GetInstance()->SetByBlockHash(block.hash(), &NowTime, 2);
+        MagicSingleton<BlockMonitor>::GetInstance()->SendBroadcastAddBlock(outMsg.block(),block.height());
+        DEBUGLOG("BuildBlockBroadcastMsg successful..., block hash : {}",block.hash());
+    }else{
+        std::cout << "The version is too low. Please update the version!" << std::endl;
+    }
+}
+
 
 void BlockStroage::_BlockCheck()
 {
-    std::unique_lock<std::shared_mutex> lck(_blockMutex);
+    uint64_t nowTime = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
 
-    int64_t nowTime = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
-    const int64_t kTenSecond = (int64_t)1000000 * 10;
+    std::unique_lock<std::shared_mutex> lck(_blockMutex);
+    while (!_blockDeadlines.empty() && _blockDeadlines.top().first < nowTime)
+    {
+        auto [deadline, hash] = _blockDeadlines.top();
+        _blockDeadlines.pop();
 
-	std::vector<std::string> hashKey;
-	for(auto &item : _blockCnt)
-	{
-        CBlock temBlock;
-        temBlock.ParseFromString(item.second.at(0).block());
-        DEBUGLOG("temBlock hash : {}" , temBlock.hash());
-        uint64_t lagTime = abs(nowTime - (int64_t)temBlock.time());
-        uint32_t msgSize = item.second.size();
-        
-        if(msgSize >= global::ca::kConsensus && lagTime <= kTenSecond)
-        {
-            DEBUGLOG("Block hash : {} Recv block sign node size : {}" ,temBlock.hash(),msgSize);
-            BlockMsg outMsg;
-            if(_ComposeEndBlockmsg(item.second,outMsg,true) == 0){
-                CBlock block;
-                block.ParseFromString(outMsg.block());
-                int ret = VerifyBlockFlowSignNode(outMsg);
-                if(ret == 0){
-                    //After the verification is passed, the broadcast block is directly built
-                    if(block.version() >= global::ca::kInitBlockVersion){
-                        if(_blockStatusMap.find(block.hash()) == _blockStatusMap.end())
-                        {
-                            _blockStatusMap[block.hash()] = {block.hash(), block};
-                        }
-                        auto NowTime = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
-                        MagicSingleton<TFSbenchmark>::GetInstance()->SetByBlockHash(block.hash(), &NowTime, 2);
-                        MagicSingleton<BlockMonitor>::GetInstance()->SendBroadcastAddBlock(outMsg.block(),block.height());
-                        DEBUGLOG("BuildBlockBroadcastMsg successful..., block hash : {}",block.hash());
-                    }else{
-                        std::cout << "The version is too low. Please update the version!" << std::endl;
-                    }
-                }else{
-                    ERRORLOG("Verify Block Flow SignNode Failed! ret : {}",ret);
-                }
-            }else{
-                ERRORLOG("Compose blockMsg failed!");
-            }
-            hashKey.push_back(temBlock.hash());
-        }else if(lagTime > kTenSecond){
-            hashKey.push_back(temBlock.hash());
-            ERRORLOG("Block Flow Timeout! block hash : {}",temBlock.hash());
+        // Blocks that reached consensus are already gone from _blockCnt
+        auto found = _blockCnt.find(hash);
+        if (found != _blockCnt.end() && found->second.deadline == deadline)
+        {
+            ERRORLOG("Block Flow Timeout! block hash : {}", hash);
+            _Remove(hash);
         }
     }
-	
-    if(!hashKey.empty())
-	{
-		for (auto &hash : hashKey)
-		{
-			_Remove(hash);
-		}
-	}
-	hashKey.clear();    
 }
 
 
-int BlockStroage::_ComposeEndBlockmsg(const std::vector<BlockMsg> &msgVec, BlockMsg & outMsg , bool isVrf)
+int BlockStroage::_ComposeEndBlockmsg(const BlockSignAggregate &aggregate, BlockMsg & outMsg , bool isVrf)
 {
-    std::vector<BlockMsg> _vrfMsgVec;
+    std::vector<CSign> _vrfSigns;
     if(isVrf)
     {
-        CBlock temBlock;
-        temBlock.ParseFromString(msgVec.at(0).block());
-        Cycliclist<BlockMsg> list;
-        std::vector<BlockMsg> secondMsg = msgVec;
-        secondMsg.erase(secondMsg.begin());
-
-        for(auto &msgBlock : secondMsg)
+        const CBlock &temBlock = aggregate.block;
+        Cycliclist<CSign> list;
+        for(auto &sign : aggregate.signs)
         {
-            list.push_back(msgBlock);
+            list.push_back(sign);
         }
 
         std::string outPut , proof;
@@ -164,65 +214,42 @@ int BlockStroage::_ComposeEndBlockmsg(const std::vector<BlockMsg> &msgVec, Block
         const int signMsgcnt = global::ca::kConsensus / 2;
         auto endMsgpos = randPos - signMsgcnt;
 
-        std::vector<BlockMsg> targetMsg;
-        for (; targetMsg.size() < (global::ca::kConsensus - 1); endMsgpos++)
+        std::vector<CSign> targetSign;
+        for (; targetSign.size() < (global::ca::kConsensus - 1); endMsgpos++)
         {
-            targetMsg.push_back(list[endMsgpos]);
+            targetSign.push_back(list[endMsgpos]);
         }
 
-        if(targetMsg.size() != (global::ca::kConsensus - 1))
+        if(targetSign.size() != (global::ca::kConsensus - 1))
         {
-            std::cout << "size" << targetMsg.size() << std::endl;
-            ERRORLOG("target lazy weight, size = {}",targetMsg.size());
+            std::cout << "size" << targetSign.size() << std::endl;
+            ERRORLOG("target lazy weight, size = {}",targetSign.size());
             return -3;
         }
     
-        for(auto & msgTmg : targetMsg)
+        for(auto & sign : targetSign)
         {
-            _vrfMsgVec.push_back(msgTmg);
+            _vrfSigns.push_back(sign);
         }
     }    
 
-    CBlock endBlock;
-    endBlock.ParseFromString(msgVec[0].block()); 
-	for(auto &msg : _vrfMsgVec)
+    CBlock endBlock = aggregate.block;
+	for(auto &vrfSign : _vrfSigns)
 	{   
-        CBlock block;
-        block.ParseFromString(msg.block());
-
-        if(block.sign_size() != 2)
-        {
-            continue;
-        }
-        else
-        {
-
-            CSign * sign  = endBlock.add_sign();
-            sign->set_pub(block.sign(1).pub());
-            sign->set_sign(block.sign(1).sign());
-            INFOLOG("rand block sign = {}",GenerateAddr(block.sign(1).pub()));
-
-        }
+        CSign * sign  = endBlock.add_sign();
+        sign->set_pub(vrfSign.pub());
+        sign->set_sign(vrfSign.sign());
+        INFOLOG("rand block sign = {}",GenerateAddr(vrfSign.pub()));
     }
-    std::string addr = GenerateAddr(endBlock.sign(0).pub());
     outMsg.set_block(endBlock.SerializeAsString());
     return 0;       
 }
 void BlockStroage::_Remove(const std::string &hash)
 {
-
-    for(auto iter = _blockCnt.begin(); iter != _blockCnt.end();)
-	{
-		if (iter->first == hash)
-		{
-			iter = _blockCnt.erase(iter);
-			DEBUGLOG("BlockStroage::Remove  _blockCnt hash:{}", hash);
-		}
-		else
-		{
-			iter++;
-		}
-	}
+    if (_blockCnt.erase(hash) != 0)
+    {
+        DEBUGLOG("BlockStroage::Remove  _blockCnt hash:{}", hash);
+    }
 }
 
 std::shared_future<RetType> BlockStroage::GetPrehash(const uint64_t height)
@@ -335,18 +362,14 @@ RetType BlockStroage::_SeekPreHashThread(uint64_t seekHeight)
             DEBUGLOG("GetBlockTop fail!!!");
             return {"",0};
         }
-        std::vector<Node> nodelist = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-
-        for (const auto &node : nodelist)
+        auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+        std::vector<std::string> nodeAddrs;
+        nodeAddrs.reserve(peerTable->byAddress.size());
+        for (const auto &[addr, node] : peerTable->byAddress)
         {
-            int ret = VerifyBonusAddr(node.address);
-
-            int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-            if (stakeTime > 0 && ret == 0)
-            {
-                pledgeAddr.push_back(node.address);
-            }
+            nodeAddrs.push_back(addr);
         }
+        MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, pledgeAddr);
     }
     std::vector<std::string> sendNodeIds;
     if (GetPrehashFindNode(global::ca::KMinSyncQualNodes, seekHeight, pledgeAddr, sendNodeIds) != 0)
@@ -848,11 +871,8 @@ int HandleBlockStatusMsg(const std::shared_ptr<BlockStatus> &msg, const MsgData
     return 0;
 }
 
-int BlockStroage::VerifyBlockFlowSignNode(const BlockMsg & blockMsg)
+int BlockStroage::VerifyBlockFlowSignNode(const CBlock & block)
 {
-    CBlock block;
-    block.ParseFromString(blockMsg.block());
-
 	// Verify Block flow verifies the signature of the node
     std::pair<std::string, std::vector<std::string>> nodesPair;
     
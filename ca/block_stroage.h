@@ -12,6 +12,8 @@
 #include "ca/block_monitor.h"
 #include "utils/magic_singleton.h"
 #include "utils/vrf.hpp"
+#include <set>
+#include <queue>
 #include <future>
 #include <unordered_map>
 #include <shared_mutex>
@@ -38,6 +40,17 @@ struct BlockStatusWrapper
 	std::map<std::string, Vrf> vrfMap = {};
 	std::map<std::string, Vrf> txvrfMap = {};
 };
+/**
+ * @brief       Signatures collected for one block of this node, the block is parsed once
+ *              when it is added and every signed copy only contributes its signer
+ */
+struct BlockSignAggregate
+{
+	CBlock block;
+	std::vector<CSign> signs = {};
+	std::set<std::string> signers = {};
+	uint64_t deadline = 0;
+};
 class BlockStroage
 {
 public:
@@ -180,12 +193,19 @@ private:
 	/**
 	 * @brief       
 	 * 
-	 * @param       msgVec: 
+	 * @param       aggregate: 
 	 * @param		outMsg:
 	 * @param		isVrf
 	 * @return		int
 	 */
-	int _ComposeEndBlockmsg(const std::vector<BlockMsg> &msgVec, BlockMsg & outMsg , bool isVrf);
+	int _ComposeEndBlockmsg(const BlockSignAggregate &aggregate, BlockMsg & outMsg , bool isVrf);
+
+	/**
+	 * @brief       Compose, verify and broadcast a block that has reached kConsensus signatures
+	 * 
+	 * @param       aggregate: 
+	 */
+	void _FinalizeBlock(const std::shared_ptr<BlockSignAggregate> &aggregate);
 
 	/**
 	 * @brief       
@@ -204,10 +224,10 @@ private:
 	/**
 	 * @brief       
 	 * 
-	 * @param       blockMsg: 
+	 * @param       block: 
 	 * @return      int 
 	 */
-	int VerifyBlockFlowSignNode(const BlockMsg & blockMsg);
+	int VerifyBlockFlowSignNode(const CBlock & block);
 
 	/**
 	 * @brief       
@@ -229,7 +249,9 @@ private:
     friend std::string PrintCache(int where);
 	CTimer _blockTimer;
 	mutable std::shared_mutex _blockMutex;
-	std::map<std::string , std::vector<BlockMsg>> _blockCnt;
+	std::map<std::string, BlockSignAggregate> _blockCnt;
+	// (deadline, block hash), smallest deadline on top
+	std::priority_queue<std::pair<uint64_t, std::string>, std::vector<std::pair<uint64_t, std::string>>, std::greater<>> _blockDeadlines;
 
 	mutable std::shared_mutex _prehashMutex;
 	std::map<uint64_t, std::shared_future<RetType>> _preHashMap;
@@ -43,6 +43,7 @@
 #include "google/protobuf/util/json_util.h"
 
 #include "db/db_api.h"
+#include "db/db_format.h"
 #include "ca/evm/evm_manager.h"
 #include "api/interface/http_api.h"
 #include "../api/rpc_error.h"
@@ -73,6 +74,8 @@ int CaStartTimerTask()
 
     MagicSingleton<DoubleSpendCache>::GetInstance();
 
+    MagicSingleton<DBFormatMigration>::GetInstance()->Start();
+
     return 0;
 }
 
@@ -144,6 +147,8 @@ void CaCleanup()
     MagicSingleton<CheckBlocks>::GetInstance()->StopTimer();
     DEBUGLOG("start clean VRF" )
     MagicSingleton<VRF>::GetInstance()->StopTimer();
+    DEBUGLOG("start clean DBFormatMigration")
+    MagicSingleton<DBFormatMigration>::GetInstance()->Stop();
     DEBUGLOG("sleep")
 
     sleep(5);
@@ -12,6 +12,7 @@
 
 #include "include/logging.h"
 #include "common/global_data.h"
+#include "db/cache.h"
 
 CheckBlocks::CheckBlocks()
 {
@@ -46,18 +47,14 @@ void CheckBlocks::StartTimer()
 //get stake and invested addr
 int CheckBlocks::GetPledgeAddr(DBReadWriter& dbReader, std::vector<std::string>& pledgeAddr)
 {
-    std::vector<Node> nodelist = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-
-    for (const auto &node : nodelist)
+    auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+    std::vector<std::string> nodeAddrs;
+    nodeAddrs.reserve(peerTable->byAddress.size());
+    for (const auto &[addr, node] : peerTable->byAddress)
     {
-        int ret = VerifyBonusAddr(node.address);
-
-        int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-        if (stakeTime > 0 && ret == 0)
-        {
-            pledgeAddr.push_back(node.address);
-        }
+        nodeAddrs.push_back(addr);
     }
+    MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, pledgeAddr);
 
     // std::vector<std::string> stakeAddr;
     // auto status = dbReader.GetStakeAddress(stakeAddr);
@@ -1,11 +1,17 @@
 #include "ca/checker.h"
 #include "utils/contract_utils.h"
 
+#include <set>
+#include <unordered_set>
+
 bool Checker::CheckConflict(const CTransaction &tx, const std::vector<TransactionEntity>  &cache)
 {
+    // Index the outpoints of tx once, then each cached transaction costs one lookup per input
+    OutpointIndex index;
+    index.Add(tx);
     for(const auto& txEntity : cache)
     {
-        if(CheckConflict(txEntity.GetTransaction(), tx))
+        if(index.CheckConflict(txEntity.GetTransaction()))
         {
             return true;
         }
@@ -16,16 +22,18 @@ bool Checker::CheckConflict(const CTransaction &tx, const std::vector<Transactio
 
 bool Checker::CheckConflict(const CTransaction &tx, const std::set<CBlock, compator::BlockTimeAscending> &blocks)
 {
+    if(GetTransactionType(tx) != kTransactionType_Tx)
+    {
+        return false;
+    }
+
+    OutpointIndex index;
+    index.Add(tx);
     for (const auto& block : blocks)
     {
         for(const auto& curTx : block.txs())
         {
-            if(GetTransactionType(tx) != kTransactionType_Tx)
-            {
-                continue;
-            }
-
-            if(CheckConflict(curTx, tx) == true)
+            if(index.CheckConflict(curTx))
             {
                 return true;
             }
@@ -62,6 +70,23 @@ bool Checker::CheckConflict(const CBlock &block, const std::set<CBlock, compator
 
 bool Checker::CheckConflict(const CBlock &block1, const CBlock &block2, std::string* txHashPtr)
 {
+    std::unordered_set<std::string> spent;
+    for(const auto& tx2 : block2.txs())
+    {
+        if(GetTransactionType(tx2) != kTransactionType_Tx)
+        {
+            continue;
+        }
+        for (auto& outpoint : GetOutpoints(tx2))
+        {
+            spent.insert(std::move(outpoint));
+        }
+    }
+    if (spent.empty())
+    {
+        return false;
+    }
+
     for(const auto& tx1 : block1.txs())
     {
         if(GetTransactionType(tx1) != kTransactionType_Tx)
@@ -69,24 +94,20 @@ bool Checker::CheckConflict(const CBlock &block1, const CBlock &block2, std::str
             continue;
         }
 
-        for(const auto& tx2 : block2.txs())
+        for (const auto& outpoint : GetOutpoints(tx1))
         {
-            if(GetTransactionType(tx2) != kTransactionType_Tx)
+            if (spent.find(outpoint) == spent.end())
             {
                 continue;
             }
-
-            if(CheckConflict(tx1, tx2) == true)
+            if(txHashPtr != NULL)
             {
-                if(txHashPtr != NULL)
-                {
-                    CTransaction copyTx = tx1;
-                    copyTx.clear_hash();
-                    copyTx.clear_verifysign();
-                    *txHashPtr = Getsha256hash(copyTx.SerializeAsString());
-                }
-                return true;
+                CTransaction copyTx = tx1;
+                copyTx.clear_hash();
+                copyTx.clear_verifysign();
+                *txHashPtr = Getsha256hash(copyTx.SerializeAsString());
             }
+            return true;
         }
     }
 
@@ -95,29 +116,21 @@ bool Checker::CheckConflict(const CBlock &block1, const CBlock &block2, std::str
 
 bool Checker::CheckConflict(const CTransaction &tx1, const CTransaction &tx2)
 {
-    std::vector<std::string> vec1;
-    for(const auto& vin : tx1.utxo().vin())
+    std::vector<std::string> outpoints1 = GetOutpoints(tx1);
+    std::vector<std::string> outpoints2 = GetOutpoints(tx2);
+    if (outpoints1.size() > outpoints2.size())
     {
-        for (auto & prevout : vin.prevout())
-        {
-            vec1.push_back(prevout.hash() + "_" + GenerateAddr(vin.vinsign().pub()));
-        }
+        outpoints1.swap(outpoints2);
     }
-
-    std::vector<std::string> vec2;
-    for(const auto& vin : tx2.utxo().vin())
+    std::unordered_set<std::string> spent(outpoints1.begin(), outpoints1.end());
+    for (const auto& outpoint : outpoints2)
     {
-        for (auto & prevout : vin.prevout())
+        if (spent.find(outpoint) != spent.end())
         {
-            vec2.push_back(prevout.hash() + "_" + GenerateAddr(vin.vinsign().pub()));
+            return true;
         }
     }
-
-    std::vector<std::string> vecIntersection;
-    std::sort(vec1.begin(), vec1.end());
-    std::sort(vec2.begin(), vec2.end());
-    std::set_intersection(vec1.begin(), vec1.end(), vec2.begin(), vec2.end(), std::back_inserter(vecIntersection));
-    return !vecIntersection.empty();
+    return false;
 }
 
 void Checker::CheckConflict(const CBlock &block, std::vector<CTransaction>& doubleSpentTransactions)
@@ -150,4 +163,100 @@ void Checker::CheckConflict(const CBlock &block, std::vector<CTransaction>& doub
             doubleSpentTransactions.insert(doubleSpentTransactions.end(), iter.second.begin()+1, iter.second.end());
         }
     }
+}
+
+std::vector<std::pair<int, int>> Checker::FindConflicts(const CBlock &block1, const CBlock &block2)
+{
+    std::unordered_map<std::string, std::vector<int>> spentBy;
+    for (int i = 0; i < block1.txs_size(); ++i)
+    {
+        const auto& tx1 = block1.txs(i);
+        if(GetTransactionType(tx1) != kTransactionType_Tx)
+        {
+            continue;
+        }
+        for (auto& outpoint : GetOutpoints(tx1))
+        {
+            spentBy[std::move(outpoint)].push_back(i);
+        }
+    }
+
+    std::set<std::pair<int, int>> conflicts;
+    for (int j = 0; j < block2.txs_size() && !spentBy.empty(); ++j)
+    {
+        const auto& tx2 = block2.txs(j);
+        if(GetTransactionType(tx2) != kTransactionType_Tx)
+        {
+            continue;
+        }
+        for (const auto& outpoint : GetOutpoints(tx2))
+        {
+            auto found = spentBy.find(outpoint);
+            if (found == spentBy.end())
+            {
+                continue;
+            }
+            for (int i : found->second)
+            {
+                conflicts.emplace(i, j);
+            }
+        }
+    }
+    return {conflicts.begin(), conflicts.end()};
+}
+
+std::vector<std::string> Checker::GetOutpoints(const CTransaction &tx)
+{
+    std::vector<std::string> outpoints;
+    for(const auto& vin : tx.utxo().vin())
+    {
+        std::string owner = "_" + GenerateAddr(vin.vinsign().pub());
+        for (auto & prevout : vin.prevout())
+        {
+            outpoints.push_back(prevout.hash() + owner);
+        }
+    }
+    return outpoints;
+}
+
+void Checker::OutpointIndex::Add(const CTransaction &tx)
+{
+    for (auto& outpoint : GetOutpoints(tx))
+    {
+        _spentBy.emplace(std::move(outpoint), tx.hash());
+    }
+}
+
+void Checker::OutpointIndex::Remove(const CTransaction &tx)
+{
+    for (const auto& outpoint : GetOutpoints(tx))
+    {
+        auto found = _spentBy.find(outpoint);
+        if (found != _spentBy.end() && found->second == tx.hash())
+        {
+            _spentBy.erase(found);
+        }
+    }
+}
+
+void Checker::OutpointIndex::Clear()
+{
+    _spentBy.clear();
+}
+
+bool Checker::OutpointIndex::CheckConflict(const CTransaction &tx, std::string* conflictHash) const
+{
+    for (const auto& outpoint : GetOutpoints(tx))
+    {
+        auto found = _spentBy.find(outpoint);
+        if (found != _spentBy.end())
+        {
+            if (conflictHash != nullptr)
+            {
+                *conflictHash = found->second;
+            }
+            return true;
+        }
+    }
+    return false;
 }
\ No newline at end of file
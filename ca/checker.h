@@ -11,6 +11,8 @@
 
 #include <vector>
 #include <map>
+#include <string>
+#include <unordered_map>
 
 #include "ca/transaction.h"
 #include "ca/block_helper.h"
@@ -80,5 +82,61 @@ namespace Checker
      * @param       doubleSpentTransactions: 
      */
     void CheckConflict(const CBlock &block, std::vector<CTransaction>& doubleSpentTransactions);
+
+    /**
+     * @brief       Every pair of transactions of the two blocks spending the same outpoint, found in one pass
+     * 
+     * @param       block1: 
+     * @param       block2: 
+     * @return      std::vector<std::pair<int, int>> indexes into block1.txs() and block2.txs(), in ascending order
+     */
+    std::vector<std::pair<int, int>> FindConflicts(const CBlock &block1, const CBlock &block2);
+
+    /**
+     * @brief       The outpoints spent by the transaction, as prevout hash and owner address
+     * 
+     * @param       tx: 
+     * @return      std::vector<std::string> 
+     */
+    std::vector<std::string> GetOutpoints(const CTransaction &tx);
+
+    /**
+     * @brief       Outpoints spent by a set of pending transactions, kept up to date as
+     *              transactions enter and leave the set so a conflict check costs one
+     *              lookup per input
+     */
+    class OutpointIndex
+    {
+    public:
+        /**
+         * @brief       
+         * 
+         * @param       tx: 
+         */
+        void Add(const CTransaction &tx);
+
+        /**
+         * @brief       
+         * 
+         * @param       tx: 
+         */
+        void Remove(const CTransaction &tx);
+
+        void Clear();
+
+        /**
+         * @brief       
+         * 
+         * @param       tx: 
+         * @param       conflictHash: hash of the indexed transaction spending the same outpoint
+         * @return      true 
+         * @return      false 
+         */
+        bool CheckConflict(const CTransaction &tx, std::string* conflictHash = nullptr) const;
+
+    private:
+        // Outpoint to the hash of the transaction spending it
+        std::unordered_map<std::string, std::string> _spentBy;
+    };
 };
 #endif
\ No newline at end of file
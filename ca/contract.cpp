@@ -61,20 +61,9 @@ int ExecuteByEvmone(const evmc_message &msg, EvmHost &host)
 {
     DEBUGLOG("-----t: {}",host.tx_context.block_timestamp);
     DEBUGLOG("-----b: {}", evm_utils::EvmcUint256beToUint32(host.tx_context.block_prev_randao));
-    struct evmc_vm* pvm = evmc_create_evmone();
-    if (!pvm)
+    auto async_execute = [](EvmHost& host, evmc_revision rev, const evmc_message& msg, const uint8_t* code, size_t code_size)
     {
-        return -1;
-    }
-    if (!evmc_is_abi_compatible(pvm))
-    {
-        return -2;
-    }
-    evmc::VM vm{pvm};
-
-    auto async_execute = [&vm](EvmHost& host, evmc_revision rev, const evmc_message& msg, const uint8_t* code, size_t code_size)
-    {
-        return vm.execute(host, rev, msg, code, code_size);
+        return Evmone::ExecuteCode(host, rev, msg, {code, code_size});
     };
 
     DEBUGLOG("555Output: {}", evmc::hex({host.code.data(), host.code.size()}) );
@@ -226,10 +215,11 @@ int Evmone::RPC_CallContract(const std::string &from, const std::string &strInpu
 
 void Evmone::GetStorage(const EvmHost &host, nlohmann::json &jStorage, std::set<evmc::address> &dirtyContract)
 {
-    for(const auto &account : host.accounts)
+    for(auto &account : host.accounts)
     {
         std::pair<std::string, std::string> rootHash;
         std::map<std::string, std::string> dirtyhash;
+        account.second.FlushStorage();
         std::shared_ptr<Trie> root = account.second.storageRoot;
         root->Save();
         root->GetBlockStorage(rootHash, dirtyhash);
@@ -1,90 +1,106 @@
 #include "ca/double_spend_cache.h"
 
+#include <set>
+#include <functional>
+
+uint32_t DoubleSpendCache::_ShardIndex(const std::string &utxoHash)
+{
+	return std::hash<std::string>{}(utxoHash) % kShardCount;
+}
+
 int DoubleSpendCache::AddFromAddr(const std::pair<std::string,DoubleSpendCache::doubleSpendsuc> &usings)
 {
-    std::unique_lock<std::mutex> lck(_doubleSpendMutex);
-	auto it =  _pending.find(usings.first);
-	if(it != _pending.end())
+	// Lock every shard touched by the transaction in index order, so that the
+	// check and the insertion are atomic without risking a lock order inversion
+	std::set<uint32_t> shardIndexes;
+	for(auto & utxo : usings.second.utxoVec)
 	{
+		shardIndexes.insert(_ShardIndex(utxo));
+	}
+	std::vector<std::unique_lock<std::mutex>> locks;
+	locks.reserve(shardIndexes.size());
+	for(auto index : shardIndexes)
+	{
+		locks.emplace_back(_shards[index].mutex);
+	}
 
-		std::vector<std::string> usingsUtxo(usings.second.utxoVec.begin(), usings.second.utxoVec.end());
-		std::vector<std::string> pendingsUtxo(it->second.utxoVec.begin(), it->second.utxoVec.end());
-		std::sort(usingsUtxo.begin(),usingsUtxo.end());
-		std::sort(pendingsUtxo.begin(),pendingsUtxo.end());
-
-		std::vector<std::string> vIntersection;
-		std::set_intersection(usingsUtxo.begin(), usingsUtxo.end(), pendingsUtxo.begin(), pendingsUtxo.end(), std::back_inserter(vIntersection));
-
-		for(auto & diff : vIntersection)
+	uint64_t now = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
+	for(auto & utxo : usings.second.utxoVec)
+	{
+		auto & shard = _shards[_ShardIndex(utxo)];
+		auto found = shard.spent.find(utxo);
+		if(found != shard.spent.end() && found->second.expire >= now)
 		{
-			ERRORLOG("utxo:{} is using!",diff);
-			std::cout << "utxo:" << diff << "is using!\n";
+			ERRORLOG("utxo:{} is using by tx:{} of {}!", utxo, found->second.txHash, found->second.owner);
+			std::cout << "utxo:" << utxo << "is using!\n";
 			return -1;
 		}
-
-	}else{
-		_pending.insert(usings);
 	}
 
+	uint64_t expire = usings.second.time + kExpireTime;
+	for(auto & utxo : usings.second.utxoVec)
+	{
+		auto & shard = _shards[_ShardIndex(utxo)];
+		shard.spent[utxo] = {usings.first, usings.second.txHash, expire};
+		shard.expiry.emplace(expire, utxo);
+	}
 	return 0;
 }
 
-
-void DoubleSpendCache::Remove(const uint64_t& txtimeKey)
+bool DoubleSpendCache::IsPending(const std::string &utxoHash)
 {
-
-	for(auto iter = _pending.begin(); iter != _pending.end();)
-	{
-		if (iter->second.time == txtimeKey)
-		{
-			iter = _pending.erase(iter);
-		}
-		else
-		{
-			iter++;
-		}
-	}  
-	
+	auto & shard = _shards[_ShardIndex(utxoHash)];
+	std::unique_lock<std::mutex> lck(shard.mutex);
+	auto found = shard.spent.find(utxoHash);
+	return found != shard.spent.end() && found->second.expire >= MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
 }
 
 void DoubleSpendCache::CheckLoop()
 {
-	std::unique_lock<std::mutex> lck(_doubleSpendMutex);
-	std::vector<uint64_t> toRemove;
-	for(auto & item : _pending)
+	uint64_t now = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
+	for(auto & shard : _shards)
 	{
-	    const int64_t kTenSecond = (int64_t)1000000 * 30;
-		uint64_t time = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
-		if(item.second.time + kTenSecond < time)
+		std::unique_lock<std::mutex> lck(shard.mutex);
+		while(!shard.expiry.empty() && shard.expiry.top().first < now)
 		{
-			toRemove.push_back(item.second.time);
+			auto [expire, utxo] = shard.expiry.top();
+			shard.expiry.pop();
+			// The utxo may have been reserved again after a block released it
+			auto found = shard.spent.find(utxo);
+			if(found != shard.spent.end() && found->second.expire == expire)
+			{
+				shard.spent.erase(found);
+			}
 		}
 	}
-
-	for(auto & txtimeKey: toRemove)
-	{
-		Remove(txtimeKey);
-	}
 }
 
-
-
 void DoubleSpendCache::Detection(const CBlock & block)
 {
-	std::unique_lock<std::mutex> lck(_doubleSpendMutex);
-	std::vector<uint64_t> toRemove;
 	for(auto & tx : block.txs())
-	{	
-		auto it = _pending.find(tx.utxo().owner(0));
-		if(it != _pending.end() && tx.time() == it->second.time)
-		{	
-			toRemove.push_back(it->second.time);
-			DEBUGLOG("Remove pending txhash : {}",tx.hash());
+	{
+		for(auto & vin : tx.utxo().vin())
+		{
+			for(auto & prevout : vin.prevout())
+			{
+				auto & shard = _shards[_ShardIndex(prevout.hash())];
+				std::unique_lock<std::mutex> lck(shard.mutex);
+				if(shard.spent.erase(prevout.hash()) != 0)
+				{
+					DEBUGLOG("Remove pending utxo : {}, txhash : {}", prevout.hash(), tx.hash());
+				}
+			}
 		}
 	}
+}
 
-	for(auto & txtimeKey: toRemove)
+uint64_t DoubleSpendCache::GetSize()
+{
+	uint64_t size = 0;
+	for(auto & shard : _shards)
 	{
-		Remove(txtimeKey);
+		std::unique_lock<std::mutex> lck(shard.mutex);
+		size += shard.spent.size();
 	}
-}
\ No newline at end of file
+	return size;
+}
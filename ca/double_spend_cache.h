@@ -6,13 +6,19 @@
  * @copyright   tfsc
  * *****************************************************************************
  */
+#ifndef _DOUBLE_SPEND_CACHE_H_
+#define _DOUBLE_SPEND_CACHE_H_
+
+#include <array>
+#include <queue>
+#include <unordered_map>
 
 #include "ca/block_stroage.h"
 #include "utils/tfs_bench_mark.h"
 #include "common/global_data.h"
 /**
- * @brief       
- * 
+ * @brief       Utxos spent by transactions this node has created but not yet seen in a
+ *              block, sharded by utxo hash so that checks and removals cost O(inputs)
  */
 class DoubleSpendCache
 {
@@ -30,6 +36,7 @@ public:
     {
         uint64_t time;
         std::vector<std::string> utxoVec;
+        std::string txHash;
     };
     
     /**
@@ -39,29 +46,60 @@ public:
     void StopTimer(){_timer.Cancel();}
 
     /**
-     * @brief       
+     * @brief       Reserve the utxos of a new transaction, fails without reserving any
+     *              of them if one is already spent by another pending transaction
      * 
-     * @param       usings: 
-     * @return      int 
+     * @param       usings: owner address and the spent utxos
+     * @return      int 0 success, -1 a utxo is in use
      */
     int AddFromAddr(const std::pair<std::string,DoubleSpendCache::doubleSpendsuc> &usings);
 
-
     /**
      * @brief       
      * 
+     * @param       utxoHash: 
+     * @return      true the utxo is spent by a pending transaction
+     */
+    bool IsPending(const std::string &utxoHash);
+
+    /**
+     * @brief       Drop expired reservations
+     * 
      */
     void CheckLoop();
-    void Remove(const uint64_t& txtimeKey);
+
+    /**
+     * @brief       Drop the reservations of every utxo spent in the block
+     * 
+     * @param       block: 
+     */
     void Detection(const CBlock & block);
 
+    uint64_t GetSize();
 
+    static const uint32_t kShardCount = 16;
+    static const uint64_t kExpireTime = 30ull * 1000000;
 
 private:
+    struct SpentEntry
+    {
+        std::string owner;
+        std::string txHash;
+        uint64_t expire;
+    };
 
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, SpentEntry> spent;
+        // (expire, utxo hash), earliest expiry on top
+        std::priority_queue<std::pair<uint64_t, std::string>, std::vector<std::pair<uint64_t, std::string>>, std::greater<>> expiry;
+    };
 
-    CTimer _timer;
-	std::mutex _doubleSpendMutex;
-    std::map<std::string,DoubleSpendCache::doubleSpendsuc> _pending;
+    static uint32_t _ShardIndex(const std::string &utxoHash);
 
+    CTimer _timer;
+    std::array<Shard, kShardCount> _shards;
 };
+
+#endif
@@ -35,27 +35,43 @@ void EvmHost::record_account_access(const evmc::address &addr) const
     auto found = accounts.find(addr);
     if (found != accounts.end())
     {
-        if (!found->second.code.empty())
+        if (found->second.code != nullptr && !found->second.code->code.empty())
         {
             return;
         }
     }
 
-    DBReader db_reader;
     std::string contractAddress = evm_utils::EvmAddrToString(addr);
 
-    evmc::bytes code;
-    if (evm_utils::GetContractCode(contractAddress, code) < 0)
+    evm_utils::ContractCodePtr code;
+    int ret = evm_utils::GetContractCode(contractAddress, code);
+    if (ret < 0)
     {
         ERRORLOG("fail to get contract code");
         return;
     }
-    if (!code.empty())
+    if (ret == 0)
     {
-        accounts[addr].set_code(code);
+        accounts[addr].set_code(std::move(code));
     }
 }
 
+uint64_t EvmHost::GetDBBalance(const std::string &addr) const
+{
+    auto found = dbBalances.find(addr);
+    if (found != dbBalances.end())
+    {
+        return found->second;
+    }
+    uint64_t balance = 0;
+    if (GetBalanceByUtxo(addr, balance) != 0)
+    {
+        return 0;
+    }
+    dbBalances.emplace(addr, balance);
+    return balance;
+}
+
 int EvmHost::getContractTransfer(uint64_t amount, const std::string &fromAddr, const std::string &toAddr,
                                  std::vector<TransferInfo> &transferInfo)
 {
@@ -84,8 +100,7 @@ int EvmHost::getContractTransfer(uint64_t amount, const std::string &fromAddr, c
                     }
                     amount = amount - iter.amount;
                     iter.amount = 0;
-                    uint64_t balance = 0;
-                    GetBalanceByUtxo(fromAddr, balance);
+                    uint64_t balance = GetDBBalance(fromAddr);
                     DBspendMap[fromAddr] += amount;
                     if (balance < DBspendMap[fromAddr])
                     {
@@ -116,28 +131,7 @@ evmc::bytes32 EvmHost::get_storage(const evmc::address &addr, const evmc::bytes3
     if (account_iter == accounts.end())
         return {};
 
-    const auto storage_iter = account_iter->second.storage.find(key);
-    if (storage_iter != account_iter->second.storage.end())
-    {
-        std::string k = evmc::hex({key.bytes, sizeof(key.bytes)});
-        auto mptv = account_iter->second.storageRoot->Get(k);
-        if (!mptv.empty())
-        {
-            return evmc::from_hex<evmc::bytes32>(mptv.c_str()).value_or(evmc::bytes32{});
-        }
-
-        return storage_iter->second.value;
-    }
-    else
-    {
-        std::string k = evmc::hex({key.bytes, sizeof(key.bytes)});
-        auto value = account_iter->second.storageRoot->Get(k);
-        if (!value.empty())
-        {
-            return evmc::from_hex<evmc::bytes32>(value.c_str()).value_or(evmc::bytes32{});
-        }
-    }
-    return {};
+    return account_iter->second.LoadStorage(key).value;
 }
 
 evmc_storage_status
@@ -145,62 +139,31 @@ EvmHost::set_storage(const evmc::address &addr, const evmc::bytes32 &key, const
 {
     record_account_access(addr);
 
-    auto &old = accounts[addr].storage[key];
-
-    evmc_storage_status status{};
-    std::string mptk = evmc::hex({key.bytes, sizeof(key.bytes)});
-    auto mptv = accounts[addr].storageRoot->Get(mptk);
+    auto &slot = accounts[addr].LoadStorage(key);
 
-    if (!mptv.empty())
+    // The statuses are the ones this host has always reported, gas accounting depends on them
+    if (slot.present)
     {
-        old.value = evmc::from_hex<evmc::bytes32>(mptv.c_str()).value_or(evmc::bytes32{});
-        if (old.value != value)
+        if (slot.value != value)
         {
-            accounts[addr].storageRoot->Update(evmc::hex({key.bytes, sizeof(key.bytes)}),
-                                               evmc::hex({value.bytes, sizeof(value.bytes)}));
+            slot.value = value;
+            slot.dirty = true;
         }
-        old.dirty = true;
-        status = EVMC_STORAGE_ADDED;
-        return status;
-    }
-    else
-    {
-        std::string mptKey = evmc::hex({key.bytes, sizeof(key.bytes)});
-        std::string mptValue = evmc::hex({value.bytes, sizeof(value.bytes)});
-        accounts[addr].storageRoot->Update(mptKey, mptValue);
+        return EVMC_STORAGE_ADDED;
     }
 
-    if (old.value == value)
-    {
-        return EVMC_STORAGE_ASSIGNED;;
-    }
-    if (!old.dirty)
-    {
-        old.dirty = true;
-        if (!old.value)
-            status = EVMC_STORAGE_ADDED;
-        else if (value)
-            status = EVMC_STORAGE_MODIFIED;
-        else
-            status = EVMC_STORAGE_DELETED;
-    }
-    else
-        status = EVMC_STORAGE_ASSIGNED;
-
-    old.value = value;
-    return status;
+    slot.present = true;
+    slot.dirty = true;
+    slot.value = value;
+    return value ? EVMC_STORAGE_ADDED : EVMC_STORAGE_ASSIGNED;
 }
 
 evmc::uint256be EvmHost::get_balance(const evmc::address &addr) const noexcept
 {
     record_account_access(addr);
 
-    uint64_t amount = 0;
     auto Addr = evm_utils::EvmAddrToString(addr);
-    if (GetBalanceByUtxo(Addr, amount) != 0)
-    {
-        amount = 0;
-    }
+    uint64_t amount = GetDBBalance(Addr);
 
     for (auto &iter : coin_transferrings)
     {
@@ -232,17 +195,21 @@ size_t EvmHost::get_code_size(const evmc::address &addr) const noexcept
         DEBUGLOG("can't find code of address {}", evm_utils::EvmAddrToString(addr));
         return 0;
     }
+    if (it->second.code == nullptr)
+    {
+        return 0;
+    }
 
-    return it->second.code.size();
+    return it->second.code->code.size();
 }
 
 evmc::bytes32 EvmHost::get_code_hash(const evmc::address &addr) const noexcept
 {
     record_account_access(addr);
     const auto it = accounts.find(addr);
-    if (it == accounts.end())
+    if (it == accounts.end() || it->second.code == nullptr)
         return {};
-    return it->second.codehash;
+    return it->second.code->hash;
 }
 
 size_t EvmHost::copy_code(const evmc::address &addr, size_t code_offset, uint8_t *buffer_data,
@@ -250,10 +217,10 @@ size_t EvmHost::copy_code(const evmc::address &addr, size_t code_offset, uint8_t
 {
     record_account_access(addr);
     const auto it = accounts.find(addr);
-    if (it == accounts.end())
+    if (it == accounts.end() || it->second.code == nullptr)
         return 0;
 
-    const auto &code = it->second.code;
+    const auto &code = it->second.code->code;
 
     if (code_offset >= code.size())
         return 0;
@@ -269,6 +236,7 @@ bool EvmHost::selfdestruct(const evmc::address &addr, const evmc::address &benef
 {
     record_account_access(addr);
     recorded_selfdestructs.push_back({addr, beneficiary});
+    MagicSingleton<evm_utils::ContractCodeCache>::GetInstance()->Invalidate(evm_utils::EvmAddrToString(addr));
 
     std::string fromAddr = evm_utils::EvmAddrToString(addr);
     std::string toAddr = evm_utils::EvmAddrToString(beneficiary);
@@ -381,12 +349,16 @@ evmc::Result EvmHost::call(const evmc_message &msg) noexcept
 
 
     std::string contractAddress = evm_utils::EvmAddrToString(msg.code_address);
-    evmc::bytes code;
+    evm_utils::ContractCodePtr code;
     bool newlyCreatedContract = false;
     auto codeFound = createdContract.find(contractAddress);
     if (codeFound != createdContract.end())
     {
-        code = evm_utils::StringTobytes(codeFound->second);
+        code = accounts[msg.code_address].code;
+        if (code == nullptr)
+        {
+            code = evm_utils::MakeContractCode(evm_utils::StringTobytes(codeFound->second));
+        }
         newlyCreatedContract = true;
     }
     else
@@ -403,7 +375,7 @@ evmc::Result EvmHost::call(const evmc_message &msg) noexcept
         }
         else
         {
-            if (code.empty())
+            if (code->code.empty())
             {
                 ERRORLOG("contract code is empty");
                 return evmc::Result{evmc_failure_result};
@@ -428,18 +400,7 @@ evmc::Result EvmHost::call(const evmc_message &msg) noexcept
     {
         DEBUGLOG("EVMC_DELEGATECALL:");
     }
-    struct evmc_vm *pvm = evmc_create_evmone();
-    if (!pvm)
-    {
-        return evmc::Result{evmc_failure_result};
-    }
-    if (!evmc_is_abi_compatible(pvm))
-    {
-        return evmc::Result{evmc_failure_result};
-    }
-    evmc::VM vm{pvm};
-
-    evmc::Result re = vm.execute(*this, EVMC_MAX_REVISION, msg, code.data(), code.size());
+    evmc::Result re = Evmone::ExecuteCode(*this, EVMC_MAX_REVISION, msg, code->code);
     DEBUGLOG("ContractAddress: {} , Result: {}", contractAddress, re.status_code);
     if (re.status_code != EVMC_SUCCESS)
     {
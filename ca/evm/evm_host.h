@@ -126,6 +126,11 @@ public:
 
     void record_account_access(const evmc::address &addr) const;
 
+    // Balance of an address in the database, read once per host
+    uint64_t GetDBBalance(const std::string &addr) const;
+
+    mutable std::unordered_map<std::string, uint64_t> dbBalances;
+
     int getContractTransfer(uint64_t amount, const std::string &fromAddr, const std::string &toAddr,
                             std::vector<TransferInfo> &transferInfo);
 
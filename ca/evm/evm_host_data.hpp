@@ -12,14 +12,25 @@
 
 #include <evmone/evmone.h>
 #include "../utils/keccak_cryopp.hpp"
+#include "utils/contract_utils.h"
 struct StorageValue
 {
     // The storage value.
     evmc::bytes32 value;
 
-    // True means this value has been modified already by the current transaction.
+    // The value at the start of the transaction (EIP-2200 original value).
+    evmc::bytes32 original;
+
+    // True means the trie has to be updated with this value by TfsAccount::FlushStorage().
     bool dirty{false};
 
+    // Whether the trie holds the slot, now and at the start of the transaction.
+    bool present{false};
+    bool originalPresent{false};
+
+    // True once the slot has been read from the trie.
+    bool loaded{false};
+
     // Is the storage key cold or warm.
     evmc_access_status access_status{EVMC_ACCESS_COLD};
 
@@ -51,6 +62,7 @@ struct TfsAccount
 
     void CreateTrie(const std::string &rootHash, const std::string &ContractAddr)
     {
+        ResetStorage();
         if (rootHash.empty())
         {
             storageRoot = std::make_shared<Trie>(ContractAddr);
@@ -63,6 +75,7 @@ struct TfsAccount
 
     void CreateTrie(const std::string &rootHash, const std::string &ContractAddr, ContractDataCache *contractDataCache)
     {
+        ResetStorage();
         if (rootHash.empty())
         {
             storageRoot = std::make_shared<Trie>(ContractAddr, contractDataCache);
@@ -77,30 +90,82 @@ struct TfsAccount
     // The account nonce.
     int nonce = 0;
 
-    // The account code.
-    evmc::bytes code;
-
-    // The code hash. Can be a value not related to the actual code.
-    evmc::bytes32 codehash;
+    // The account code and its hash, shared with ContractCodeCache. Null if the account has no code.
+    evm_utils::ContractCodePtr code;
 
     // The account balance.
     evmc::uint256be balance;
 
-    // The account storage map.
+    // The account storage map, caching the trie for the current transaction.
     std::unordered_map<evmc::bytes32, StorageValue> storage;
 
     std::shared_ptr<Trie> storageRoot;
 
+    // Get a storage slot, reading it from the trie on first access.
+    StorageValue &LoadStorage(const evmc::bytes32 &key)
+    {
+        auto &slot = storage[key];
+        if (!slot.loaded)
+        {
+            std::string k = evmc::hex({key.bytes, sizeof(key.bytes)});
+            auto mptv = storageRoot->Get(k);
+            slot.present = !mptv.empty();
+            slot.value = slot.present ? evmc::from_hex<evmc::bytes32>(mptv).value_or(evmc::bytes32{}) : evmc::bytes32{};
+            slot.original = slot.value;
+            slot.originalPresent = slot.present;
+            slot.loaded = true;
+        }
+        return slot;
+    }
+
+    // Make every slot read again from a new trie. Values written before are dropped, as they were when
+    // the trie was re-created and read directly; only the access status (EIP-2929) is kept.
+    void ResetStorage()
+    {
+        for (auto &[key, slot] : storage)
+        {
+            slot.value = evmc::bytes32{};
+            slot.original = evmc::bytes32{};
+            slot.dirty = false;
+            slot.present = false;
+            slot.originalPresent = false;
+            slot.loaded = false;
+        }
+    }
+
+    // Write the slots changed by the transaction into the trie.
+    void FlushStorage()
+    {
+        for (auto &[key, slot] : storage)
+        {
+            if (!slot.dirty)
+            {
+                continue;
+            }
+            std::string k = evmc::hex({key.bytes, sizeof(key.bytes)});
+            if (slot.originalPresent && slot.value == slot.original)
+            {
+                // Changed and then restored. The trie path must still end up dirty,
+                // as it did when every write went to the trie.
+                evmc::bytes32 changed = slot.original;
+                changed.bytes[0] ^= 0xff;
+                storageRoot->Update(k, evmc::hex({changed.bytes, sizeof(changed.bytes)}));
+            }
+            storageRoot->Update(k, evmc::hex({slot.value.bytes, sizeof(slot.value.bytes)}));
+            slot.original = slot.value;
+            slot.originalPresent = true;
+            slot.dirty = false;
+        }
+    }
+
     void set_code(const evmc::bytes &code_) noexcept
     {
-        code = code_;
-        
-        const std::string& input = std::string(reinterpret_cast<const char*>(code_.data()), code_.size());
-        // const auto *data = reinterpret_cast<const uint8_t *> (code_.c_str());
-        std::string hash = Keccak256Crypt(input);
-        // std::string hash = keccak256(data, code_.length());
-        dev::bytes by = dev::fromHex(hash);
-        memcpy(codehash.bytes, &by[0], by.size() * sizeof(uint8_t));
+        code = evm_utils::MakeContractCode(code_);
+    }
+
+    void set_code(evm_utils::ContractCodePtr code_) noexcept
+    {
+        code = std::move(code_);
     }
 
     // Helper method for setting balance by numeric type.
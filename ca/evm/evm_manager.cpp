@@ -7,6 +7,8 @@
 #include "include/logging.h"
 #include "utils/contract_utils.h"
 #include "evm_environment.h"
+#include "evm_vm_pool.h"
+#include "utils/magic_singleton.h"
 
 std::optional<evmc::VM> Evmone::GetEvmInstance()
 {
@@ -25,18 +27,29 @@ std::optional<evmc::VM> Evmone::GetEvmInstance()
     return vm;
 }
 
-int
-Evmone::SynchronousExecuteByEvmone(const evmc_message &msg, const evmc::bytes &code, EvmHost &host, std::string &output)
+evmc::Result Evmone::ExecuteCode(evmc::Host &host, evmc_revision rev, const evmc_message &msg, evmc::bytes_view code)
 {
-    auto createResult = Evmone::GetEvmInstance();
-    if (!createResult.has_value())
+    auto vm = MagicSingleton<EvmVmPool>::GetInstance()->Acquire();
+    if (!vm)
     {
-        return -1;
+        return evmc::Result{EVMC_INTERNAL_ERROR, 0, 0};
     }
 
-    evmc::VM &vm = createResult.value();
+#ifdef EVM_ANALYSIS_CACHE
+    // Init code is executed once, only runtime code is worth keeping the analysis of
+    if (msg.kind != EVMC_CREATE && msg.kind != EVMC_CREATE2 && evmone_adapter::IsSupported(*vm))
+    {
+        auto analysis = MagicSingleton<EvmCodeAnalysisCache>::GetInstance()->Get(rev, code);
+        return evmone_adapter::Execute(*vm, host, rev, msg, code, *analysis);
+    }
+#endif
+    return vm->execute(host, rev, msg, code.data(), code.size());
+}
 
-    auto result = vm.execute(host, EVMC_MAX_REVISION, msg, code.data(), code.size());
+int
+Evmone::SynchronousExecuteByEvmone(const evmc_message &msg, const evmc::bytes &code, EvmHost &host, std::string &output)
+{
+    auto result = Evmone::ExecuteCode(host, EVMC_MAX_REVISION, msg, code);
     DEBUGLOG("ContractAddress: {} , Result: {}", evm_utils::EvmAddrToString(msg.recipient), result.status_code);
     if (result.status_code != EVMC_SUCCESS)
     {
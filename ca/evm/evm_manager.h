@@ -34,6 +34,12 @@ namespace Evmone
 
     std::optional<evmc::VM> GetEvmInstance();
 
+    /**
+     * @brief       Execute code on a pooled evmone instance, reusing the jumpdest analysis
+     *              of runtime code across calls when built with EVM_ANALYSIS_CACHE
+     */
+    evmc::Result ExecuteCode(evmc::Host &host, evmc_revision rev, const evmc_message &msg, evmc::bytes_view code);
+
     int
     SynchronousExecuteByEvmone(const evmc_message &msg, const evmc::bytes &code, EvmHost &host, std::string &output);
 
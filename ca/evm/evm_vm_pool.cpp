@@ -0,0 +1,105 @@
+//
+// Created by root on 2024/6/17.
+//
+
+#include "evm_vm_pool.h"
+#include <string_view>
+#include <evmone/evmone.h>
+#include "include/logging.h"
+
+EvmVmPool::Lease::~Lease()
+{
+    if (_pool != nullptr && _vm != nullptr)
+    {
+        _pool->_Release(std::move(_vm));
+    }
+}
+
+EvmVmPool::Lease EvmVmPool::Acquire()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_idle.empty())
+        {
+            auto vm = std::move(_idle.back());
+            _idle.pop_back();
+            return Lease(this, std::move(vm));
+        }
+    }
+
+    struct evmc_vm *pvm = evmc_create_evmone();
+    if (!pvm)
+    {
+        ERRORLOG("can't create evmone instance")
+        return {};
+    }
+    if (!evmc_is_abi_compatible(pvm))
+    {
+        ERRORLOG("created evmone instance abi not compatible")
+        pvm->destroy(pvm);
+        return {};
+    }
+    return Lease(this, std::make_unique<evmc::VM>(pvm));
+}
+
+size_t EvmVmPool::GetIdleSize()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _idle.size();
+}
+
+void EvmVmPool::_Release(std::unique_ptr<evmc::VM> vm)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_idle.size() < kMaxIdleVm)
+    {
+        _idle.push_back(std::move(vm));
+    }
+}
+
+#ifdef EVM_ANALYSIS_CACHE
+std::shared_ptr<const evmone_adapter::CodeAnalysis> EvmCodeAnalysisCache::Get(evmc_revision rev, evmc::bytes_view code)
+{
+    Key key{rev, std::hash<std::string_view>{}({reinterpret_cast<const char *>(code.data()), code.size()})};
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _entries.find(key);
+        if (found != _entries.end() && evmone_adapter::IsAnalysisOf(*found->second->second, code))
+        {
+            _lru.splice(_lru.begin(), _lru, found->second);
+            return found->second->second;
+        }
+    }
+
+    auto analysis = evmone_adapter::Analyze(rev, code);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _entries.find(key);
+    if (found != _entries.end())
+    {
+        _lru.erase(found->second);
+        _entries.erase(found);
+    }
+    while (!_lru.empty() && _lru.size() >= kMaxEntries)
+    {
+        _entries.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+    _lru.emplace_front(key, analysis);
+    _entries[key] = _lru.begin();
+    return analysis;
+}
+
+void EvmCodeAnalysisCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _lru.clear();
+    _entries.clear();
+}
+
+size_t EvmCodeAnalysisCache::GetSize()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+#endif
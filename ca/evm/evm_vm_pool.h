@@ -0,0 +1,114 @@
+//
+// Created by root on 2024/6/17.
+//
+
+#ifndef TFS_EVM_VM_POOL_H
+#define TFS_EVM_VM_POOL_H
+
+#include <list>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <evmc/evmc.hpp>
+
+#ifdef EVM_ANALYSIS_CACHE
+#include "evmone_adapter.h"
+#endif
+
+/**
+ * @brief       Idle evmone instances reused across executions instead of creating
+ *              and checking a new one for every message
+ */
+class EvmVmPool
+{
+public:
+    class Lease
+    {
+    public:
+        Lease() = default;
+        Lease(EvmVmPool *pool, std::unique_ptr<evmc::VM> vm) : _pool(pool), _vm(std::move(vm)) {}
+        Lease(Lease &&) = default;
+        Lease &operator=(Lease &&) = default;
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        ~Lease();
+
+        explicit operator bool() const noexcept { return _vm != nullptr; }
+        evmc::VM *operator->() const noexcept { return _vm.get(); }
+        evmc::VM &operator*() const noexcept { return *_vm; }
+
+    private:
+        EvmVmPool *_pool = nullptr;
+        std::unique_ptr<evmc::VM> _vm;
+    };
+
+    EvmVmPool() = default;
+    ~EvmVmPool() = default;
+    EvmVmPool(EvmVmPool &&) = delete;
+    EvmVmPool(const EvmVmPool &) = delete;
+    EvmVmPool &operator=(EvmVmPool &&) = delete;
+    EvmVmPool &operator=(const EvmVmPool &) = delete;
+
+    /**
+     * @brief       Take an idle instance or create one, the lease returns it on destruction
+     *
+     * @return      an empty lease if evmone could not be created
+     */
+    Lease Acquire();
+
+    size_t GetIdleSize();
+
+    static const size_t kMaxIdleVm = 64;
+
+private:
+    void _Release(std::unique_ptr<evmc::VM> vm);
+
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<evmc::VM>> _idle;
+};
+
+#ifdef EVM_ANALYSIS_CACHE
+/**
+ * @brief       Jumpdest analysis of contract code, shared between executions of the same code.
+ *              A hit is only returned when the cached code is byte-equal to the requested one.
+ */
+class EvmCodeAnalysisCache
+{
+public:
+    EvmCodeAnalysisCache() = default;
+    ~EvmCodeAnalysisCache() = default;
+    EvmCodeAnalysisCache(EvmCodeAnalysisCache &&) = delete;
+    EvmCodeAnalysisCache(const EvmCodeAnalysisCache &) = delete;
+    EvmCodeAnalysisCache &operator=(EvmCodeAnalysisCache &&) = delete;
+    EvmCodeAnalysisCache &operator=(const EvmCodeAnalysisCache &) = delete;
+
+    /**
+     * @brief       Return the cached analysis of code, analysing and caching it on a miss
+     *
+     * @param       rev:
+     * @param       code:
+     * @return      std::shared_ptr<const evmone_adapter::CodeAnalysis>
+     */
+    std::shared_ptr<const evmone_adapter::CodeAnalysis> Get(evmc_revision rev, evmc::bytes_view code);
+
+    void Clear();
+    size_t GetSize();
+
+    static const size_t kMaxEntries = 1024;
+
+private:
+    using Key = std::pair<evmc_revision, size_t>;
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const noexcept { return key.second ^ ((size_t)key.first << 1); }
+    };
+    using LruList = std::list<std::pair<Key, std::shared_ptr<const evmone_adapter::CodeAnalysis>>>;
+
+    std::mutex _mutex;
+    LruList _lru;
+    std::unordered_map<Key, LruList::iterator, KeyHash> _entries;
+};
+#endif
+
+#endif //TFS_EVM_VM_POOL_H
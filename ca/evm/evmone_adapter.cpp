@@ -0,0 +1,48 @@
+//
+// Created by root on 2024/6/17.
+//
+
+#include "evmone_adapter.h"
+
+#ifdef EVM_ANALYSIS_CACHE
+#include <cstring>
+#include <evmone/vm.hpp>
+#include <evmone/baseline.hpp>
+#include <evmone/execution_state.hpp>
+
+namespace evmone_adapter
+{
+    class CodeAnalysis
+    {
+    public:
+        explicit CodeAnalysis(evmone::baseline::CodeAnalysis &&analysis) : analysis(std::move(analysis)) {}
+        evmone::baseline::CodeAnalysis analysis;
+    };
+
+    bool IsSupported(evmc::VM &vm)
+    {
+        const char *version = vm.version();
+        return version != nullptr && std::strcmp(version, kPinnedVersion) == 0;
+    }
+
+    std::shared_ptr<const CodeAnalysis> Analyze(evmc_revision rev, evmc::bytes_view code)
+    {
+        return std::make_shared<const CodeAnalysis>(evmone::baseline::analyze(rev, code));
+    }
+
+    bool IsAnalysisOf(const CodeAnalysis &analysis, evmc::bytes_view code)
+    {
+        // executable_code of legacy code is a padded copy of the whole code
+        return analysis.analysis.executable_code == code;
+    }
+
+    evmc::Result Execute(evmc::VM &vm, evmc::Host &host, evmc_revision rev, const evmc_message &msg,
+                         evmc::bytes_view code, const CodeAnalysis &analysis)
+    {
+        auto &evmoneVm = *static_cast<evmone::VM *>(vm.get_raw_pointer());
+        auto state = std::make_unique<evmone::ExecutionState>(msg, rev, evmc::Host::get_interface(), host.to_context(),
+                                                              code, analysis.analysis.eof_header.get_data(code));
+        return evmc::Result{evmone::baseline::execute(evmoneVm, msg.gas, *state, analysis.analysis)};
+    }
+}
+#endif
@@ -0,0 +1,48 @@
+//
+// Created by root on 2024/6/17.
+//
+
+#ifndef TFS_EVMONE_ADAPTER_H
+#define TFS_EVMONE_ADAPTER_H
+
+#include <memory>
+#include <evmc/evmc.hpp>
+
+/**
+ * @brief       The only code that reaches into evmone's internals (baseline analysis and
+ *              execution). They are not part of evmone's public API, so this is written against
+ *              the evmone version make_depend.sh builds and refuses any other one.
+ */
+namespace evmone_adapter
+{
+    // The evmone release the internals below are written against
+    constexpr const char *kPinnedVersion = "0.11.0";
+
+    // Jumpdest analysis of a piece of code, opaque outside the adapter
+    class CodeAnalysis;
+
+    /**
+     * @brief       Whether vm is the pinned evmone, checked at run time as well because the
+     *              library is linked prebuilt
+     *
+     * @param       vm:
+     * @return      true
+     * @return      false the caller has to use vm.execute()
+     */
+    bool IsSupported(evmc::VM &vm);
+
+    std::shared_ptr<const CodeAnalysis> Analyze(evmc_revision rev, evmc::bytes_view code);
+
+    /**
+     * @brief       Whether analysis was made from exactly this code
+     */
+    bool IsAnalysisOf(const CodeAnalysis &analysis, evmc::bytes_view code);
+
+    /**
+     * @brief       Same as vm.execute(), with the analysis of code given instead of made
+     */
+    evmc::Result Execute(evmc::VM &vm, evmc::Host &host, evmc_revision rev, const evmc_message &msg,
+                         evmc::bytes_view code, const CodeAnalysis &analysis);
+}
+
+#endif //TFS_EVMONE_ADAPTER_H
@@ -1,4 +1,11 @@
-#include "ca/failed_transaction_cache.h" 
+#include "ca/failed_transaction_cache.h"
+
+#include <set>
+#include <queue>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+
 #include "db/db_api.h"
 #include "transaction.h"
 
@@ -6,32 +13,94 @@
 #include "common/task_pool.h"
 #include "include/logging.h"
 
-void FailedTransactionCache::_StartTimer()
+namespace
 {
-	//Notifications for inspections at regular intervals
-	_timer.AsyncLoop(2 * 1000, [this](){
-        if(!_IsEmpty())
-        {
-            _Check();
-        }
-	});
+using Clock = std::chrono::steady_clock;
+
+struct Pending
+{
+    TxMsgReq msg;
+    std::string txHash;
+    uint64_t height = 0;
+    // Bumped on every reschedule, older entries in the due queue are skipped
+    uint64_t generation = 0;
+};
+
+// (due time, (id, generation)), earliest first
+using DueEntry = std::pair<Clock::time_point, std::pair<uint64_t, uint64_t>>;
+
+/**
+ * @brief       The retry queue of the FailedTransactionCache singleton. It is kept here rather
+ *              than in the class so that the class layout stays the one ca_core was built with,
+ *              and it is guarded by FailedTransactionCache::_txPendingMutex.
+ */
+struct RetryState
+{
+    uint64_t nextId = 0;
+    // Ordered by id, so the first one is the oldest
+    std::map<uint64_t, Pending> pending;
+    std::unordered_map<std::string, uint64_t> idByHash;
+    // Kept across re-adds by DoHandleTx so that a tx cannot retry forever
+    std::unordered_map<std::string, uint32_t> attempts;
+    std::multimap<uint64_t, uint64_t> byHeight;
+    std::priority_queue<DueEntry, std::vector<DueEntry>, std::greater<DueEntry>> due;
+    FailedTransactionCache::Metrics metrics;
+};
+
+RetryState retryState;
+
+Clock::duration Backoff(uint32_t attempts)
+{
+    auto backoff = static_cast<int64_t>(FailedTransactionCache::kBaseBackoff) << std::min<uint32_t>(attempts, 16);
+    return std::chrono::milliseconds(std::min<int64_t>(backoff, FailedTransactionCache::kMaxBackoff));
 }
 
-bool FailedTransactionCache::_IsEmpty()
+void Schedule(uint64_t id, Pending& pending, Clock::time_point when)
 {
-    std::shared_lock<std::shared_mutex> lock(_txPendingMutex);
-    if(_txPending.empty())
+    ++pending.generation;
+    retryState.due.push({when, {id, pending.generation}});
+}
+
+void Erase(uint64_t id)
+{
+    auto found = retryState.pending.find(id);
+    if(found == retryState.pending.end())
     {
-        return true;
+        return;
     }
-    else
+    auto& pending = found->second;
+    auto [begin, end] = retryState.byHeight.equal_range(pending.height);
+    for(auto iter = begin; iter != end; ++iter)
     {
-        return false;
+        if(iter->second == id)
+        {
+            retryState.byHeight.erase(iter);
+            break;
+        }
     }
+    retryState.idByHash.erase(pending.txHash);
+    retryState.pending.erase(found);
+}
+}
+
+void FailedTransactionCache::_StartTimer()
+{
+	//Only the txs that are due get looked at
+	_timer.AsyncLoop(200, [this](){
+        _Check();
+	});
 }
 
 void FailedTransactionCache::_Check()
 {
+    {
+        std::unique_lock<std::shared_mutex> lock(_txPendingMutex);
+        if(retryState.due.empty() || retryState.due.top().first > Clock::now())
+        {
+            return;
+        }
+    }
+
     DBReader dbReader;
     uint64_t top = 0;
     if (DBStatus::DB_SUCCESS != dbReader.GetBlockTop(top))
@@ -39,62 +108,162 @@ void FailedTransactionCache::_Check()
         ERRORLOG("db get top failed!!");
     }
     std::vector<Node> nodelist = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-    auto begin = _txPending.begin();
-    std::vector<decltype(begin)> deleteTxPending;
-    std::unique_lock<std::shared_mutex> lock(_txPendingMutex);
-    for(auto iter = begin; iter != _txPending.end(); iter++)
+
+    std::vector<std::pair<std::string, TxMsgReq>> ready;
     {
-        auto txHeight = iter->first;
-        uint64_t nodeHeight = 0;
-        for(auto &node : nodelist)
+        std::unique_lock<std::shared_mutex> lock(_txPendingMutex);
+        auto now = Clock::now();
+        while(!retryState.due.empty() && retryState.due.top().first <= now)
         {
-            if(node.height >= txHeight)
+            auto [id, generation] = retryState.due.top().second;
+            retryState.due.pop();
+            auto found = retryState.pending.find(id);
+            if(found == retryState.pending.end() || found->second.generation != generation)
             {
-                nodeHeight++;
+                continue;
             }
-        }
 
-        if(nodeHeight < global::ca::kConsensus * 2 || top < txHeight)
-        {
-            if(txHeight > top + 2)
+            auto& pending = found->second;
+            auto txHeight = pending.height;
+            uint64_t nodeHeight = 0;
+            for(auto &node : nodelist)
             {
-                deleteTxPending.push_back(iter);
+                if(node.height >= txHeight)
+                {
+                    nodeHeight++;
+                }
             }
-            continue;
-        }
 
-        for(auto& txmsg : iter->second)
-        {
-            MagicSingleton<TaskPool>::GetInstance()->CommitTxTask(
-                [=](){
-                    CTransaction tx;
-                    int ret = DoHandleTx(std::make_shared<TxMsgReq>(txmsg), tx);
-
-                    tx.clear_hash();
-                    tx.clear_verifysign();
-                    tx.set_hash(Getsha256hash(tx.SerializeAsString()));
-                    if (ret != 0)
-                    {
-                        DEBUGLOG("TTT tx verify <fail!!!> txhash:{}, ret:{}", tx.hash(), ret);
-                        return;
-                    }
+            if(nodeHeight < global::ca::kConsensus * 2 || top < txHeight)
+            {
+                auto attempts = ++retryState.attempts[pending.txHash];
+                if(txHeight > top + 2 || attempts >= kMaxAttempts)
+                {
+                    DEBUGLOG("TTT drop pending tx txhash:{}, txHeight:{}, top:{}, attempts:{}", pending.txHash, txHeight, top, attempts);
+                    retryState.attempts.erase(pending.txHash);
+                    Erase(id);
+                    ++retryState.metrics.dropped;
+                    continue;
+                }
+                Schedule(id, pending, now + Backoff(attempts));
+                continue;
+            }
 
-                    DEBUGLOG("TTT tx verify <success> txhash:{}", tx.hash());
-                });
+            ++retryState.attempts[pending.txHash];
+            ready.emplace_back(pending.txHash, std::move(pending.msg));
+            Erase(id);
+            ++retryState.metrics.retried;
         }
-        deleteTxPending.push_back(iter);
     }
 
-    for(auto& iter : deleteTxPending)
+    _Retry(std::move(ready));
+}
+
+void FailedTransactionCache::_Retry(std::vector<std::pair<std::string, TxMsgReq>>&& msgs)
+{
+    for(auto& [txHash, txmsg] : msgs)
     {
-        _txPending.erase(iter);
+        MagicSingleton<TaskPool>::GetInstance()->CommitTxTask(
+            [this, txHash = std::move(txHash), txmsg = std::move(txmsg)](){
+                CTransaction tx;
+                int ret = DoHandleTx(std::make_shared<TxMsgReq>(txmsg), tx);
+
+                {
+                    // DoHandleTx re-adds a tx that is still blocked, keep its attempts then
+                    std::unique_lock<std::shared_mutex> lock(_txPendingMutex);
+                    if(retryState.idByHash.find(txHash) == retryState.idByHash.end())
+                    {
+                        retryState.attempts.erase(txHash);
+                    }
+                    if(ret == 0)
+                    {
+                        ++retryState.metrics.succeeded;
+                    }
+                }
+
+                if (ret != 0)
+                {
+                    DEBUGLOG("TTT tx verify <fail!!!> txhash:{}, ret:{}", txHash, ret);
+                    return;
+                }
+
+                DEBUGLOG("TTT tx verify <success> txhash:{}", txHash);
+            });
     }
 }
-	
+
 int FailedTransactionCache::Add(uint64_t height, const TxMsgReq& msg)
 {
     DEBUGLOG("TTT NodelistHeight discontent, repeat commit tx ,NodeHeight:{}, txUtxoHeight:{}",height, msg.txmsginfo().txutxoheight());
+    CTransaction tx;
+    if(!tx.ParseFromString(msg.txmsginfo().tx()))
+    {
+        ERRORLOG("fail to parse failed transaction");
+        return -1;
+    }
+    std::string txHash = tx.hash().empty() ? Getsha256hash(msg.txmsginfo().tx()) : tx.hash();
+
     std::unique_lock<std::shared_mutex> lock(_txPendingMutex);
-    _txPending[height].push_back(msg);
+    // A tx seen for the first time has no entry, one is only written when a retry fails
+    auto attemptsIt = retryState.attempts.find(txHash);
+    uint32_t attempts = attemptsIt == retryState.attempts.end() ? 0 : attemptsIt->second;
+    if(attempts >= kMaxAttempts)
+    {
+        DEBUGLOG("TTT drop failed tx txhash:{}, attempts:{}", txHash, attempts);
+        retryState.attempts.erase(attemptsIt);
+        ++retryState.metrics.dropped;
+        return -2;
+    }
+    if(retryState.idByHash.find(txHash) != retryState.idByHash.end())
+    {
+        return 0;
+    }
+    if(retryState.pending.size() >= kMaxPending)
+    {
+        auto oldest = retryState.pending.begin();
+        DEBUGLOG("TTT failed tx queue full, evict txhash:{}", oldest->second.txHash);
+        retryState.attempts.erase(oldest->second.txHash);
+        Erase(oldest->first);
+        ++retryState.metrics.evicted;
+    }
+
+    auto id = retryState.nextId++;
+    auto& pending = retryState.pending[id];
+    pending.msg = msg;
+    pending.txHash = txHash;
+    pending.height = height;
+    retryState.idByHash[txHash] = id;
+    retryState.byHeight.emplace(height, id);
+    Schedule(id, pending, Clock::now() + Backoff(attempts));
+    ++retryState.metrics.added;
 	return 0;
 }
+
+void FailedTransactionCache::BlockSaved(const CBlock& block)
+{
+    std::unique_lock<std::shared_mutex> lock(_txPendingMutex);
+    if(retryState.byHeight.empty())
+    {
+        return;
+    }
+
+    std::set<uint64_t> woken;
+    for(auto iter = retryState.byHeight.begin(); iter != retryState.byHeight.end() && iter->first <= block.height(); ++iter)
+    {
+        woken.insert(iter->second);
+    }
+
+    auto now = Clock::now();
+    for(auto id : woken)
+    {
+        Schedule(id, retryState.pending.at(id), now);
+    }
+}
+
+FailedTransactionCache::Metrics FailedTransactionCache::GetMetrics() const
+{
+    std::shared_lock<std::shared_mutex> lock(_txPendingMutex);
+    auto metrics = retryState.metrics;
+    metrics.pending = retryState.pending.size();
+    return metrics;
+}
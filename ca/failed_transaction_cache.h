@@ -10,21 +10,41 @@
 #define _TRAN_STROAGE_
 
 #include <map>
+#include <vector>
 #include <unistd.h>
 #include <shared_mutex>
 
 #include "utils/timer.hpp"
 #include "ca/txhelper.h"
 #include "ca/transaction_cache.h"
+#include "proto/block.pb.h"
 #include "proto/transaction.pb.h"
 #include "proto/ca_protomsg.pb.h"
 
 /**
- * @brief       
+ * @brief       Transactions that failed because the nodes had not reached the height they were
+ *              built on. Each one is retried once BlockHelper saves a block at that height, or
+ *              when its backoff runs out, whichever is first.
+ *
+ *              Only the height failure is queued: DoHandleTx, the producer, lives in the prebuilt
+ *              ca_core library and reports nothing but the height through Add(height, msg), so
+ *              transactions missing a prevout or a VRF result are not retried here.
  */
 class FailedTransactionCache
 {
 public:
+    struct Metrics
+    {
+        uint64_t added = 0;
+        uint64_t retried = 0;
+        uint64_t succeeded = 0;
+        // Out of attempts, or the height is too far ahead
+        uint64_t dropped = 0;
+        // Pushed out of a full queue
+        uint64_t evicted = 0;
+        size_t pending = 0;
+    };
+
     FailedTransactionCache(){ _StartTimer(); };
     ~FailedTransactionCache() = default;
     FailedTransactionCache(FailedTransactionCache &&) = delete;
@@ -34,14 +54,23 @@ public:
 
 public:
     /**
-     * @brief       
+     * @brief       Add a tx waiting for the nodes to reach height
      * 
      * @param       height: 
      * @param       msg: 
-     * @return      int 
+     * @return      int 0 queued, -1 unparsable tx, -2 out of attempts
      */
 	int Add(uint64_t height,const TxMsgReq& msg);
-    
+
+    /**
+     * @brief       Wake the txs waiting for a height up to the block, called once the block is committed
+     * 
+     * @param       block: 
+     */
+    void BlockSaved(const CBlock& block);
+
+    Metrics GetMetrics() const;
+
     /**
      * @brief       
      * 
@@ -53,21 +82,30 @@ public:
      * 
      */
     void StopTimer() { _timer.Cancel(); }
+
+    static const size_t kMaxPending = 10000;
+    static const uint32_t kMaxAttempts = 8;
+    // Backoff doubles from the base per attempt up to the cap (ms)
+    static const int kBaseBackoff = 500;
+    static const int kMaxBackoff = 30 * 1000;
+
 private:
     /**
-     * @brief       
+     * @brief       Run the txs whose backoff has run out or that were woken
      * 
-     * @return      true 
-     * @return      false 
      */
-    bool _IsEmpty();
+	void _Check();
 
     /**
-     * @brief       
+     * @brief       Hand the txs back to DoHandleTx
      * 
+     * @param       msgs: tx hash and message
      */
-	void _Check();
+    void _Retry(std::vector<std::pair<std::string, TxMsgReq>>&& msgs);
+
 private:
+    // The prebuilt ca_core library constructs this singleton as well, so the members stay as
+    // they were. The retry state lives in failed_transaction_cache.cpp, guarded by this mutex.
     mutable std::shared_mutex _txPendingMutex;
     std::map<uint64_t, std::vector<TxMsgReq>> _txPending;
 	CTimer _timer;
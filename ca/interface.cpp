@@ -62,9 +62,7 @@ int GetSDKAllNeed(const std::shared_ptr<GetSDKReq> & req, GetSDKAck & ack)
     for(const auto & node : nodelist)
     {
         //Verification of investment and pledge
-        int ret = VerifyBonusAddr(node.address);
-        int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-        if (stakeTime > 0 && ret == 0)
+        if (MagicSingleton<QualifiedNodeCache>::GetInstance()->IsQualified(node.address))
         {
             satisfiedNode.push_back(node);
         }
@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <string>
 #include <vector> 
+#include <unordered_set>
 
 #include "ca/txhelper.h"
 #include "ca/algorithm.h"
@@ -18,9 +19,11 @@
 #include "utils/account_manager.h"
 
 #include "db/db_api.h"
+#include "db/cache.h"
 #include "net/dispatcher.h"
 #include "include/logging.h"
 #include "common/global_data.h"
+#include "common/proto_arena.h"
 
 const static uint64_t kStabilityTime = 60 * 1000000;
 static uint64_t newSyncFailHeight = 0;
@@ -212,16 +215,14 @@ void SyncBlock::ThreadStart()
                     {
                         continue;
                     }
-                    std::vector<Node> nodes = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-                    for (const auto &node : nodes)
+                    auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+                    std::vector<std::string> nodeAddrs;
+                    nodeAddrs.reserve(peerTable->byAddress.size());
+                    for (const auto &[addr, node] : peerTable->byAddress)
                     {
-                        int ret = VerifyBonusAddr(node.address);
-                        int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-                        if (stakeTime > 0 && ret == 0)
-                        {
-                            pledgeAddr.push_back(node.address);
-                        }
+                        nodeAddrs.push_back(addr);
                     }
+                    MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, pledgeAddr);
                 }
 
                 uint64_t startSyncHeight = 0;
@@ -671,19 +672,24 @@ int SyncBlock::_GetSyncNodeBasic(uint32_t num, uint64_t heightBaseline,
         return -1;
     }
 
-    std::vector<Node> nodes = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-    std::vector<Node> qualifyingNode;
-    for (const auto &node : nodes)
+    // Candidates share the nodes of the peer table, picking one erases only the pointer
+    auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+    std::vector<PeerTable::NodePtr> nodes;
+    std::vector<std::string> nodeAddrs;
+    nodes.reserve(peerTable->byAddress.size());
+    nodeAddrs.reserve(peerTable->byAddress.size());
+    for (const auto &[addr, node] : peerTable->byAddress)
     {
-        int ret = VerifyBonusAddr(node.address);
-
-        int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-        if (stakeTime > 0 && ret == 0)
-        {
-            qualifyingNode.push_back(node);
-            continue;
-        }
-        DEBUGLOG("stakeTime:{}, ret:{}, addr:{}", stakeTime, ret, node.address);
+        nodes.push_back(node);
+        nodeAddrs.push_back(addr);
+    }
+    std::vector<std::string> qualifiedAddrs;
+    MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, qualifiedAddrs);
+    std::vector<PeerTable::NodePtr> qualifyingNode;
+    qualifyingNode.reserve(qualifiedAddrs.size());
+    for (const auto &addr : qualifiedAddrs)
+    {
+        qualifyingNode.push_back(peerTable->byAddress.at(addr));
     }
 
     DEBUGLOG("qualifyingNode size:{}, nodes size:{}", qualifyingNode.size(), nodes.size());
@@ -716,15 +722,15 @@ int SyncBlock::_GetSyncNodeBasic(uint32_t num, uint64_t heightBaseline,
         {
             std::uniform_int_distribution<int> distQualifyingNode(0, qualifyingNode.size() - 1);
             int index = distQualifyingNode(gen);
-            auto &node = qualifyingNode.at(index);
-            if (discardComparator(node.height, heightBaseline))
+            auto node = qualifyingNode.at(index);
+            if (discardComparator(node->height, heightBaseline))
             {
                 qualifyingNode.erase(qualifyingNode.cbegin() + index);
-                DEBUGLOG("qualifyingNode.erase, node.height:{}, heightBaseline:{}, addr:{}", node.height, heightBaseline, node.address);
+                DEBUGLOG("qualifyingNode.erase, node->height:{}, heightBaseline:{}, addr:{}", node->height, heightBaseline, node->address);
                 continue;
             }
-            DEBUGLOG("qualifyingNode size:{}, addr:{}, index:{}",qualifyingNode.size(), node.address, index);
-            sendNodeIdsSet.insert(node.address);
+            DEBUGLOG("qualifyingNode size:{}, addr:{}, index:{}",qualifyingNode.size(), node->address, index);
+            sendNodeIdsSet.insert(node->address);
             qualifyingNode.erase(qualifyingNode.cbegin() + index); 
         }
 
@@ -732,13 +738,13 @@ int SyncBlock::_GetSyncNodeBasic(uint32_t num, uint64_t heightBaseline,
         {
             std::uniform_int_distribution<int> distNodes(0, nodes.size() - 1);
             int index = distNodes(gen);
-            auto &node = nodes.at(index);
-            if (discardComparator(node.height, heightBaseline))
+            auto node = nodes.at(index);
+            if (discardComparator(node->height, heightBaseline))
             {
                 nodes.erase(nodes.begin() + index);
                 continue;
             }
-            sendNodeIdsSet.insert(node.address);
+            sendNodeIdsSet.insert(node->address);
             nodes.erase(nodes.begin() + index);
         }
     }
@@ -753,13 +759,13 @@ int SyncBlock::_GetSyncNodeBasic(uint32_t num, uint64_t heightBaseline,
         {
             std::uniform_int_distribution<int> distQualifyingNode(0, qualifyingNode.size() - 1);
             int index = distQualifyingNode(gen);
-            auto &node = qualifyingNode.at(index);
-            if (discardComparator(node.height, heightBaseline))
+            auto node = qualifyingNode.at(index);
+            if (discardComparator(node->height, heightBaseline))
             {
                 qualifyingNode.erase(qualifyingNode.cbegin() + index);
                 continue;
             }
-            sendNodeIdsSet.insert(node.address);
+            sendNodeIdsSet.insert(node->address);
             qualifyingNode.erase(qualifyingNode.cbegin() + index); 
         }
     }
@@ -772,7 +778,7 @@ int SyncBlock::_GetSyncNodeBasic(uint32_t num, uint64_t heightBaseline,
     {
         for(auto &it : nodes)
         {
-            DEBUGLOG("Node height:{}", it.height);
+            DEBUGLOG("Node height:{}", it->height);
         }
         ERRORLOG("sendNodeIds size: {}, num:{}",sendNodeIds.size(), num);
         sendNodeIds.clear();
@@ -959,17 +965,15 @@ bool SyncBlock::_GetFastSyncSumHashNode(const std::vector<std::string> &sendNode
 
     if (!rollbackBlockData.empty())
     {
-        std::vector<Node> nodes = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-        std::vector<Node> qualifyingNode;
-        for (const auto &node : nodes)
+        auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+        std::vector<std::string> nodeAddrs;
+        nodeAddrs.reserve(peerTable->byAddress.size());
+        for (const auto &[addr, node] : peerTable->byAddress)
         {
-            int ret = VerifyBonusAddr(node.address);
-            int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-            if (stakeTime > 0 && ret == 0)
-            {
-                qualifyingNode.push_back(node);
-            }
+            nodeAddrs.push_back(addr);
         }
+        std::vector<std::string> qualifyingNode;
+        MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, qualifyingNode);
         if(syncSendFastSyncNum < qualifyingNode.size())
         {
             ERRORLOG("syncSendFastSyncNum:{} < qualifyingNode.size:{}", syncSendFastSyncNum, qualifyingNode.size());
@@ -1806,17 +1810,15 @@ int SyncBlock::_GetFromZeroSyncBlockData(const std::map<uint64_t, std::string>&
 
                             if(!rollbackBlockData.empty())
                             {
-                                std::vector<Node> nodes = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-                                std::vector<Node> qualifyingNode;
-                                for (const auto &node : nodes)
+                                auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+                                std::vector<std::string> nodeAddrs;
+                                nodeAddrs.reserve(peerTable->byAddress.size());
+                                for (const auto &[addr, node] : peerTable->byAddress)
                                 {
-                                    int ret = VerifyBonusAddr(node.address);
-                                    int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-                                    if (stakeTime > 0 && ret == 0)
-                                    {
-                                        qualifyingNode.push_back(node);
-                                    }
+                                    nodeAddrs.push_back(addr);
                                 }
+                                std::vector<std::string> qualifyingNode;
+                                MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, qualifyingNode);
 
                                 if(syncSendZeroSyncNum < qualifyingNode.size())
                                 {
@@ -2044,18 +2046,15 @@ int SyncBlock::_GetSyncBlockHashNode(const std::vector<std::string> &sendNodeIds
 
     if(!rollbackBlockData.empty())
     {
-        std::vector<Node> nodes = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-        std::vector<Node> qualifyingNode;
-        for (const auto &node : nodes)
+        auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+        std::vector<std::string> nodeAddrs;
+        nodeAddrs.reserve(peerTable->byAddress.size());
+        for (const auto &[addr, node] : peerTable->byAddress)
         {
-            int ret = VerifyBonusAddr(node.address);
-
-            int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-            if (stakeTime > 0 && ret == 0)
-            {
-                qualifyingNode.push_back(node);
-            }
+            nodeAddrs.push_back(addr);
         }
+        std::vector<std::string> qualifyingNode;
+        MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, qualifyingNode);
 
         // int peerNodeSize = MagicSingleton<PeerNode>::GetInstance()->GetNodelistSize();
         if(newSyncSnedNum < qualifyingNode.size())
@@ -2193,12 +2192,12 @@ bool SyncBlock::checkByzantine(int receiveCount, int hitCount)
 bool SyncBlock::_NeedByzantineAdjustment(uint64_t chainHeight, const std::vector<std::string> &pledgeAddr,
                                         std::vector<std::string> &selectedAddr)
 {
-    std::vector<Node> nodes = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
+    auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
     std::vector<std::string> qualifyingStakeNodes;
     std::map<std::string, std::pair<uint64_t, std::vector<std::string>>> sumHash;
 
-    return _CheckRequirementAndFilterQualifyingNodes(chainHeight, pledgeAddr, nodes, qualifyingStakeNodes)
-            && _GetSyncNodeSumhashInfo(nodes, qualifyingStakeNodes, sumHash)
+    return _CheckRequirementAndFilterQualifyingNodes(chainHeight, pledgeAddr, *peerTable, qualifyingStakeNodes)
+            && _GetSyncNodeSumhashInfo(*peerTable, qualifyingStakeNodes, sumHash)
             && _GetSelectedAddr(sumHash, selectedAddr);
 }
 
@@ -2245,11 +2244,11 @@ bool SyncBlock::_GetSelectedAddr(std::map<std::string, std::pair<uint64_t, std::
     return false;
 }
 
-bool SyncBlock::_GetSyncNodeSumhashInfo(const std::vector<Node> &nodes, const std::vector<std::string> &qualifyingStakeNodes,
+bool SyncBlock::_GetSyncNodeSumhashInfo(const PeerTable &peerTable, const std::vector<std::string> &qualifyingStakeNodes,
                                        std::map<std::string, std::pair<uint64_t, std::vector<std::string>>> sumHash)
 {
     uint64_t byzantineFailTolerance = 5;
-    if (nodes.size() < global::ca::kNeed_node_threshold)
+    if (peerTable.byAddress.size() < global::ca::kNeed_node_threshold)
     {
         byzantineFailTolerance = 0;
     }
@@ -2302,15 +2301,16 @@ bool SyncBlock::_GetSyncNodeSumhashInfo(const std::vector<Node> &nodes, const st
 }
 
 bool SyncBlock::_CheckRequirementAndFilterQualifyingNodes(uint64_t chainHeight, const std::vector<std::string> &pledgeAddr,
-                                                         const std::vector<Node> &nodes,
+                                                         const PeerTable &peerTable,
                                                          std::vector<std::string> &qualifyingStakeNodes)
 {
     const static uint32_t higherThanChainHeightBar = 3;
     uint32_t higherThanChainHeightCount = 0;
+    std::unordered_set<std::string> pledgeAddrSet(pledgeAddr.cbegin(), pledgeAddr.cend());
 
-    for (const auto& node : nodes)
+    for (const auto& [addr, node] : peerTable.byAddress)
     {
-        if (node.height > chainHeight)
+        if (node->height > chainHeight)
         {
             higherThanChainHeightCount++;
             if (higherThanChainHeightCount > higherThanChainHeightBar)
@@ -2319,10 +2319,10 @@ bool SyncBlock::_CheckRequirementAndFilterQualifyingNodes(uint64_t chainHeight,
                 return false;
             }
         }
-        else if (node.height == chainHeight)
+        else if (node->height == chainHeight)
         {
-            const auto& node_addr = node.address;
-            if (find(pledgeAddr.cbegin(), pledgeAddr.cend(), node_addr) != pledgeAddr.cend())
+            const auto& node_addr = addr;
+            if (pledgeAddrSet.count(node_addr) != 0)
             {
                 qualifyingStakeNodes.push_back(node_addr);
             }
@@ -2430,7 +2430,8 @@ void SendFastSyncGetBlockAck(const std::string &nodeId, const std::string &msgId
     }
     for (auto &block_raw : blocks)
     {
-        CBlock block;
+        ScratchArena arena;
+        auto &block = *arena.Create<CBlock>();
         if(!block.ParseFromString(block_raw))
         {
             return;
@@ -300,24 +300,24 @@ private:
      * 
      * @param       chainHeight: current chain height
      * @param       pledgeAddr: Investment pledge list
-     * @param       nodes: node
+     * @param       peerTable: peers to check
      * @param       qualifyingStakeNodes: qualify stake nodes
      * @return      true    success
      * @return      false   fail
      */
     static bool _CheckRequirementAndFilterQualifyingNodes(uint64_t chainHeight, const std::vector<std::string> &pledgeAddr,
-                const std::vector<Node> &nodes,std::vector<std::string> &qualifyingStakeNodes);
+                const PeerTable &peerTable,std::vector<std::string> &qualifyingStakeNodes);
 
     /**
      * @brief       Get Sync Node Sumhash Info
      * 
-     * @param       nodes: node 
+     * @param       peerTable: peers to ask
      * @param       qualifyingStakeNodes: qualify stake nodes
      * @param       sumHash: sum hash
      * @return      true    success
      * @return      false   fail
      */
-    static bool _GetSyncNodeSumhashInfo(const std::vector<Node> &nodes, const std::vector<std::string> &qualifyingStakeNodes,
+    static bool _GetSyncNodeSumhashInfo(const PeerTable &peerTable, const std::vector<std::string> &qualifyingStakeNodes,
                                        std::map<std::string, std::pair<uint64_t, std::vector<std::string>>> sumHash);
 
     /**
@@ -14,6 +14,7 @@
 #include "ca/block_stroage.h"
 #include "ca/double_spend_cache.h"
 #include "ca/block_http_callback.h"
+#include "ca/block_json_writer.h"
 #include "ca/failed_transaction_cache.h"
 #include "ca/ca.h"
 #include "ca/sync_block.h"
@@ -35,9 +36,11 @@
 #include "utils/magic_singleton.h"
 #include "utils/account_manager.h"
 #include "utils/contract_utils.h"
+#include "utils/timer_wheel.h"
 
 #include "db/db_api.h"
 #include "db/cache.h"
+#include "api/response_cache.h"
 #include "include/logging.h"
 
 int PrintFormatTime(uint64_t time, bool isConsoleOutput, std::ostream & stream)
@@ -422,210 +425,6 @@ int PrintTx(const CTransaction & tx, bool isConsoleOutput, std::ostream & stream
     return 0;
 }
 
-void BlockInvert(const std::string & strHeader, nlohmann::json &blocks)
-{
-    CBlock block;
-    if(!block.ParseFromString(strHeader))
-    {
-        ERRORLOG("block_raw parse fail!");
-        return ;
-        
-    }
-
-    nlohmann::json allTx;
-    nlohmann::json jsonBlock;
-    jsonBlock["merkleroot"] = addHexPrefix(block.merkleroot());
-    jsonBlock["prevhash"] = addHexPrefix(block.prevhash());
-    jsonBlock["hash"] = addHexPrefix(block.hash());
-    jsonBlock["height"] = block.height();
-    jsonBlock["time"] = block.time();
-    jsonBlock["bytes"] = block.ByteSizeLong();
-    if(!block.data().empty())
-    {
-        nlohmann::json blockdataJson = nlohmann::json::parse(block.data());
-        nlohmann::json modifiedJsonData;
-
-        for (auto it = blockdataJson.begin(); it != blockdataJson.end(); ++it) {
-
-            std::string originalKey = it.key();
-            auto value = it.value();
-            if(value.contains("dependentCTx"))
-            {
-                std::set<std::string> tempVec;
-                for(auto & dep : value["dependentCTx"])
-                {
-                    tempVec.insert(addHexPrefix(dep));
-                }
-                value["dependentCTx"] = tempVec;
-            }
-
-            std::string modifiedKey = addHexPrefix(originalKey);
-            modifiedJsonData[modifiedKey] = value;
-        }
-        blockdataJson = modifiedJsonData;
-        jsonBlock["data"] = blockdataJson;
-    }
-    else
-    {
-        jsonBlock["data"] = "";
-    }
-
-    for(auto & blocksign : block.sign())
-    {
-        nlohmann::json block_verifySign;
-        block_verifySign["sign"] = Base64Encode(blocksign.sign());
-        block_verifySign["pub"] = Base64Encode(blocksign.pub());
-        std::string sign_addr = GenerateAddr(blocksign.pub());
-        block_verifySign["signaddr"] = addHexPrefix(sign_addr);
-
-        jsonBlock["blocksign"].push_back(block_verifySign);
-    }
-
-
-    int k = 0;
-    for(auto & tx : block.txs())
-    {
-        nlohmann::json Tx;
-        if(tx.type() == global::ca::kTxSign)
-        {   
-            Tx["time"] = tx.time();
-            Tx["txHash"] = addHexPrefix(tx.hash());
-            Tx["identity"] = addHexPrefix(tx.identity());
-
-            for(auto & owner: tx.utxo().owner())
-            {
-                Tx["utxo"]["owner"].push_back(addHexPrefix(owner));
-            }
-
-            for(auto & vin : tx.utxo().vin())
-            {
-                for(auto &prevout : vin.prevout())
-                {
-                    Tx["utxo"]["vin"]["prevout"]["hash"].push_back(addHexPrefix(prevout.hash()));
-                }
-
-                nlohmann::json utxoVinsign;
-                utxoVinsign["sign"] = Base64Encode(vin.vinsign().sign());
-                utxoVinsign["pub"] = Base64Encode(vin.vinsign().pub());
-
-                Tx["utxo"]["vin"]["vinsign"].push_back(utxoVinsign);
-            }
-            //int count = 0;
-            for(auto & vout : tx.utxo().vout())
-            {
-                nlohmann::json utxoVout;
-                 if(vout.addr().substr(0, 6) == "Virtua")
-                {
-                   utxoVout["addr"] = vout.addr();
-                    
-                }
-                else
-                {
-                    utxoVout["addr"] =  addHexPrefix(vout.addr());
-                }
-                
-                utxoVout["value"] = vout.value();
-
-                Tx["utxo"]["vout"].push_back(utxoVout); 
-                //count += 1;
-            }
-
-            for(auto & multiSign : tx.utxo().multisign())
-            {
-                nlohmann::json utxoMultisign;
-                utxoMultisign["sign"] = Base64Encode(multiSign.sign());
-                utxoMultisign["pub"] = Base64Encode(multiSign.pub());
-
-                Tx["utxo"]["multisign"].push_back(utxoMultisign);
-            }
-
-            Tx["Type"] = tx.type();
-            Tx["info"] = tx.info();
-            Tx["Consensus"] = tx.consensus();
-            Tx["txType"] = tx.txtype();
- 
-            if((global::ca::TxType)tx.txtype() != global::ca::TxType::kTxTypeTx)
-            {
-                nlohmann::json dataJson = nlohmann::json::parse(tx.data());
-                if (dataJson.contains("TxInfo") && dataJson["TxInfo"].contains("BonusAddr")) 
-                {
-                    std::string bonusAddr = dataJson["TxInfo"]["BonusAddr"].get<std::string>();
-                    dataJson["TxInfo"]["BonusAddr"] = addHexPrefix(bonusAddr);
-                }
-                
-                if (dataJson.contains("TxInfo") && dataJson["TxInfo"].contains("DisinvestUtxo")) 
-                {
-                    std::string disinvestUtxo = dataJson["TxInfo"]["DisinvestUtxo"].get<std::string>();
-                    dataJson["TxInfo"]["DisinvestUtxo"] = addHexPrefix(disinvestUtxo);
-                }
-                Tx["data"] = dataJson;
-            }
-
-            for(auto & verifySign : tx.verifysign())
-            {
-                nlohmann::json utxoVerifySign;
-                utxoVerifySign["sign"] = Base64Encode(verifySign.sign());
-                utxoVerifySign["pub"] = Base64Encode(verifySign.pub());
-                std::string signAddr = GenerateAddr(verifySign.pub());
-                utxoVerifySign["signaddr"] = addHexPrefix(signAddr);
-
-                Tx["verifySign"].push_back(utxoVerifySign);
-            }
-            
-            allTx[k++] = FixTxField(Tx);
-        }
-        else if(tx.type() == global::ca::kGenesisSign)
-        {
-            Tx["time"] = tx.time();
-            Tx["txHash"] = addHexPrefix(tx.hash());
-            Tx["identity"] = addHexPrefix(tx.identity());
-
-            for(auto & owner: tx.utxo().owner())
-            {
-                Tx["utxo"]["owner"].push_back(addHexPrefix(owner));
-            }
-
-            for(auto & vin : tx.utxo().vin())
-            {
-                for(auto &prevout : vin.prevout())
-                {
-                    Tx["utxo"]["vin"]["prevout"]["hash"].push_back(addHexPrefix(prevout.hash()));
-                }
-
-                nlohmann::json utxoVinsign;
-                utxoVinsign["sign"] = Base64Encode(vin.vinsign().sign());
-                utxoVinsign["pub"] = Base64Encode(vin.vinsign().pub());
-
-                Tx["utxo"]["vin"]["vinsign"].push_back(utxoVinsign);
-            }
-
-            for(auto & vout : tx.utxo().vout())
-            {
-                nlohmann::json utxoVout;
-                if(vout.addr() == global::ca::kVirtualStakeAddr || vout.addr() == global::ca::kVirtualInvestAddr 
-                    || vout.addr() == global::ca::kVirtualBurnGasAddr ||vout.addr() == global::ca::kVirtualDeployContractAddr || 
-                    vout.addr() == global::ca::kVirtualCallContractAddr)
-                {
-                   utxoVout["addr"] = vout.addr();
-                }else
-                {
-                   utxoVout["addr"] = addHexPrefix(vout.addr());
-                }
-                utxoVout["value"] = vout.value();
-
-                Tx["utxo"]["vout"].push_back(utxoVout); 
-            }
-            Tx["Type"] = tx.type();
-            allTx[k++] = FixTxField(Tx);
-        }
-    }
-
-    blocks["block"] = jsonBlock;
-    blocks["tx"] = allTx;
-
-}
-
-
 std::string PrintCache(int where){
     std::string rocksdbUsage;
     MagicSingleton<RocksDB>::GetInstance()->GetDBMemoryUsage(rocksdbUsage);
@@ -669,6 +468,9 @@ std::string PrintCache(int where){
 
     auto phone_list = global::g_phoneList;
     auto cBlockHttpCallback_ = MagicSingleton<CBlockHttpCallback>::GetInstance();
+    auto apiResponseCache_ = MagicSingleton<ApiResponseCache>::GetInstance();
+    auto timerWheelStats = MagicSingleton<TimerWheel>::GetInstance()->GetStats();
+    auto failedTxMetrics = FailedTransactionCache_cd->GetMetrics();
 
 
     std::stack<std::string> emyp;
@@ -685,7 +487,7 @@ std::string PrintCache(int where){
         CaheString("",UnregisterNode__->_nodes.size());
         CaheString("",UnregisterNode__->_consensusNodeList.size());
         CaheString("", bufcontrol->_BufferMap.size());
-        CaheString("",pernode->_nodeMap.size());
+        CaheString("",pernode->GetNodelistSize());
         CaheString("",dispach->_caProtocbs.size());
         CaheString("",dispach->_netProtocbs.size());
         CaheString("",dispach->_broadcastProtocbs.size());
@@ -693,7 +495,7 @@ std::string PrintCache(int where){
         CaheString("",dispach->_syncBlockProtocbs.size());
         CaheString("",dispach->_saveBlockProtocbs.size());
         CaheString("",dispach->_blockProtocbs.size());
-        CaheString("",global::g_reqCntMap.size());
+        CaheString("",dispach->GetReqCount().size());
         CaheString("",HttpServer::rpcCbs.size());
         CaheString("",HttpServer::_cbs.size());
         CaheString("",_echoCatch->_echoCatch.size());
@@ -702,8 +504,21 @@ std::string PrintCache(int where){
         CaheString("",workThread->_threadsTransList.size());
         CaheString("",phone_list.size());
         CaheString("",cBlockHttpCallback_->_addblocks.size());
+        CaheString("",apiResponseCache_->GetSize());
         CaheString("",GetMutexSize());
-        CaheString("",cBlockHttpCallback_->_rollbackblocks.size(),true);
+        CaheString("",cBlockHttpCallback_->_rollbackblocks.size());
+        CaheString("",timerWheelStats.pending);
+        CaheString("",timerWheelStats.workers);
+        CaheString("",timerWheelStats.fired);
+        CaheString("",timerWheelStats.fired == 0 ? 0 : timerWheelStats.totalDriftMs / timerWheelStats.fired);
+        CaheString("",timerWheelStats.maxDriftMs);
+        CaheString("",failedTxMetrics.pending);
+        CaheString("",failedTxMetrics.added);
+        CaheString("",failedTxMetrics.retried);
+        CaheString("",failedTxMetrics.succeeded);
+        CaheString("",failedTxMetrics.dropped);
+        CaheString("",failedTxMetrics.evicted);
+        CaheString("",DoubleSpendCache_cd->GetSize(),true);
     }
 
     switch (where) {
@@ -722,6 +537,7 @@ std::string PrintCache(int where){
             vrfo->txvrfCache.clear();
             vrfo->vrfVerifyNode.clear();
             manager._globalData.clear();
+            apiResponseCache_->Clear();
 
             phone_list.clear();
         }break;
@@ -749,10 +565,12 @@ std::string PrintCache(int where){
             MagicSingleton<BlockHelper>::DesInstance();
             MagicSingleton<TaskPool>::DesInstance();
             MagicSingleton<CBlockHttpCallback>::DesInstance();
+            MagicSingleton<ApiResponseCache>::DesInstance();
             MagicSingleton<VRF>::DesInstance();
             MagicSingleton<BlockMonitor>::DesInstance();
             MagicSingleton<BlockStroage>::DesInstance();
             MagicSingleton<BonusAddrCache>::DesInstance();
+            MagicSingleton<QualifiedNodeCache>::DesInstance();
             MagicSingleton<DoubleSpendCache>::DesInstance();
             MagicSingleton<FailedTransactionCache>::DesInstance();
             MagicSingleton<SyncBlock>::DesInstance();
@@ -945,168 +763,11 @@ std::string PrintRangeContractBlocks(int startNum,int num, bool preHashFlag)
     return str;
 }
 
-nlohmann::json FixTxField(const nlohmann::json& inTx)
-{
-    nlohmann::json outTx = inTx;
-    if (outTx.contains("data") && outTx["data"].contains("TxInfo") && outTx["data"]["TxInfo"].contains("recipient") && outTx["data"]["TxInfo"].contains("sender")) 
-    {
-        std::string recipient = outTx["data"]["TxInfo"]["recipient"].get<std::string>();
-        outTx["data"]["TxInfo"]["recipient"] = addHexPrefix(recipient);
-
-        std::string sender = outTx["data"]["TxInfo"]["sender"].get<std::string>();
-        outTx["data"]["TxInfo"]["sender"] = addHexPrefix(sender);
-    }
-
-    if (outTx.contains("data") && outTx["data"].contains("TxInfo") && outTx["data"]["TxInfo"].contains("contractDeployer"))     
-    {
-        std::string contractDeployer = outTx["data"]["TxInfo"]["contractDeployer"].get<std::string>();
-        outTx["data"]["TxInfo"]["contractDeployer"] = addHexPrefix(contractDeployer);
-    }
-
-    return outTx;
-}
-
-    
 std::string TxInvet(const CTransaction& tx)
 {
-    nlohmann::json outTxJs;
-    if(tx.type() == global::ca::kTxSign)
-    {   
-        outTxJs["time"] = tx.time();
-        outTxJs["txHash"] = addHexPrefix(tx.hash());
-        outTxJs["identity"] = addHexPrefix(tx.identity());
-
-        for(auto & owner: tx.utxo().owner())
-        {
-            outTxJs["utxo"]["owner"].push_back(addHexPrefix(owner));
-        }
-
-        for(auto & vin : tx.utxo().vin())
-        {
-            for(auto &prevout : vin.prevout())
-            {
-                outTxJs["utxo"]["vin"]["prevout"]["hash"].push_back(addHexPrefix(prevout.hash()));
-            }
-
-            nlohmann::json utxoVinsign;
-            utxoVinsign["sign"] = Base64Encode(vin.vinsign().sign());
-            utxoVinsign["pub"] = Base64Encode(vin.vinsign().pub());
-
-            outTxJs["utxo"]["vin"]["vinsign"].push_back(utxoVinsign);
-        }
-        //int count = 0;
-        for(auto & vout : tx.utxo().vout())
-        {
-            nlohmann::json utxoVout;
-            if(vout.addr().substr(0, 6) == "Virtua")
-            {
-            utxoVout["addr"] = vout.addr();
-                
-            }
-            else
-            {
-                utxoVout["addr"] =  addHexPrefix(vout.addr());
-            }
-            
-            utxoVout["value"] = vout.value();
-
-            outTxJs["utxo"]["vout"].push_back(utxoVout); 
-            //count += 1;
-        }
-
-        for(auto & multiSign : tx.utxo().multisign())
-        {
-            nlohmann::json utxoMultisign;
-            utxoMultisign["sign"] = Base64Encode(multiSign.sign());
-            utxoMultisign["pub"] = Base64Encode(multiSign.sign());
-
-            outTxJs["utxo"]["multisign"].push_back(utxoMultisign);
-        }
-
-        outTxJs["Type"] = tx.type();
-        outTxJs["info"] = tx.info();
-        outTxJs["Consensus"] = tx.consensus();
-        outTxJs["txType"] = tx.txtype();
-
-        if((global::ca::TxType)tx.txtype() != global::ca::TxType::kTxTypeTx)
-        {
-            nlohmann::json dataJson = nlohmann::json::parse(tx.data());
-            // if()
-    
-            if (dataJson.contains("TxInfo") && dataJson["TxInfo"].contains("BonusAddr")) {
-
-            std::string bonusAddr = dataJson["TxInfo"]["BonusAddr"].get<std::string>();
-    
-                
-                dataJson["TxInfo"]["BonusAddr"] = addHexPrefix(bonusAddr);;
-            }
-
-            if (dataJson.contains("TxInfo") && dataJson["TxInfo"].contains("DisinvestUtxo")) 
-            {
-                std::string disinvestUtxo = dataJson["TxInfo"]["DisinvestUtxo"].get<std::string>();
-                dataJson["TxInfo"]["DisinvestUtxo"] = addHexPrefix(disinvestUtxo);
-            }
-
-            outTxJs["data"] = dataJson;
-        }
-
-        for(auto & verifySign : tx.verifysign())
-        {
-            nlohmann::json utxoVerifySign;
-            utxoVerifySign["sign"] = Base64Encode(verifySign.sign());
-            utxoVerifySign["pub"] = Base64Encode(verifySign.pub());
-            std::string signAddr = GenerateAddr(verifySign.pub());
-            utxoVerifySign["signaddr"] = addHexPrefix(signAddr);
-
-            outTxJs["verifySign"].push_back(utxoVerifySign);
-        }
-    }
-    else if(tx.type() == global::ca::kGenesisSign)
-    {
-        outTxJs["time"] = tx.time();
-        outTxJs["txHash"] = addHexPrefix(tx.hash());
-        outTxJs["identity"] = addHexPrefix(tx.identity());
-
-        for(auto & owner: tx.utxo().owner())
-        {
-            outTxJs["utxo"]["owner"].push_back(addHexPrefix(owner));
-        }
-
-        for(auto & vin : tx.utxo().vin())
-        {
-            for(auto &prevout : vin.prevout())
-            {
-                outTxJs["utxo"]["vin"]["prevout"]["hash"].push_back(addHexPrefix(prevout.hash()));
-            }
-
-            nlohmann::json utxoVinsign;
-            utxoVinsign["sign"] = Base64Encode(vin.vinsign().sign());
-            utxoVinsign["pub"] = Base64Encode(vin.vinsign().pub());
-
-            outTxJs["utxo"]["vin"]["vinsign"].push_back(utxoVinsign);
-        }
-
-        for(auto & vout : tx.utxo().vout())
-        {
-            nlohmann::json utxoVout;
-            if(vout.addr() == global::ca::kVirtualStakeAddr || vout.addr() == global::ca::kVirtualInvestAddr 
-                || vout.addr() == global::ca::kVirtualBurnGasAddr ||vout.addr() == global::ca::kVirtualDeployContractAddr || 
-                vout.addr() == global::ca::kVirtualCallContractAddr)
-            {
-            utxoVout["addr"] = vout.addr();
-            }else
-            {
-            utxoVout["addr"] = addHexPrefix(vout.addr());
-            }
-            utxoVout["value"] = vout.value();
-
-            outTxJs["utxo"]["vout"].push_back(utxoVout); 
-        }
-        outTxJs["Type"] = tx.type();
-    }
-
-    nlohmann::json txJs = FixTxField(outTxJs);
-    return txJs.dump();
+    JsonStreamWriter writer;
+    WriteTxJson(writer, tx);
+    return writer.Take();
 }
 
 
@@ -77,13 +77,10 @@ std::string PrintRangeBlocks(int startNum = 0,int num = 0, bool preHashFlag = fa
 /**
  * @brief       
  * 
- * @param       strHeader: 
- * @param       blocks: 
+ * @param       tx: 
+ * @return      std::string 
  */
-
 std::string TxInvet(const CTransaction& tx);
-void BlockInvert(const std::string& strHeader, nlohmann::json& blocks);
-nlohmann::json FixTxField(const nlohmann::json& inTx);
 
 /**
  * @brief       
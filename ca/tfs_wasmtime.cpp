@@ -18,6 +18,42 @@ wasmtime::_Error TFSC::WasmtimeVMhost::GetHostError(){
 }
 
 
+// Batched store calls pack their strings as a 4 byte little endian length followed by the bytes
+static bool _UnpackStrings(std::string_view packed, std::vector<std::string_view> &out)
+{
+    size_t pos = 0;
+    while (pos < packed.size())
+    {
+        if (packed.size() - pos < 4)
+        {
+            return false;
+        }
+        uint32_t len = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            len |= static_cast<uint32_t>(static_cast<uint8_t>(packed[pos + i])) << (8 * i);
+        }
+        pos += 4;
+        if (packed.size() - pos < len)
+        {
+            return false;
+        }
+        out.push_back(packed.substr(pos, len));
+        pos += len;
+    }
+    return true;
+}
+
+static void _PackString(std::string_view str, std::string &packed)
+{
+    uint32_t len = str.size();
+    for (int i = 0; i < 4; i++)
+    {
+        packed.push_back(static_cast<char>((len >> (8 * i)) & 0xff));
+    }
+    packed.append(str);
+}
+
 void TFSC::_wasm_time_init(){
     std::shared_ptr<TFSC::WasmtimeVMhost> hostFunctions =  MagicSingleton<TFSC::WasmtimeVMhost>::GetInstance();
     TFSC::MakeHost<std::string ,std::string>(*hostFunctions,"GetBalance",[](const std::string &fromAddr )->std::string
@@ -51,6 +87,39 @@ void TFSC::_wasm_time_init(){
         return ta->GetValue(str);
     });
 
+    TFSC::MakeHost<void, std::string>(*hostFunctions,"SetStoreBatch",[hostFunctions](const std::string & packed){
+        std::vector<std::string_view> items;
+        if (!_UnpackStrings(packed, items) || items.size() % 2 != 0)
+        {
+            hostFunctions->SetHostError("SetStoreBatch malformed key value list", -5);
+            return;
+        }
+        std::string contractAddr = MagicSingleton<TFSC::StoreManager>::GetInstance()->getCurrentContractAddr();
+        TFSC::WasmStore::ptr store = MagicSingleton<TFSC::StoreManager>::GetInstance()->GetStore(contractAddr);
+        for (size_t i = 0; i < items.size(); i += 2)
+        {
+            store->InsterValue(items[i], items[i + 1]);
+        }
+    });
+
+    TFSC::MakeHost<std::string, std::string>(*hostFunctions,"GetStoreBatch",[hostFunctions](const std::string & packed)->std::string
+    {
+        std::vector<std::string_view> keys;
+        if (!_UnpackStrings(packed, keys))
+        {
+            hostFunctions->SetHostError("GetStoreBatch malformed key list", -6);
+            return std::string();
+        }
+        auto p = MagicSingleton<TFSC::StoreManager>::GetInstance();
+        TFSC::WasmStore::ptr store = p->GetStore(p->getCurrentContractAddr());
+        std::string values;
+        for (auto key : keys)
+        {
+            _PackString(store->GetValue(key), values);
+        }
+        return values;
+    });
+
     TFSC::MakeHost<long long>(*hostFunctions,"GetTime",[]()->long long
     {
         std::cout << "input time:" << std::endl;
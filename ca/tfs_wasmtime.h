@@ -47,6 +47,7 @@
 
 #include "mpt/trie.h"
 #include "utils/tmp_log.h"
+#include "utils/keccak_cryopp.hpp"
 #include <functional>
 #include <string>
 #include <utility>
@@ -3493,160 +3494,255 @@ class TfscWasmtimeVM {
     int64_t GetConsumedCost() { return _consumedCost; }
 
   private:
+    friend class WasmtimeRuntime;
+
     wasmtime::_Result<std::string> _WasmtimeInit(int64_t gas, const std::string &wasmbytes,
-                       const std::string &name) {
+                       const std::string &name);
+    void PushParam(std::vector<uint8_t> &&param) {
+        _params.push_back(std::move(param));
+    }
+    void SetFunName(const std::vector<uint8_t> &fn) {
+        Var<std::string> fN(fn);
+        _funcName = fN.Get();
+    }
+    void Clear() {
+        _params.clear();
+        _result.clear();
+    }
+
+    void Call() {
+
+        auto iter = _callInstance->hostFuncs.find(_funcName);
+        if (iter != _callInstance->hostFuncs.end()) {
+            iter->second->Call(_params);
+            _result = iter->second->GetResult();
+        } else {
+            std::cout << "error not found function " << _funcName << std::endl;
+        }
+    }
+
+  private:
+    std::string _wasmBytes;
+    std::vector<std::vector<uint8_t>> _inputParams;
+    std::vector<std::vector<uint8_t>> _params;
+    std::vector<uint8_t> _result;
+    int64_t _consumedCost;
+    std::string _funcName;
+    WasmtimeVMhost *_callInstance;
+    std::string _RetValue;
+};
+
+/**
+ * @brief       Wasmtime state shared by every TfscWasmtimeVM: one engine, one linker
+ *              with the host functions already defined, and the compiled modules by
+ *              code hash. A call only instantiates its module and runs it.
+ */
+class WasmtimeRuntime {
+  public:
+    WasmtimeRuntime() : _engine(_MakeConfig()), _linker(_engine) { _DefineHostFunctions(); }
+
+    /**
+     * @brief       Get the compiled module of the code, compiling it on first use
+     *
+     * @param       wasmbytes:
+     * @return      std::optional<wasmtime::Module> empty if the code does not compile
+     */
+    std::optional<wasmtime::Module> GetModule(const std::string &wasmbytes) {
+        std::string codeHash = Keccak256Crypt(wasmbytes);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto found = _index.find(codeHash);
+            if (found != _index.end()) {
+                _lru.splice(_lru.begin(), _lru, found->second);
+                return found->second->second;
+            }
+        }
+
+        std::vector<uint8_t> bytes(wasmbytes.begin(), wasmbytes.end());
+        auto compiled = wasmtime::Module::compile(_engine, bytes);
+        if (!compiled) {
+            errorL("wasm module compile fail: %s", compiled.err().message());
+            return std::nullopt;
+        }
+        wasmtime::Module module = compiled.ok();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_index.find(codeHash) == _index.end()) {
+            _lru.emplace_front(codeHash, module);
+            _index[codeHash] = _lru.begin();
+            if (_lru.size() > kMaxModules) {
+                _index.erase(_lru.back().first);
+                _lru.pop_back();
+            }
+        }
+        return module;
+    }
+
+    wasmtime::Engine &GetEngine() { return _engine; }
+    // Only used to instantiate once the host functions are defined, which is safe from any thread
+    wasmtime::Linker &GetLinker() { return _linker; }
+
+    static const size_t kMaxModules = 256;
+
+  private:
+    static wasmtime::Config _MakeConfig() {
         wasmtime::Config config;
         config.consume_fuel(true);
-        wasmtime::Engine engine(std::move(config));
-        std::vector<uint8_t> bytes(wasmbytes.begin(), wasmbytes.end());
-        wasmtime::Module moudle = wasmtime::Module::compile(engine, bytes).ok();
+        return config;
+    }
 
-        wasmtime::Store store(engine);
-        store.context().add_fuel(gas).unwrap();
+    static TfscWasmtimeVM *_VM(wasmtime::Caller &caller) {
+        return std::any_cast<TfscWasmtimeVM *>(caller.context().get_data());
+    }
 
-        wasmtime::WasiConfig wasi;
-        wasi.inherit_argv();
-        wasi.inherit_env();
-        wasi.inherit_stdin();
-        wasi.inherit_stdout();
-        wasi.inherit_stderr();
-        store.context().set_wasi(std::move(wasi)).unwrap();
+    static wasmtime::Span<uint8_t> _Memory(wasmtime::Caller &caller) {
+        auto memory = std::get<wasmtime::Memory>(*caller.get_export("memory"));
+        return memory.data(caller);
+    }
 
-        wasmtime::Linker linker(engine);
-        linker.define_wasi().unwrap();
+    // Guest range [baseAddr, baseAddr + length) in linear memory, nullptr and a host error if out of bounds
+    static uint8_t *_Range(wasmtime::Caller &caller, int32_t baseAddr, int32_t length) {
+        auto mem = _Memory(caller);
+        if (baseAddr < 0 || length < 0 || static_cast<size_t>(baseAddr) + static_cast<size_t>(length) > mem.size()) {
+            errorL("wasm memory access out of bounds addr:%s length:%s size:%s", baseAddr, length, mem.size());
+            _VM(caller)->_callInstance->SetHostError("wasm memory access out of bounds", -4);
+            return nullptr;
+        }
+        return mem.data() + baseAddr;
+    }
 
-        wasmtime::Memory *cum = nullptr;
+    template <typename T>
+    static bool _ReadMemory(wasmtime::Caller &caller, int32_t baseAddr, int32_t length, T &out) {
+        const uint8_t *src = _Range(caller, baseAddr, length);
+        if (src == nullptr) {
+            return false;
+        }
+        out.assign(src, src + length);
+        return true;
+    }
 
-        linker
+    template <typename T>
+    static bool _WriteMemory(wasmtime::Caller &caller, int32_t baseAddr, const T &in) {
+        uint8_t *dst = _Range(caller, baseAddr, static_cast<int32_t>(in.size()));
+        if (dst == nullptr) {
+            return false;
+        }
+        std::copy(in.begin(), in.end(), dst);
+        return true;
+    }
+
+    void _DefineHostFunctions() {
+        _linker.define_wasi().unwrap();
+
+        _linker
             .func_wrap("env", "tfsc_param",
-                       [&](int32_t baseAddr, int32_t length) {
+                       [](wasmtime::Caller caller, int32_t baseAddr, int32_t length) {
                            std::vector<uint8_t> param;
-                           char p = cum->data(store)[baseAddr];
-                           for (int i = 0; i < length; i++) {
-                               param.push_back(
-                                   (char)cum->data(store)[baseAddr + i]);
+                           if (_ReadMemory(caller, baseAddr, length, param)) {
+                               _VM(caller)->PushParam(std::move(param));
                            }
-                           PushParam(param);
                        })
             .ok();
 
-        linker
+        _linker
             .func_wrap("env", "tfsc_result_size",
-                       [&]() -> int32_t { return _result.size(); })
+                       [](wasmtime::Caller caller) -> int32_t { return _VM(caller)->_result.size(); })
             .ok();
 
-        linker
+        _linker
             .func_wrap("env", "tfsc_result",
-                       [&](int32_t baseAddr) {
-                           for (int i = 0; i < _result.size(); i++) {
-                               cum->data(store)[baseAddr + i] = _result[i];
-                           }
-                           Clear();
+                       [](wasmtime::Caller caller, int32_t baseAddr) {
+                           auto vm = _VM(caller);
+                           _WriteMemory(caller, baseAddr, vm->_result);
+                           vm->Clear();
                        })
             .ok();
 
-        linker
+        _linker
             .func_wrap("env", "tfsc_call",
-                       [&](int32_t baseAddr, int32_t lenght) {
-                           std::string funName;
-
-                           for (int i = 0; i < lenght; i++) {
-                               funName.push_back(
-                                   (char)cum->data(store)[baseAddr + i]);
+                       [](wasmtime::Caller caller, int32_t baseAddr, int32_t lenght) {
+                           auto vm = _VM(caller);
+                           if (_ReadMemory(caller, baseAddr, lenght, vm->_funcName)) {
+                               vm->Call();
                            }
-                           _funcName = funName;
-                           Call();
                        })
             .ok();
 
-        linker
+        _linker
             .func_wrap("env", "tfsc_set_run_retvalue",
-                       [&](int32_t baseAddr, int32_t lenght) {
-                           std::string ret;
-                           char p = cum->data(store)[baseAddr];
-                           for (int i = 0; i < lenght; i++) {
-                               ret.push_back(
-                                   (char)cum->data(store)[baseAddr + i]);
-                           }
-                           _RetValue = ret;
+                       [](wasmtime::Caller caller, int32_t baseAddr, int32_t lenght) {
+                           _ReadMemory(caller, baseAddr, lenght, _VM(caller)->_RetValue);
                        })
             .ok();
 
-        linker
+        _linker
             .func_wrap("env", "tfsc_input_param_size",
-                       [&](int index) -> int32_t {
-                           if (index >= _inputParams.size()) {
+                       [](wasmtime::Caller caller, int index) -> int32_t {
+                           auto vm = _VM(caller);
+                           if (index < 0 || index >= vm->_inputParams.size()) {
                                debugL("index:%s out of paramSize:%s", index,
-                                      _inputParams.size());
+                                      vm->_inputParams.size());
                                return 0;
                            }
-                           return _inputParams[index].size();
+                           return vm->_inputParams[index].size();
                        })
             .ok();
 
-        linker
+        _linker
             .func_wrap("env", "tfsc_input_param",
-                       [&](int32_t index, int32_t baseAddr) {
-                           auto ft = _inputParams[index];
-                           wasmtime::Span<uint8_t> s = cum->data(store);
-                           char *p = (char *)s.data();
-                           p = p + baseAddr;
-                           for (int i = 0; i < ft.size(); i++) {
-                               p[i] = ft[i];
+                       [](wasmtime::Caller caller, int32_t index, int32_t baseAddr) {
+                           auto vm = _VM(caller);
+                           if (index < 0 || index >= vm->_inputParams.size()) {
+                               debugL("index:%s out of paramSize:%s", index,
+                                      vm->_inputParams.size());
+                               return;
                            }
+                           _WriteMemory(caller, baseAddr, vm->_inputParams[index]);
                        })
             .ok();
+    }
 
-        auto instance = linker.instantiate(store, moudle).unwrap();
-        auto memory =
-            std::get<wasmtime::Memory>(*instance.get(store, "memory"));
+    wasmtime::Engine _engine;
+    wasmtime::Linker _linker;
 
-        cum = &memory;
+    std::mutex _mutex;
+    // Compiled modules by code hash, most recently used first
+    std::list<std::pair<std::string, wasmtime::Module>> _lru;
+    std::unordered_map<std::string, std::list<std::pair<std::string, wasmtime::Module>>::iterator> _index;
+};
 
-        auto run = std::get<wasmtime::Func>(*instance.get(store, name));
+inline wasmtime::_Result<std::string> TfscWasmtimeVM::_WasmtimeInit(int64_t gas, const std::string &wasmbytes,
+                                                                   const std::string &name) {
+    auto runtime = MagicSingleton<WasmtimeRuntime>::GetInstance();
+    auto moudle = runtime->GetModule(wasmbytes);
+    if (!moudle) {
+        return wasmtime::_Error{"wasm module compile fail", -1};
+    }
 
-       auto res=run.call(store, {});
+    wasmtime::Store store(runtime->GetEngine());
+    store.context().add_fuel(gas).unwrap();
+    store.context().set_data(this);
 
-        _consumedCost = *store.context().fuel_consumed();
-        auto Er=_callInstance->GetHostError();
-        if(Er.er_n!=0){
-            return Er;
-        }
-        return _RetValue;
-    }
-    void PushParam(const std::vector<uint8_t> &param) {
-        _params.push_back(param);
-    }
-    void SetFunName(const std::vector<uint8_t> &fn) {
-        Var<std::string> fN(fn);
-        _funcName = fN.Get();
-    }
-    void Clear() {
-        _params.clear();
-        _result.clear();
-    }
+    wasmtime::WasiConfig wasi;
+    wasi.inherit_argv();
+    wasi.inherit_env();
+    wasi.inherit_stdin();
+    wasi.inherit_stdout();
+    wasi.inherit_stderr();
+    store.context().set_wasi(std::move(wasi)).unwrap();
 
-    void Call() {
+    auto instance = runtime->GetLinker().instantiate(store, *moudle).unwrap();
+    auto run = std::get<wasmtime::Func>(*instance.get(store, name));
 
-        auto iter = _callInstance->hostFuncs.find(_funcName);
-        if (iter != _callInstance->hostFuncs.end()) {
-            iter->second->Call(_params);
-            _result = iter->second->GetResult();
-        } else {
-            std::cout << "error not found function " << _funcName << std::endl;
-        }
-    }
+    auto res = run.call(store, {});
 
-  private:
-    std::string _wasmBytes;
-    std::vector<std::vector<uint8_t>> _inputParams;
-    std::vector<std::vector<uint8_t>> _params;
-    std::vector<uint8_t> _result;
-    int64_t _consumedCost;
-    std::string _funcName;
-    WasmtimeVMhost *_callInstance;
-    std::string _RetValue;
-};
+    _consumedCost = *store.context().fuel_consumed();
+    auto Er = _callInstance->GetHostError();
+    if (Er.er_n != 0) {
+        return Er;
+    }
+    return _RetValue;
+}
 
 class WasmStore {
   public:
@@ -3671,12 +3767,12 @@ class WasmStore {
         storeRoot = std::shared_ptr<Trie>(new Trie(ContractAddr));
     }
 
-    void InsterValue(const std::string &key, const std::string &value) {
-        storeRoot->Update(key, value);
+    void InsterValue(std::string_view key, std::string_view value) {
+        storeRoot->Update(std::string(key), std::string(value));
     }
 
-    std::string GetValue(const std::string &key) {
-        std::string k = key;
+    std::string GetValue(std::string_view key) {
+        std::string k(key);
         return storeRoot->Get(k);
     }
     
@@ -30,12 +30,13 @@
 #include "common/time_report.h"
 #include "common/global_data.h"
 #include "ca/evm/evm_manager.h"
+#include "db/cache.h"
 
 class ContractDataCache;
 
-const int TransactionCache::_kBuildInterval = 3 * 1000;
-const time_t TransactionCache::_kTxExpireInterval  = 10;
-const int TransactionCache::_kBuildThreshold = 1000000;
+const int TransactionCache::_kBuildInterval = 1 * 1000;
+const time_t TransactionCache::_kTxExpireInterval  = 60;
+const int TransactionCache::_kBuildThreshold = 1000;
 
 
 int CreateBlock(const std::list<CTransaction>& txs, const uint64_t& blockHeight, CBlock& cblock)
@@ -226,18 +227,15 @@ int BuildBlock(const std::list<CTransaction>& txs, const uint64_t& blockHeight,
 	return 0;
 }
 
-TransactionCache::TransactionCache()
+TransactionCache::TransactionCache() : _transactionCache(std::chrono::seconds(_kTxExpireInterval))
 {
-    _buildTimer.AsyncLoop(
-        _kBuildInterval, 
-        [=](){ _blockBuilder.notify_one(); }
-        );
 }
 
 uint64_t TransactionCache::getBlockCount()
 {
     std::unique_lock<std::mutex> locker(_transactionCacheMutex);
-    return _transactionCache.rbegin()->GetTxUtxoHeight();
+    auto newest = _transactionCache.Newest();
+    return newest == nullptr ? 0 : newest->GetTxUtxoHeight();
 }
 
 int TransactionCache::AddCache(CTransaction& transaction, const std::shared_ptr<TxMsgReq>& msg)
@@ -247,23 +245,29 @@ int TransactionCache::AddCache(CTransaction& transaction, const std::shared_ptr<
     if (isContractTransaction)
     {
         std::unique_lock<std::mutex> locker(_contractCacheMutex);
-        if(Checker::CheckConflict(transaction, _contractCache))
+        if(_contractOutpoints.CheckConflict(transaction))
         {
             DEBUGLOG("DoubleSpentTransactions, txHash:{}", transaction.hash());
             return -1;
         }
         _contractCache.push_back({transaction, msg->txmsginfo().nodeheight(), false});
+        _contractOutpoints.Add(transaction);
     }
     else
     {
         std::unique_lock<std::mutex> locker(_transactionCacheMutex);
-        if(Checker::CheckConflict(transaction, _transactionCache))
+        if(_transactionOutpoints.CheckConflict(transaction))
         {
             DEBUGLOG("DoubleSpentTransactions, txHash:{}", transaction.hash());
             return -2;
         }
-        _transactionCache.push_back({*msg, transaction, msg->txmsginfo().txutxoheight()});
-        if (_transactionCache.size() >= _kBuildThreshold)
+        if(!_transactionCache.Add({*msg, transaction, msg->txmsginfo().txutxoheight()}))
+        {
+            DEBUGLOG("Transaction already pending, txHash:{}", transaction.hash());
+            return -3;
+        }
+        _transactionOutpoints.Add(transaction);
+        if (_transactionCache.Size() >= _kBuildThreshold)
         {
             _blockBuilder.notify_one();
         }
@@ -280,6 +284,7 @@ bool TransactionCache::Process()
 
 void TransactionCache::Stop(){
     _threadRun=false;
+    _blockBuilder.notify_one();
 }
 
 int TransactionCache::GetBuildBlockHeight(std::vector<TransactionEntity>& txcache)
@@ -294,26 +299,29 @@ int TransactionCache::GetBuildBlockHeight(std::vector<TransactionEntity>& txcach
         }
     }
 
-    std::vector<Node> nodelist = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
+    auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+    std::vector<std::string> nodeAddrs;
+    nodeAddrs.reserve(peerTable->byAddress.size());
+    for(auto & [addr, node] : peerTable->byAddress)
+    {
+        nodeAddrs.push_back(addr);
+    }
+    //Verification of investment and pledge
+    std::vector<std::string> qualifiedAddrs;
+    MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, qualifiedAddrs);
     std::map<std::string, uint64_t> satisfiedAddrs;
-    for(auto & node : nodelist)
+    for(auto & addr : qualifiedAddrs)
     {
-        //Verification of investment and pledge
-        int ret = VerifyBonusAddr(node.address);
-        int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-        if (stakeTime > 0 && ret == 0)
-        {
-            satisfiedAddrs[node.address] = node.height;
-        }
+        satisfiedAddrs[addr] = peerTable->byAddress.at(addr)->height;
     }
 
     if (satisfiedAddrs.size() < global::ca::kNeed_node_threshold && (maxUtxoHeight < global::ca::kMinUnstakeHeight))
 	{
-		for(auto & node : nodelist)
+		for(auto & [addr, node] : peerTable->byAddress)
         {
-            if(satisfiedAddrs.find(node.address) == satisfiedAddrs.end())
+            if(satisfiedAddrs.find(addr) == satisfiedAddrs.end())
             {
-                satisfiedAddrs[node.address] = node.height;
+                satisfiedAddrs[addr] = node->height;
             }
         }
 	}
@@ -407,30 +415,72 @@ int TransactionCache::GetBuildBlockHeight(std::vector<TransactionEntity>& txcach
 
 void TransactionCache::_TransactionCacheProcessingFunc()
 {
+    using Clock = TxPool::Clock;
+    const auto buildLatency = std::chrono::milliseconds(_kBuildInterval);
+    // Set when a batch is kept for another try, so a failing build does not spin
+    Clock::time_point retryAfter = Clock::time_point::min();
+
+    std::unique_lock<std::mutex> locker(_transactionCacheMutex);
     while (_threadRun)
     {
-        std::unique_lock<std::mutex> locker(_transactionCacheMutex);
-        _blockBuilder.wait(locker);
-        //std::vector<cacheIter> emptyHeightCache;
+        auto now = Clock::now();
+        for(auto& expired : _transactionCache.TakeExpired(now))
+        {
+            DEBUGLOG("Pending transaction expired, txHash:{}", expired.GetTx().hash());
+            _transactionOutpoints.Remove(expired.GetTx());
+        }
 
-        //std::list<CTransaction> buildTxs;
-        if(_transactionCache.empty())
+        // Wake up when the oldest transaction has waited out the latency budget or
+        // the next one expires, whichever is first
+        auto wakeUp = Clock::time_point::max();
+        if(auto oldest = _transactionCache.OldestArrival())
+        {
+            wakeUp = std::max(*oldest + buildLatency, retryAfter);
+        }
+        if(auto deadline = _transactionCache.NextDeadline())
         {
+            wakeUp = std::min(wakeUp, *deadline);
+        }
+
+        bool sizeReached = _transactionCache.Size() >= _kBuildThreshold && now >= retryAfter;
+        if(!sizeReached && now < wakeUp)
+        {
+            if(wakeUp == Clock::time_point::max())
+            {
+                _blockBuilder.wait(locker);
+            }
+            else
+            {
+                _blockBuilder.wait_until(locker, wakeUp);
+            }
             continue;
         }
 
+        std::vector<TransactionEntity> batch = _transactionCache.Select(_kBuildThreshold);
+        // The batch stays in the pool, and its outpoints in the index, until the build is over
+        auto dropBatch = [this, &batch]()
+        {
+            for(auto& entity : batch)
+            {
+                _transactionCache.Remove(entity.GetTx().hash());
+                _transactionOutpoints.Remove(entity.GetTx());
+            }
+        };
+        locker.unlock();
+
         ClearBuildTxs();
-        int buildHeight = GetBuildBlockHeight(_transactionCache);
+        int buildHeight = GetBuildBlockHeight(batch);
         if(buildHeight < 0)
         {
-            _transactionCache.clear();
+            locker.lock();
+            dropBatch();
             ERRORLOG("GetBuildBlockHeight fail!!! ret:{}", buildHeight);
             continue;
         }
         MagicSingleton<BlockStroage>::GetInstance()->CommitSeekTask(buildHeight);
 
         std::map<std::string, std::future<int>> taskResults;
-        for(auto& txs : _transactionCache)
+        for(auto& txs : batch)
         {
             auto& tx = txs.GetTx();
             auto& txMsg = txs.GetTxMsg();
@@ -472,27 +522,29 @@ void TransactionCache::_TransactionCacheProcessingFunc()
 
         if(flag)
         {
-            _transactionCache.clear();
+            locker.lock();
+            dropBatch();
             continue; 
         }
 
         auto ret = BuildBlock(_GetBuildTxs(), buildHeight, false);
+        locker.lock();
         if(ret != 0)
         {
             ERRORLOG("{} build block fail", ret);
             if(ret == -103 || ret == -104 || ret == -105)
             {
+                retryAfter = Clock::now() + buildLatency;
                 continue;
             }
             
-            _transactionCache.clear();
+            dropBatch();
             std::cout << "block packaging fail" << std::endl;
             continue;
         }
         std::cout << "block successfully packaged" << std::endl;
-        _transactionCache.clear();
-
-        locker.unlock();
+        dropBatch();
+        retryAfter = Clock::time_point::min();
     }
 }
 
@@ -529,6 +581,7 @@ void TransactionCache::ProcessContract(int64_t topTransactionHeight)
     ON_SCOPE_EXIT{
         removeExpiredEntriesFromDirtyContractMap();
         _contractCache.clear();
+        _contractOutpoints.Clear();
         _contractInfoCache.clear();
     };
 
@@ -931,7 +984,7 @@ void TransactionCache::SetDirtyContractMap(const std::string& transactionHash, c
     std::unique_lock locker(_dirtyContractMapMutex);
     uint64_t currentTime = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
     _dirtyContractMap[transactionHash]= {currentTime, dirtyContract};
-
+    _dirtyContractDeadlines.push({currentTime + 60 * 1000000ull, transactionHash});
 }
 
 bool TransactionCache::GetDirtyContractMap(const std::string& transactionHash, std::set<std::string>& dirtyContract)
@@ -948,17 +1001,18 @@ bool TransactionCache::GetDirtyContractMap(const std::string& transactionHash, s
 
 void TransactionCache::removeExpiredEntriesFromDirtyContractMap()
 {
+    std::unique_lock locker(_dirtyContractMapMutex);
     uint64_t nowTime = MagicSingleton<TimeUtil>::GetInstance()->GetUTCTimestamp();
-    for(auto iter = _dirtyContractMap.begin(); iter != _dirtyContractMap.end();)
+    while(!_dirtyContractDeadlines.empty() && nowTime >= _dirtyContractDeadlines.top().first)
     {
-        if(nowTime >= iter->second.first + 60 * 1000000ull)
+        auto [deadline, txHash] = _dirtyContractDeadlines.top();
+        _dirtyContractDeadlines.pop();
+        // A hash set again later has a newer deadline further down the heap
+        auto iter = _dirtyContractMap.find(txHash);
+        if(iter != _dirtyContractMap.end() && nowTime >= iter->second.first + 60 * 1000000ull)
         {
             DEBUGLOG("remove txHash:{}", iter->first);
-            _dirtyContractMap.erase(iter++);
-        }
-        else
-        {
-            ++iter;
+            _dirtyContractMap.erase(iter);
         }
     }
 }
@@ -1402,6 +1456,7 @@ bool TransactionCache::RemoveContractsCacheTransaction(const std::map<std::strin
     auto it = _contractCache.begin();
     while (it != _contractCache.end()) {
         if (contractTxs.find(it->GetTransaction().hash()) != contractTxs.end()) {
+            _contractOutpoints.Remove(it->GetTransaction());
             it = _contractCache.erase(it); 
         } else {
             ++it;
@@ -1486,17 +1541,14 @@ int _newSeekContractPreHash(const std::list<std::pair<std::string, std::string>>
             DEBUGLOG("GetBlockTop fail!!!");
 
         }
-        std::vector<Node> nodelist = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-        for (const auto &node : nodelist)
+        auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+        std::vector<std::string> nodeAddrs;
+        nodeAddrs.reserve(peerTable->byAddress.size());
+        for (const auto &[addr, node] : peerTable->byAddress)
         {
-            int ret = VerifyBonusAddr(node.address);
-
-            int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-            if (stakeTime > 0 && ret == 0)
-            {
-                pledgeAddr.push_back(node.address);
-            }
+            nodeAddrs.push_back(addr);
         }
+        MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, pledgeAddr);
     }
     std::vector<std::string> sendNodeIds;
     if (GetPrehashFindNode(pledgeAddr.size(), chainHeight, pledgeAddr, sendNodeIds) != 0)
@@ -14,6 +14,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <queue>
 #include <vector>
 #include <string>
 #include <utils/json.hpp>
@@ -23,14 +24,16 @@
 #include "proto/ca_protomsg.pb.h"
 #include "proto/block.pb.h"
 #include "utils/timer.hpp"
+#include "ca/checker.h"
 #include "ca/transaction_entity.h"
+#include "ca/tx_pool.h"
 #include "net/msg_queue.h"
 #include "mpt/trie.h"
 #include "ca/packager_dispatch.h"
 
 /**
  * @brief       Transaction cache class. After the transaction flow ends, add the transaction to this class. 
-                Pack blocks every time a certain interval elapses or when the number of transactions reaches a certain number.
+                A block is started once enough transactions are pending or the oldest of them has waited long enough.
  */
 class TransactionCache
 {
@@ -39,7 +42,9 @@ class TransactionCache
 
     private:
         // Transaction container
-        std::vector<TransactionEntity> _transactionCache;
+        TxPool _transactionCache;
+        // Outpoints spent by _transactionCache
+        Checker::OutpointIndex _transactionOutpoints;
         std::list<CTransaction> buildTxs;
         std::mutex _buildTxsMutex;
 
@@ -48,20 +53,21 @@ class TransactionCache
         std::mutex _transactionCacheMutex;
         // Contract Transaction container
         std::vector<TransactionEntity> _contractCache;
+        // Outpoints spent by _contractCache
+        Checker::OutpointIndex _contractOutpoints;
         // The mutex of the Contract transaction container
         std::mutex _contractCacheMutex;
         // Condition variables are used to package blocks
         std::condition_variable _blockBuilder;
         std::condition_variable _contractPreBlockWaiter;
-        // Timers are used for packing at specific time intervals
-        CTimer _buildTimer;
         // Thread variables are used for packaging
         std::thread _transactionCacheBuildThread;
-        // Packing interval
+        // Longest the oldest pending transaction waits before a block is started (ms)
         static const int _kBuildInterval;
-        // Transaction expiration interval
+        // Pending transactions not packed within this many seconds are dropped
         static const time_t _kTxExpireInterval;
-        // Packaging threshold
+        // A block is started as soon as this many transactions are pending, and takes the
+        // highest paying ones up to this many; the rest wait for the next block
         static const int _kBuildThreshold;
         // cache of contract info
         std::map<std::string, std::pair<nlohmann::json, uint64_t>> _contractInfoCache;
@@ -70,6 +76,8 @@ class TransactionCache
 
         std::string _preContractBlockHash;
          std::map<std::string, std::pair<uint64_t, std::set<std::string> >> _dirtyContractMap;
+        // Expiry time and hash of _dirtyContractMap entries, earliest first
+        std::priority_queue<std::pair<uint64_t, std::string>, std::vector<std::pair<uint64_t, std::string>>, std::greater<>> _dirtyContractDeadlines;
         std::shared_mutex _dirtyContractMapMutex;
         std::atomic<bool> _threadRun = true;
     
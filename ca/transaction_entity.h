@@ -61,6 +61,11 @@ private:
 			return _transaction;
 		}
 
+		inline const CTransaction& GetTx() const
+		{
+			return _transaction;
+		}
+
 		/**
 		 * @brief
 		 * 
@@ -0,0 +1,167 @@
+#include "ca/tx_pool.h"
+
+#include <algorithm>
+
+#include "ca/global.h"
+
+bool TxPool::Add(const TransactionEntity& entity)
+{
+    const auto& tx = entity.GetTx();
+    if (_byHash.find(tx.hash()) != _byHash.end())
+    {
+        return false;
+    }
+
+    auto now = Clock::now();
+    bool expires = _ttl > Clock::duration::zero();
+    Entry entry{entity, GetFee(tx), _nextSeq++, now, expires ? now + _ttl : Clock::time_point::max()};
+    _byArrival.emplace(entry.seq, tx.hash());
+    _byPriority.emplace(entry.fee, entry.seq, tx.hash());
+    if (expires)
+    {
+        _deadlines.push({entry.deadline, {entry.seq, tx.hash()}});
+    }
+    _byHash.emplace(tx.hash(), std::move(entry));
+    return true;
+}
+
+bool TxPool::Remove(const std::string& txHash)
+{
+    auto it = _byHash.find(txHash);
+    if (it == _byHash.end())
+    {
+        return false;
+    }
+    _Erase(it);
+    _PruneDeadlines();
+    return true;
+}
+
+bool TxPool::Contains(const std::string& txHash) const
+{
+    return _byHash.find(txHash) != _byHash.end();
+}
+
+void TxPool::Clear()
+{
+    _byHash.clear();
+    _byArrival.clear();
+    _byPriority.clear();
+    _deadlines = decltype(_deadlines)();
+}
+
+const TransactionEntity* TxPool::Newest() const
+{
+    if (_byArrival.empty())
+    {
+        return nullptr;
+    }
+    return &_byHash.at(_byArrival.rbegin()->second).entity;
+}
+
+std::optional<TxPool::Clock::time_point> TxPool::OldestArrival() const
+{
+    if (_byArrival.empty())
+    {
+        return std::nullopt;
+    }
+    return _byHash.at(_byArrival.begin()->second).arrival;
+}
+
+std::optional<TxPool::Clock::time_point> TxPool::NextDeadline()
+{
+    _PruneDeadlines();
+    if (_deadlines.empty())
+    {
+        return std::nullopt;
+    }
+    return _deadlines.top().first;
+}
+
+std::vector<TransactionEntity> TxPool::TakeExpired(Clock::time_point now)
+{
+    std::vector<TransactionEntity> expired;
+    _PruneDeadlines();
+    while (!_deadlines.empty() && _deadlines.top().first <= now)
+    {
+        auto it = _byHash.find(_deadlines.top().second.second);
+        expired.push_back(std::move(it->second.entity));
+        _Erase(it);
+        _PruneDeadlines();
+    }
+    return expired;
+}
+
+std::vector<TransactionEntity> TxPool::Select(size_t maxCount) const
+{
+    std::vector<const Entry*> selected;
+    selected.reserve(std::min(maxCount, _byPriority.size()));
+    for (const auto& key : _byPriority)
+    {
+        if (selected.size() >= maxCount)
+        {
+            break;
+        }
+        selected.push_back(&_byHash.at(std::get<2>(key)));
+    }
+
+    // Transactions in a block keep the order they arrived in
+    std::sort(selected.begin(), selected.end(), [](const Entry* a, const Entry* b){ return a->seq < b->seq; });
+    std::vector<TransactionEntity> entities;
+    entities.reserve(selected.size());
+    for (const auto* entry : selected)
+    {
+        entities.push_back(entry->entity);
+    }
+    return entities;
+}
+
+uint64_t TxPool::GetFee(const CTransaction& tx)
+{
+    uint64_t fee = 0;
+    for (const auto& vout : tx.utxo().vout())
+    {
+        if (vout.addr() == global::ca::kVirtualBurnGasAddr && vout.value() > 0)
+        {
+            fee += vout.value();
+        }
+    }
+    return fee;
+}
+
+void TxPool::_Erase(std::unordered_map<std::string, Entry>::iterator it)
+{
+    const auto& entry = it->second;
+    _byArrival.erase(entry.seq);
+    _byPriority.erase({entry.fee, entry.seq, it->first});
+    _byHash.erase(it);
+}
+
+void TxPool::_PruneDeadlines()
+{
+    while (!_deadlines.empty())
+    {
+        const auto& [seq, txHash] = _deadlines.top().second;
+        auto it = _byHash.find(txHash);
+        if (it != _byHash.end() && it->second.seq == seq)
+        {
+            break;
+        }
+        _deadlines.pop();
+    }
+
+    // Removed entries behind the top are only dropped when they surface, rebuild
+    // the heap once they make up most of it
+    if (_deadlines.size() > 2 * _byHash.size() + 64)
+    {
+        decltype(_deadlines) live;
+        for (const auto& [txHash, entry] : _byHash)
+        {
+            if (entry.deadline != Clock::time_point::max())
+            {
+                live.push({entry.deadline, {entry.seq, txHash}});
+            }
+        }
+        _deadlines.swap(live);
+    }
+}
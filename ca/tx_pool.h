@@ -0,0 +1,142 @@
+/**
+ * *****************************************************************************
+ * @file        tx_pool.h
+ * @brief       Pending transaction pool of the block packer
+ * @date        2024-06-24
+ * @copyright   tfsc
+ * *****************************************************************************
+ */
+#ifndef _TX_POOL_H_
+#define _TX_POOL_H_
+
+#include <map>
+#include <set>
+#include <queue>
+#include <tuple>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+
+#include "ca/transaction_entity.h"
+
+/**
+ * @brief       Pending transactions indexed by hash, by arrival and by fee.
+ *              Expiry is driven by a deadline heap so nothing is scanned per tick.
+ *              Not thread safe, the owner locks around it.
+ */
+class TxPool
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // A zero ttl keeps transactions until they are removed
+    TxPool(Clock::duration ttl) : _ttl(ttl) {}
+    ~TxPool() = default;
+
+    /**
+     * @brief       Add a transaction to all indexes, its deadline is ttl from now
+     *
+     * @param       entity:
+     * @return      true
+     * @return      false the hash is already pending
+     */
+    bool Add(const TransactionEntity& entity);
+
+    /**
+     * @brief       Remove a transaction from all indexes
+     *
+     * @param       txHash:
+     * @return      true
+     * @return      false the hash is not pending
+     */
+    bool Remove(const std::string& txHash);
+
+    bool Contains(const std::string& txHash) const;
+    size_t Size() const { return _byHash.size(); }
+    bool Empty() const { return _byHash.empty(); }
+    void Clear();
+
+    /**
+     * @brief       The most recently added transaction
+     *
+     * @return      const TransactionEntity* nullptr if empty
+     */
+    const TransactionEntity* Newest() const;
+
+    /**
+     * @brief       When the oldest pending transaction arrived
+     */
+    std::optional<Clock::time_point> OldestArrival() const;
+
+    /**
+     * @brief       When the next pending transaction expires
+     */
+    std::optional<Clock::time_point> NextDeadline();
+
+    /**
+     * @brief       Remove and return the transactions whose deadline is not after now
+     *
+     * @param       now:
+     * @return      std::vector<TransactionEntity>
+     */
+    std::vector<TransactionEntity> TakeExpired(Clock::time_point now);
+
+    /**
+     * @brief       Copy out the highest paying transactions, in arrival order.
+     *              Ties on fee go to the earlier arrival.
+     *
+     * @param       maxCount:
+     * @return      std::vector<TransactionEntity>
+     */
+    std::vector<TransactionEntity> Select(size_t maxCount) const;
+
+    /**
+     * @brief       Gas burnt by the transaction
+     *
+     * @param       tx:
+     * @return      uint64_t
+     */
+    static uint64_t GetFee(const CTransaction& tx);
+
+private:
+    struct Entry
+    {
+        TransactionEntity entity;
+        uint64_t fee;
+        // Arrival order, unique per pool
+        uint64_t seq;
+        Clock::time_point arrival;
+        Clock::time_point deadline;
+    };
+    // Highest fee first, then earliest arrival
+    using PriorityKey = std::tuple<uint64_t, uint64_t, std::string>;
+    struct PriorityCompare
+    {
+        bool operator()(const PriorityKey& a, const PriorityKey& b) const
+        {
+            if (std::get<0>(a) != std::get<0>(b))
+            {
+                return std::get<0>(a) > std::get<0>(b);
+            }
+            return std::get<1>(a) < std::get<1>(b);
+        }
+    };
+    using Deadline = std::pair<Clock::time_point, std::pair<uint64_t, std::string>>;
+
+    void _Erase(std::unordered_map<std::string, Entry>::iterator it);
+    // Drop heap items left behind by removed transactions
+    void _PruneDeadlines();
+
+    Clock::duration _ttl;
+    uint64_t _nextSeq = 0;
+    std::unordered_map<std::string, Entry> _byHash;
+    // seq -> hash
+    std::map<uint64_t, std::string> _byArrival;
+    std::set<PriorityKey, PriorityCompare> _byPriority;
+    // Removal leaves the heap item in place, it is skipped when it surfaces
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> _deadlines;
+};
+
+#endif
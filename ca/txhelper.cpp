@@ -27,6 +27,7 @@
 #include "db/db_api.h"
 #include "ca/evm/evm_environment.h"
 #include "ca/evm/evm_manager.h"
+#include "db/cache.h"
 #include "ca.h"
 
 int TxHelper::GetTxUtxoHeight(const CTransaction &tx, uint64_t& txUtxoHeight)
@@ -226,7 +227,13 @@ int TxHelper::FindUtxo(const std::vector<std::string>& fromAddr,
 		for (const auto& hash : vecUtxoHashs)
 		{
 
-			bool flag = false;
+			// Utxos already spent by a transaction of this node that is not yet in a block
+			bool flag = MagicSingleton<DoubleSpendCache>::GetInstance()->IsPending(hash);
+			if(flag)
+			{
+				DEBUGLOG("utxo {} is pending, skip it", hash);
+				continue;
+			}
 
 			TxHelper::Utxo utxo;
 			utxo.hash = hash;
@@ -661,6 +668,7 @@ int TxHelper::CreateTxTransaction(const std::vector<std::string>& fromAddr,
 	std::string txHash = Getsha256hash(outTx.SerializeAsString());
 	outTx.set_hash(txHash);
 	used.time = outTx.time();
+	used.txHash = txHash;
 
 
 	if(MagicSingleton<DoubleSpendCache>::GetInstance()->AddFromAddr(std::make_pair(*fromAddr.begin(),used)))
@@ -2439,9 +2447,7 @@ std::string TxHelper::GetIdentityNodes()
 		return defaultAddr;
 	}
 	
-	int ret = VerifyBonusAddr(defaultAddr);
-	int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(defaultAddr, global::ca::StakeType::kStakeType_Node);
-	if (stakeTime > 0 && ret == 0)
+	if (MagicSingleton<QualifiedNodeCache>::GetInstance()->IsQualified(defaultAddr))
 	{
 		return defaultAddr;
 	}
@@ -2449,18 +2455,15 @@ std::string TxHelper::GetIdentityNodes()
 }
 
 std::string TxHelper::GetEligibleNodes(){
-	std::vector<Node> nodelist = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-    std::vector<std::string> result_node;
-    for (const auto &node : nodelist)
+	auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+    std::vector<std::string> nodeAddrs;
+    nodeAddrs.reserve(peerTable->byAddress.size());
+    for (const auto &[addr, node] : peerTable->byAddress)
     {
-        int ret = VerifyBonusAddr(node.address);
-
-        int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(node.address, global::ca::StakeType::kStakeType_Node);
-        if (stakeTime > 0 && ret == 0)
-        {
-            result_node.push_back(node.address);
-        }
+        nodeAddrs.push_back(addr);
     }
+    std::vector<std::string> result_node;
+    MagicSingleton<QualifiedNodeCache>::GetInstance()->Filter(nodeAddrs, result_node);
 	auto getNextNumber=[&](int limit) ->int {
 	  	std::random_device seed;
 	 	std::ranlux48 engine(seed());
@@ -99,6 +99,8 @@ int Config::_Parse(nlohmann::json json)
         _httpCallback.port = json[kCfgHttpCallback][kCfgHttpCallbackPort].get<uint32_t>();
         _httpCallback.path = json[kCfgHttpCallback][kCfgHttpCallbackPath].get<std::string>();
         _httpCallback.path = json[kCfgHttpCallback][kCfgHttpCallbackPath].get<std::string>();
+        _httpCallback.batchSize = json[kCfgHttpCallback].value(kCfgHttpCallbackBatchSize, 1u);
+        _httpCallback.maxInFlight = json[kCfgHttpCallback].value(kCfgHttpCallbackMaxInFlight, 1u);
         _httpPort = json[kCfgHttpPort].get<uint32_t>();
         _rpc = json[KRpcApi].get<bool>();
         _info.logo = json[kCfgInfo][kCfgInfoLogo].get<std::string>();
@@ -384,6 +386,16 @@ int Config::FilterHttpCallback(HttpCallback &httpcallback)
     {
         return -2;
     }
+    if(httpcallback.batchSize == 0 || httpcallback.batchSize > 1000)
+    {
+        std::cerr << RED << "http callback batch_size must be in [1, 1000]" << RESET << std::endl;
+        return -3;
+    }
+    if(httpcallback.maxInFlight == 0 || httpcallback.maxInFlight > 16)
+    {
+        std::cerr << RED << "http callback max_in_flight must be in [1, 16]" << RESET << std::endl;
+        return -4;
+    }
     return 0;
 }
 template <typename T>
@@ -49,6 +49,8 @@ public:
         std::string ip;
         std::string path;
         uint32_t port;
+        uint32_t batchSize = 1;
+        uint32_t maxInFlight = 1;
     };
 
     const std::string kConfigFilename = "config.json";
@@ -56,6 +58,8 @@ public:
     const std::string kCfgHttpCallbackIp = "ip";
     const std::string kCfgHttpCallbackPort = "port";
     const std::string kCfgHttpCallbackPath = "path";
+    const std::string kCfgHttpCallbackBatchSize = "batch_size";
+    const std::string kCfgHttpCallbackMaxInFlight = "max_in_flight";
     const std::string kCfgHttpPort = "http_port";
     const std::string KRpcApi = "rpc";
     const std::string kCfgInfo = "info";
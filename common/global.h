@@ -57,6 +57,7 @@ namespace global{
 
     static const int kBlockThreadNumber = 50;
     static const int kWorkThreadNumber = 50;
+    static const int kHttpThreadNumber = 16;
 }
 
 #endif // !_GLOBAL_H
@@ -0,0 +1,48 @@
+#include "./proto_arena.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+    thread_local std::vector<std::unique_ptr<char[]>> freeBlocks;
+}
+
+ScratchArena::ScratchArena()
+{
+    if (freeBlocks.empty())
+    {
+        _block.reset(new char[kBlockSize]);
+    }
+    else
+    {
+        _block = std::move(freeBlocks.back());
+        freeBlocks.pop_back();
+    }
+
+    google::protobuf::ArenaOptions options;
+    options.initial_block = _block.get();
+    options.initial_block_size = kBlockSize;
+    _arena.emplace(options);
+}
+
+ScratchArena::~ScratchArena()
+{
+    // The arena still points into the block until it is gone
+    _arena.reset();
+    if (freeBlocks.size() < kMaxFreeBlocks)
+    {
+        freeBlocks.push_back(std::move(_block));
+    }
+}
+
+std::shared_ptr<google::protobuf::Arena> MakeSharedArena(size_t sizeHint)
+{
+    // Parsed messages take about twice their serialized size
+    const size_t kMinBlock = 1024;
+    const size_t kMaxBlock = 4 * 1024 * 1024;
+    google::protobuf::ArenaOptions options;
+    options.start_block_size = std::clamp(sizeHint * 2, kMinBlock, kMaxBlock);
+    options.max_block_size = std::max(options.start_block_size, (size_t)64 * 1024);
+    return std::make_shared<google::protobuf::Arena>(options);
+}
@@ -0,0 +1,55 @@
+/**
+ * *****************************************************************************
+ * @file        proto_arena.h
+ * @brief       Arenas for parsing protobuf messages without a heap allocation per field
+ * @date        2024-06-24
+ * @copyright   tfsc
+ * *****************************************************************************
+ */
+#ifndef _PROTO_ARENA_H_
+#define _PROTO_ARENA_H_
+
+#include <memory>
+#include <optional>
+
+#include <google/protobuf/arena.h>
+
+/**
+ * @brief       Arena for messages that do not outlive the current scope. Its first block
+ *              comes from a per-thread free list, so a thread that parses one message after
+ *              another reuses the same memory. Scratch arenas may nest.
+ */
+class ScratchArena
+{
+public:
+    ScratchArena();
+    ~ScratchArena();
+    ScratchArena(const ScratchArena &) = delete;
+    ScratchArena &operator=(const ScratchArena &) = delete;
+
+    google::protobuf::Arena *get() { return &*_arena; }
+
+    template <typename T>
+    T *Create()
+    {
+        return google::protobuf::Arena::CreateMessage<T>(get());
+    }
+
+    static const size_t kBlockSize = 64 * 1024;
+    // Blocks kept per thread
+    static const size_t kMaxFreeBlocks = 4;
+
+private:
+    std::unique_ptr<char[]> _block;
+    std::optional<google::protobuf::Arena> _arena;
+};
+
+/**
+ * @brief       Arena for a message handed to other threads, freed with its last owner
+ *
+ * @param       sizeHint: the serialized size of what will be parsed onto it
+ * @return      std::shared_ptr<google::protobuf::Arena>
+ */
+std::shared_ptr<google::protobuf::Arena> MakeSharedArena(size_t sizeHint);
+
+#endif
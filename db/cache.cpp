@@ -3,10 +3,24 @@
 #include <sys/sysinfo.h>
 #include "db/db_api.h"
 #include "ca/global.h"
+#include "ca/algorithm.h"
+#include "ca/transaction.h"
 
 int BonusAddrCache::getAmount(const std::string& bonusAddr, uint64_t& amount)
 {
     amount = 0;
+    // Inside a sync group the reads see blocks that may never be committed, bypass the cache
+    if (DBReadThrough::IsActive())
+    {
+        BonusAddrInfo info;
+        int ret = _Load(bonusAddr, info);
+        if (ret == 0)
+        {
+            amount = info.amount;
+        }
+        return ret;
+    }
+
     std::unique_lock<std::shared_mutex> lock(BonusAddr_mutex);
     if(!bonus_addr_[bonusAddr].dirty)
     {
@@ -22,7 +36,18 @@ int BonusAddrCache::getAmount(const std::string& bonusAddr, uint64_t& amount)
         return 0;
     }
 
-    bonus_addr_[bonusAddr].utxos.clear();
+    auto& info = bonus_addr_[bonusAddr];
+    int ret = _Load(bonusAddr, info);
+    if (ret == 0)
+    {
+        amount = info.amount;
+    }
+    return ret;
+}
+
+int BonusAddrCache::_Load(const std::string& bonusAddr, BonusAddrInfo& info)
+{
+    info.utxos.clear();
     DBReader db_reader;
     std::vector<std::string> addrs;
     auto ret = db_reader.GetInvestAddrsByBonusAddr(bonusAddr, addrs);
@@ -53,7 +78,7 @@ int BonusAddrCache::getAmount(const std::string& bonusAddr, uint64_t& amount)
              DEBUGLOG("DBStatus is {}",ret);
                 return -3;
              }
-            bonus_addr_[bonusAddr].utxos.insert(hash);
+            info.utxos.insert(hash);
 
             CTransaction tx;
             if (!tx.ParseFromString(strTx))
@@ -71,14 +96,13 @@ int BonusAddrCache::getAmount(const std::string& bonusAddr, uint64_t& amount)
             }
             if(sum_invest_amount >= global::ca::kMinInvestAmt && flag)
             {
-                bonus_addr_[bonusAddr].time = tx.time();
+                info.time = tx.time();
                 flag = false;
             }
         }
     }
-    bonus_addr_[bonusAddr].amount = sum_invest_amount;
-    bonus_addr_[bonusAddr].dirty = false;
-    amount = sum_invest_amount;
+    info.amount = sum_invest_amount;
+    info.dirty = false;
     return 0;
 }
 uint64_t BonusAddrCache::getTime(const std::string& bonusAddr)
@@ -97,4 +121,116 @@ void BonusAddrCache::isDirty(const std::string& bonusAddr, bool dirty)
     std::unique_lock<std::shared_mutex> lock(BonusAddr_mutex);
     bonus_addr_[bonusAddr].dirty = dirty;
     return;
-}
\ No newline at end of file
+}
+bool QualifiedNodeCache::_Load(const std::string& addr)
+{
+    int ret = VerifyBonusAddr(addr);
+    int64_t stakeTime = ca_algorithm::GetPledgeTimeByAddr(addr, global::ca::StakeType::kStakeType_Node);
+    return stakeTime > 0 && ret == 0;
+}
+
+bool QualifiedNodeCache::IsQualified(const std::string& addr)
+{
+    std::vector<std::string> qualified;
+    Filter({addr}, qualified);
+    return !qualified.empty();
+}
+
+uint64_t QualifiedNodeCache::Filter(const std::vector<std::string>& addrs, std::vector<std::string>& qualified)
+{
+    // Neither cached answers nor new ones while a sync group is being written, see DBReadThrough
+    if (DBReadThrough::IsActive())
+    {
+        for (auto &addr : addrs)
+        {
+            if (_Load(addr))
+            {
+                qualified.push_back(addr);
+            }
+        }
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        return _version;
+    }
+
+    std::vector<int8_t> states(addrs.size(), -1);
+    uint64_t version = 0;
+    for (uint32_t retry = 0; ; ++retry)
+    {
+        std::vector<size_t> misses;
+        {
+            std::shared_lock<std::shared_mutex> lock(_mutex);
+            version = _version;
+            for (size_t i = 0; i < addrs.size(); ++i)
+            {
+                auto it = _qualified.find(addrs[i]);
+                if (it == _qualified.end())
+                {
+                    misses.push_back(i);
+                    continue;
+                }
+                states[i] = it->second;
+            }
+        }
+        if (misses.empty())
+        {
+            break;
+        }
+
+        // Read the database without the lock, the answers are only kept if no commit
+        // invalidated anything meanwhile
+        for (auto i : misses)
+        {
+            states[i] = _Load(addrs[i]);
+        }
+
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        if (_version == version)
+        {
+            for (auto i : misses)
+            {
+                _qualified[addrs[i]] = states[i];
+            }
+            break;
+        }
+        if (retry + 1 >= kMaxRetry)
+        {
+            DEBUGLOG("qualified node cache keeps changing, answer without caching");
+            version = _version;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < addrs.size(); ++i)
+    {
+        if (states[i] == 1)
+        {
+            qualified.push_back(addrs[i]);
+        }
+    }
+    return version;
+}
+
+void QualifiedNodeCache::Invalidate(const std::set<std::string>& addrs, uint64_t height)
+{
+    if (addrs.empty())
+    {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    for (auto &addr : addrs)
+    {
+        _qualified.erase(addr);
+    }
+    ++_version;
+    if (height != 0)
+    {
+        _height = height;
+    }
+}
+
+uint64_t QualifiedNodeCache::GetVersion(uint64_t& height)
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    height = _height;
+    return _version;
+}
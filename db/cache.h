@@ -6,6 +6,7 @@
 #include <mutex>
 #include <set>
 #include <string>
+#include <vector>
 #include <unordered_map>
 #include <shared_mutex>
 struct BonusAddrInfo
@@ -42,8 +43,58 @@ public:
      */
     void isDirty(const std::string& bonusAddr, bool dirty = true);
 private:
+    static int _Load(const std::string& bonusAddr, BonusAddrInfo& info);
+
     mutable std::shared_mutex BonusAddr_mutex;
     std::map<std::string, BonusAddrInfo> bonus_addr_;
 };
 
+/**
+ * @brief       Whether an address is staked as a node and has enough investment. An answer
+ *              is kept until a committed write changes the stake or the investment of the
+ *              address, each such commit advances the version.
+ */
+class QualifiedNodeCache
+{
+public:
+    /**
+     * @brief       
+     *
+     * @param       addr:
+     * @return      true the address is staked and invested
+     */
+    bool IsQualified(const std::string& addr);
+    /**
+     * @brief       Keep the qualified addresses, all answers are of the same version
+     *
+     * @param       addrs:
+     * @param       qualified:
+     * @return      uint64_t the version of the answers
+     */
+    uint64_t Filter(const std::vector<std::string>& addrs, std::vector<std::string>& qualified);
+    /**
+     * @brief       Called after a commit that changed the stake or investments of addrs
+     *
+     * @param       addrs:
+     * @param       height: block top of the commit, 0 if the commit did not set it
+     */
+    void Invalidate(const std::set<std::string>& addrs, uint64_t height);
+    /**
+     * @brief       
+     *
+     * @param       height: block top of the latest invalidating commit
+     * @return      uint64_t
+     */
+    uint64_t GetVersion(uint64_t& height);
+private:
+    static bool _Load(const std::string& addr);
+
+    static const uint32_t kMaxRetry = 3;
+
+    mutable std::shared_mutex _mutex;
+    std::unordered_map<std::string, bool> _qualified;
+    uint64_t _version = 0;
+    uint64_t _height = 0;
+};
+
 #endif
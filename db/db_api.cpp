@@ -1,8 +1,14 @@
 #include "db/db_api.h"
+
+#include <mutex>
+#include <unordered_map>
+
 #include "utils/magic_singleton.h"
 #include "db/cache.h"
+#include "db/db_format.h"
 #include "include/logging.h"
 #include "utils/string_util.h"
+#include "utils/contract_utils.h"
 #include "ca/global.h"
 
 
@@ -54,6 +60,7 @@ const std::string kContractAddr2DeployUtxo = "contractaddr2deployutxo_";
 const std::string kContractAddr2LatestUtxo = "contractaddr2latestutxo_";
 const std::string kLatestContractBlockHash = "latestcontractblockhash_";
 const std::string kContractMptK = "contractmpt_";
+const std::string kDBFormatVersionKey = "dbformatver_";
 bool DBInit(const std::string &db_path)
 {
     MagicSingleton<RocksDB>::GetInstance()->SetDBPath(db_path);
@@ -70,6 +77,70 @@ void DBDestory()
     MagicSingleton<RocksDB>::DesInstance();
 }
 
+namespace
+{
+    // Set by DBReadThrough
+    thread_local DBReader *readThrough = nullptr;
+
+    // What the open transaction of a DBReadWriter changed in data that in-memory caches hold,
+    // invalidated once it commits. Kept outside DBReadWriter so that its layout stays the one
+    // the prebuilt ca_core library was compiled against.
+    struct PendingInvalidation
+    {
+        std::set<std::string> qualificationChangedAddrs;
+        uint64_t blockTop = 0;
+        std::set<std::string> contractCodeChangedAddrs;
+    };
+    std::mutex pendingInvalidationMutex;
+    std::unordered_map<const DBReadWriter *, PendingInvalidation> pendingInvalidations;
+
+    void AddQualificationChanged(const DBReadWriter *writer, const std::string &addr)
+    {
+        std::lock_guard<std::mutex> lock(pendingInvalidationMutex);
+        pendingInvalidations[writer].qualificationChangedAddrs.insert(addr);
+    }
+
+    void AddContractCodeChanged(const DBReadWriter *writer, const std::string &contractAddr)
+    {
+        std::lock_guard<std::mutex> lock(pendingInvalidationMutex);
+        pendingInvalidations[writer].contractCodeChangedAddrs.insert(contractAddr);
+    }
+
+    void SetPendingBlockTop(const DBReadWriter *writer, uint64_t blockTop)
+    {
+        std::lock_guard<std::mutex> lock(pendingInvalidationMutex);
+        pendingInvalidations[writer].blockTop = blockTop;
+    }
+
+    PendingInvalidation TakePendingInvalidation(const DBReadWriter *writer)
+    {
+        std::lock_guard<std::mutex> lock(pendingInvalidationMutex);
+        auto found = pendingInvalidations.find(writer);
+        if (found == pendingInvalidations.end())
+        {
+            return {};
+        }
+        PendingInvalidation pending = std::move(found->second);
+        pendingInvalidations.erase(found);
+        return pending;
+    }
+}
+
+DBReadThrough::DBReadThrough(DBReadWriter &writer)
+{
+    readThrough = &writer;
+}
+
+DBReadThrough::~DBReadThrough()
+{
+    readThrough = nullptr;
+}
+
+bool DBReadThrough::IsActive()
+{
+    return readThrough != nullptr;
+}
+
 DBReader::DBReader() : db_reader_(MagicSingleton<RocksDB>::GetInstance())
 {
 }
@@ -534,7 +605,25 @@ DBStatus DBReader::GetContractAddrByDeployerAddr(const std::string &deployerAddr
 DBStatus DBReader::GetContractCodeByContractAddr(const std::string &contractAddr, std::string &contractCode)
 {
     std::string db_key = kContractAddr2ContractCode + contractAddr;
-    return ReadData(db_key, contractCode);
+    std::string stored;
+    auto ret = ReadData(db_key, stored);
+    if (DBStatus::DB_SUCCESS == ret)
+    {
+        contractCode = db_format::StoredToHex(stored);
+    }
+    return ret;
+}
+
+DBStatus DBReader::GetContractCodeBytesByContractAddr(const std::string &contractAddr, std::string &contractCode)
+{
+    std::string db_key = kContractAddr2ContractCode + contractAddr;
+    std::string stored;
+    auto ret = ReadData(db_key, stored);
+    if (DBStatus::DB_SUCCESS == ret)
+    {
+        contractCode = db_format::StoredToBytes(stored);
+    }
+    return ret;
 }
 DBStatus DBReader::GetContractDeployUtxoByContractAddr(const std::string &contractAddr, std::string &contractDeployUtxo)
 {
@@ -551,7 +640,97 @@ DBStatus DBReader::GetLatestUtxoByContractAddr(const std::string &contractAddr,
 DBStatus DBReader::GetMptValueByMptKey(const std::string &mptKey, std::string &MptValue)
 {
     std::string db_key = kContractMptK + mptKey;
-    return ReadData(db_key, MptValue);
+    std::string stored;
+    auto ret = ReadData(db_key, stored);
+    if (DBStatus::DB_SUCCESS == ret)
+    {
+        MptValue = db_format::StoredToHex(stored);
+    }
+    return ret;
+}
+
+DBStatus DBReader::GetMptNodeBytesByMptKey(const std::string &mptKey, std::string &mptNode)
+{
+    std::string db_key = kContractMptK + mptKey;
+    std::string stored;
+    auto ret = ReadData(db_key, stored);
+    if (DBStatus::DB_SUCCESS == ret)
+    {
+        mptNode = db_format::StoredToBytes(stored);
+    }
+    return ret;
+}
+
+DBStatus DBReader::GetMptValuesByMptKeys(const std::vector<std::string> &mptKeys, std::vector<std::string> &mptValues)
+{
+    std::vector<std::string> keys;
+    keys.reserve(mptKeys.size());
+    for (auto &mptKey : mptKeys)
+    {
+        keys.push_back(kContractMptK + mptKey);
+    }
+    auto ret = MultiReadData(keys, mptValues);
+    for (auto &value : mptValues)
+    {
+        if (!value.empty())
+        {
+            value = db_format::StoredToBytes(value);
+        }
+    }
+    return ret;
+}
+
+DBStatus DBReader::GetDBFormatVersion(uint32_t &version)
+{
+    std::string value;
+    auto ret = ReadData(kDBFormatVersionKey, value);
+    if (DBStatus::DB_NOT_FOUND == ret)
+    {
+        version = db_format::kHexFormat;
+        return DBStatus::DB_SUCCESS;
+    }
+    if (DBStatus::DB_SUCCESS == ret)
+    {
+        try
+        {
+            version = std::stoul(value);
+        }
+        catch (...)
+        {
+            return DBStatus::DB_ERROR;
+        }
+    }
+    return ret;
+}
+
+DBStatus DBReader::GetMptEntries(const std::string &startKey, size_t limit, std::vector<std::string> &mptKeys, std::vector<std::string> &values)
+{
+    std::vector<std::string> keys;
+    if (!db_reader_.ReadByPrefix(kContractMptK, kContractMptK + startKey, limit, keys, values))
+    {
+        return DBStatus::DB_ERROR;
+    }
+    mptKeys.clear();
+    for (auto &key : keys)
+    {
+        mptKeys.push_back(key.substr(kContractMptK.size()));
+    }
+    return DBStatus::DB_SUCCESS;
+}
+
+DBStatus DBReader::GetContractCodeEntries(const std::string &startKey, size_t limit, std::vector<std::string> &contractAddrs, std::vector<std::string> &values)
+{
+    std::vector<std::string> keys;
+    if (!db_reader_.ReadByPrefix(kContractAddr2ContractCode, kContractAddr2ContractCode + startKey, limit, keys, values))
+    {
+        return DBStatus::DB_ERROR;
+    }
+    contractAddrs.clear();
+    for (auto &key : keys)
+    {
+        contractAddrs.push_back(key.substr(kContractAddr2ContractCode.size()));
+    }
+    return DBStatus::DB_SUCCESS;
 }
 
 DBStatus DBReader::GetInitVer(std::string &version)
@@ -571,6 +750,11 @@ DBStatus DBReader::MultiReadData(const std::vector<std::string> &keys, std::vect
     {
         return DBStatus::DB_PARAM_NULL;
     }
+    // DBReadWriter overrides this, so a writer never reads through itself
+    if (readThrough != nullptr)
+    {
+        return readThrough->MultiReadData(keys, values);
+    }
 
     std::vector<std::string> cache_values;
     std::vector<rocksdb::Slice> db_keys;
@@ -617,6 +801,10 @@ DBStatus DBReader::ReadData(const std::string &key, std::string &value)
     {
         return DBStatus::DB_PARAM_NULL;
     }
+    if (readThrough != nullptr)
+    {
+        return readThrough->ReadData(key, value);
+    }
 
     rocksdb::Status ret_status;
     if (db_reader_.ReadData(key, value, ret_status))
@@ -640,6 +828,7 @@ DBReadWriter::DBReadWriter(const std::string &txn_name) : db_read_writer_(MagicS
 DBReadWriter::~DBReadWriter()
 {
     TransactionRollBack();
+    TakePendingInvalidation(this);
 }
 DBStatus DBReadWriter::ReTransactionInit()
 {
@@ -649,6 +838,7 @@ DBStatus DBReadWriter::ReTransactionInit()
         return ret;
     }
     auto_oper_trans = true;
+    TakePendingInvalidation(this);
     if (!db_read_writer_.TransactionInit())
     {
         ERRORLOG("transction init error");
@@ -663,12 +853,38 @@ DBStatus DBReadWriter::TransactionCommit()
     if (db_read_writer_.TransactionCommit(ret_status))
     {
         auto_oper_trans = false;
+        auto pending = TakePendingInvalidation(this);
+        MagicSingleton<QualifiedNodeCache>::GetInstance()->Invalidate(pending.qualificationChangedAddrs, pending.blockTop);
+        MagicSingleton<evm_utils::ContractCodeCache>::GetInstance()->Invalidate(pending.contractCodeChangedAddrs);
         return DBStatus::DB_SUCCESS;
     }
     ERRORLOG("TransactionCommit faild:{}:{}", ret_status.code(), ret_status.ToString());
     return DBStatus::DB_ERROR;
 }
 
+DBStatus DBReadWriter::SetSavePoint()
+{
+    if (!db_read_writer_.SetSavePoint())
+    {
+        return DBStatus::DB_ERROR;
+    }
+    return DBStatus::DB_SUCCESS;
+}
+
+DBStatus DBReadWriter::RollbackToSavePoint()
+{
+    rocksdb::Status ret_status;
+    if (!db_read_writer_.RollbackToSavePoint(ret_status))
+    {
+        return DBStatus::DB_ERROR;
+    }
+    return DBStatus::DB_SUCCESS;
+}
+
+uint64_t DBReadWriter::GetLockedKeyCount()
+{
+    return db_read_writer_.GetNumKeys();
+}
 
 // Sets the height of the data block by block hash
 DBStatus DBReadWriter::SetBlockHeightByBlockHash(const std::string &blockHash, const unsigned int blockHeight)
@@ -760,6 +976,7 @@ DBStatus DBReadWriter::RemoveTopThousandSumhash(const uint64_t &thousandNum)
 // Set the highest block
 DBStatus DBReadWriter::SetBlockTop(const unsigned int blockHeight)
 {
+    SetPendingBlockTop(this, blockHeight);
     return WriteData(kBlockTopKey, std::to_string(blockHeight));
 }
 
@@ -881,6 +1098,7 @@ DBStatus DBReadWriter::DeleteBalanceByAddress(const std::string &address)
 // Set the staking address
 DBStatus DBReadWriter::SetStakeAddresses(const std::string &address)
 {
+    AddQualificationChanged(this, address);
     return MergeValue(kStakeAddrKey, address);
 }
 
@@ -888,6 +1106,7 @@ DBStatus DBReadWriter::SetStakeAddresses(const std::string &address)
 // Remove the staking address from the database
 DBStatus DBReadWriter::RemoveStakeAddresses(const std::string &address)
 {
+    AddQualificationChanged(this, address);
     return RemoveMergeValue(kStakeAddrKey, address);
 }
 
@@ -909,6 +1128,7 @@ DBStatus DBReadWriter::RemoveMutliSignAddresses(const std::string &address)
 // Set up UTXO for the Holddown Asset Account
 DBStatus DBReadWriter::SetStakeAddressUtxo(const std::string &stakeAddr, const std::string &utxo)
 {
+    AddQualificationChanged(this, stakeAddr);
     std::string db_key = kStakeAddrKey + stakeAddr;
     return MergeValue(db_key, utxo);
 }
@@ -916,6 +1136,7 @@ DBStatus DBReadWriter::SetStakeAddressUtxo(const std::string &stakeAddr, const s
 // Remove the UTXO from the data
 DBStatus DBReadWriter::RemoveStakeAddressUtxo(const std::string &stakeAddr, const std::string &utxo)
 {
+    AddQualificationChanged(this, stakeAddr);
     std::string db_key = kStakeAddrKey + stakeAddr;
     return RemoveMergeValue(db_key, utxo);
 }
@@ -956,6 +1177,7 @@ DBStatus DBReadWriter::RemoveBonusAddr(const std::string &bonusAddr)
 // Set the delegated staking address Invest_A:X_Y_Z
 DBStatus DBReadWriter::SetInvestAddrByBonusAddr(const std::string &bonusAddr, const std::string& investAddr)
 {
+    AddQualificationChanged(this, bonusAddr);
     std::string db_key = kBonusAddr2InvestAddrKey + bonusAddr;
     return MergeValue(db_key, investAddr);
 }
@@ -964,6 +1186,7 @@ DBStatus DBReadWriter::SetInvestAddrByBonusAddr(const std::string &bonusAddr, co
 // Remove the delegated staking address from the database
 DBStatus DBReadWriter::RemoveInvestAddrByBonusAddr(const std::string &bonusAddr, const std::string& investAddr)
 {
+    AddQualificationChanged(this, bonusAddr);
     std::string db_key = kBonusAddr2InvestAddrKey + bonusAddr;
     return RemoveMergeValue(db_key, investAddr);
 }
@@ -989,6 +1212,7 @@ DBStatus DBReadWriter::RemoveBonusAddrByInvestAddr(const std::string &investAddr
 DBStatus DBReadWriter::SetBonusAddrInvestAddrUtxoByBonusAddr(const std::string &bonusAddr, const std::string &investAddr, const std::string &utxo)
 {
     MagicSingleton<BonusAddrCache>::GetInstance()->isDirty(bonusAddr);
+    AddQualificationChanged(this, bonusAddr);
     std::string db_key = kBonusAddrInvestAddr2InvestAddrUtxo + bonusAddr + "_" + investAddr;
     return MergeValue(db_key, utxo);
 }
@@ -998,6 +1222,7 @@ DBStatus DBReadWriter::SetBonusAddrInvestAddrUtxoByBonusAddr(const std::string &
 DBStatus DBReadWriter::RemoveBonusAddrInvestAddrUtxoByBonusAddr(const std::string &bonusAddr, const std::string &investAddr, const std::string &utxo)
 {
     MagicSingleton<BonusAddrCache>::GetInstance()->isDirty(bonusAddr);
+    AddQualificationChanged(this, bonusAddr);
     std::string db_key = kBonusAddrInvestAddr2InvestAddrUtxo + bonusAddr + "_" + investAddr;
     return RemoveMergeValue(db_key, utxo);
 }
@@ -1058,12 +1283,14 @@ DBStatus DBReadWriter::RemoveContractAddrByDeployerAddr(const std::string &deplo
 DBStatus DBReadWriter::SetContractCodeByContractAddr(const std::string &contractAddr, const std::string &contractCode)
 {
     std::string db_key = kContractAddr2ContractCode + contractAddr;
-    return WriteData(db_key, contractCode);
+    AddContractCodeChanged(this, contractAddr);
+    return WriteData(db_key, db_format::HexToStored(contractCode));
 }
 
 DBStatus DBReadWriter::RemoveContractCodeByContractAddr(const std::string &contractAddr)
 {
     std::string db_key = kContractAddr2ContractCode + contractAddr;
+    AddContractCodeChanged(this, contractAddr);
     return DeleteData(db_key);
 }
 
@@ -1094,7 +1321,7 @@ DBStatus DBReadWriter::RemoveLatestUtxoByContractAddr(const std::string &contrac
 DBStatus DBReadWriter::SetMptValueByMptKey(const std::string &mptKey, const std::string &MptValue)
 {
     std::string db_key = kContractMptK + mptKey;
-    return WriteData(db_key, MptValue);
+    return WriteData(db_key, db_format::HexToStored(MptValue));
 }
 DBStatus DBReadWriter::RemoveMptValueByMptKey(const std::string &mptKey)
 {
@@ -1176,6 +1403,42 @@ DBStatus DBReadWriter::SetInitVer(const std::string &version)
     return WriteData(kInitVersionKey, version);
 }
 
+DBStatus DBReadWriter::SetDBFormatVersion(uint32_t version)
+{
+    return WriteData(kDBFormatVersionKey, std::to_string(version));
+}
+
+DBStatus DBReadWriter::ConvertMptValueToBinary(const std::string &mptKey)
+{
+    return ConvertToBinary(kContractMptK + mptKey);
+}
+
+DBStatus DBReadWriter::ConvertContractCodeToBinary(const std::string &contractAddr)
+{
+    return ConvertToBinary(kContractAddr2ContractCode + contractAddr);
+}
+
+DBStatus DBReadWriter::ConvertToBinary(const std::string &key)
+{
+    std::string value;
+    rocksdb::Status ret_status;
+    if (!db_read_writer_.ReadForUpdate(key, value, ret_status))
+    {
+        return ret_status.IsNotFound() ? DBStatus::DB_NOT_FOUND : DBStatus::DB_ERROR;
+    }
+    // Written by a newer node in the meantime, or not canonical hex
+    if (db_format::IsBinary(value))
+    {
+        return DBStatus::DB_SUCCESS;
+    }
+    std::string stored = db_format::HexToStored(value);
+    if (stored == value)
+    {
+        return DBStatus::DB_SUCCESS;
+    }
+    return WriteData(key, stored);
+}
+
 DBStatus DBReadWriter::TransactionRollBack()
 {
     if (auto_oper_trans)
@@ -331,6 +331,14 @@ public:
     DBStatus GetContractAddrByDeployerAddr(const std::string &deployerAddr, std::vector<std::string> &contractAddr);
 
     DBStatus GetContractCodeByContractAddr(const std::string &contractAddr, std::string &contractCode);
+    /**
+     * @brief       Get the contract code as raw bytes, without the hex round trip
+     * 
+     * @param       contractAddr:
+     * @param       contractCode:
+     * @return      DBStatus
+     */
+    DBStatus GetContractCodeBytesByContractAddr(const std::string &contractAddr, std::string &contractCode);
     /**
      * @brief       Get the utxo of the contract deployment from the contract address
      * 
@@ -355,6 +363,22 @@ public:
      * @return      DBStatus
      */
     DBStatus GetMptValueByMptKey(const std::string &mptKey, std::string &mptValue);
+    /**
+     * @brief       Get the rlp encoded mpt node as raw bytes, without the hex round trip
+     * 
+     * @param       mptKey:
+     * @param       mptNode:
+     * @return      DBStatus
+     */
+    DBStatus GetMptNodeBytesByMptKey(const std::string &mptKey, std::string &mptNode);
+    /**
+     * @brief       Read several mpt nodes at once as raw bytes, a missing node leaves its value empty
+     * 
+     * @param       mptKeys:
+     * @param       mptValues:
+     * @return      DBStatus
+     */
+    DBStatus GetMptValuesByMptKeys(const std::vector<std::string> &mptKeys, std::vector<std::string> &mptValues);
     /**
 	 * @brief       Read the program version that initializes the database
 	 *
@@ -362,6 +386,33 @@ public:
 	 * @return      DBStatus
 	 */
 	DBStatus GetInitVer(std::string &version);
+    /**
+     * @brief       Read the storage format of mpt nodes and contract code, see db_format.h
+     * 
+     * @param       version:
+     * @return      DBStatus
+     */
+    DBStatus GetDBFormatVersion(uint32_t &version);
+    /**
+     * @brief       Scan stored mpt nodes in key order, values are returned as stored
+     * 
+     * @param       startKey: first mpt key to return, empty to start from the beginning
+     * @param       limit:
+     * @param       mptKeys:
+     * @param       values:
+     * @return      DBStatus
+     */
+    DBStatus GetMptEntries(const std::string &startKey, size_t limit, std::vector<std::string> &mptKeys, std::vector<std::string> &values);
+    /**
+     * @brief       Scan stored contract code in key order, values are returned as stored
+     * 
+     * @param       startKey: first contract address to return, empty to start from the beginning
+     * @param       limit:
+     * @param       contractAddrs:
+     * @param       values:
+     * @return      DBStatus
+     */
+    DBStatus GetContractCodeEntries(const std::string &startKey, size_t limit, std::vector<std::string> &contractAddrs, std::vector<std::string> &values);
     /**
      * @brief       
      * 
@@ -404,6 +455,24 @@ public:
      * @return      DBStatus
      */
     DBStatus TransactionCommit();
+    /**
+     * @brief       Mark the transaction so the writes after it can be undone on their own
+     * 
+     * @return      DBStatus
+     */
+    DBStatus SetSavePoint();
+    /**
+     * @brief       Undo the writes since the last save point, the ones before it stay
+     * 
+     * @return      DBStatus
+     */
+    DBStatus RollbackToSavePoint();
+    /**
+     * @brief       Number of keys the transaction holds locks on, other writers wait for them
+     * 
+     * @return      uint64_t
+     */
+    uint64_t GetLockedKeyCount();
 
     /**
      * @brief       Set the height of the data block through the block hash
@@ -966,8 +1035,36 @@ public:
      * @return      DBStatus
      */
     DBStatus SetInitVer(const std::string &version);
+    /**
+     * @brief       Record the storage format of mpt nodes and contract code
+     *
+     * @param       version:
+     * @return      DBStatus
+     */
+    DBStatus SetDBFormatVersion(uint32_t version);
+    /**
+     * @brief       Rewrite a hex encoded mpt node in the binary format, locking it until commit
+     *
+     * @param       mptKey:
+     * @return      DBStatus
+     */
+    DBStatus ConvertMptValueToBinary(const std::string &mptKey);
+    /**
+     * @brief       Rewrite hex encoded contract code in the binary format, locking it until commit
+     *
+     * @param       contractAddr:
+     * @return      DBStatus
+     */
+    DBStatus ConvertContractCodeToBinary(const std::string &contractAddr);
 
 private:
+    /**
+     * @brief       
+     *
+     * @param       key:
+     * @return      DBStatus
+     */
+    DBStatus ConvertToBinary(const std::string &key);
     /**
      * @brief       
      *
@@ -1029,4 +1126,30 @@ private:
     bool auto_oper_trans;
 };
 
+/**
+ * @brief       While alive, the point reads of every DBReader created on this thread go through
+ *              writer's transaction, so code that opens its own reader sees what writer has not
+ *              committed yet. DBReadWriters keep reading their own transaction. Scopes do not nest.
+ *              In-memory caches neither answer nor keep reads made inside a scope, since what
+ *              they would hold may never be committed.
+ */
+class DBReadThrough
+{
+public:
+    explicit DBReadThrough(DBReadWriter &writer);
+    ~DBReadThrough();
+
+    /**
+     * @brief       
+     * 
+     * @return      true a scope is open on this thread
+     * @return      false 
+     */
+    static bool IsActive();
+    DBReadThrough(DBReadThrough &&) = delete;
+    DBReadThrough(const DBReadThrough &) = delete;
+    DBReadThrough &operator=(DBReadThrough &&) = delete;
+    DBReadThrough &operator=(const DBReadThrough &) = delete;
+};
+
 #endif
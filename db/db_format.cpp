@@ -0,0 +1,174 @@
+#include "db/db_format.h"
+
+#include <chrono>
+#include <algorithm>
+
+#include "db/db_api.h"
+#include "include/logging.h"
+#include "utils/hex_code.h"
+
+std::string db_format::HexToStored(const std::string &hex)
+{
+    std::string bytes = Hex2Str(hex);
+    if (bytes.empty() || Str2Hex(bytes) != hex)
+    {
+        return hex;
+    }
+    return kBinaryTag + bytes;
+}
+
+std::string db_format::StoredToHex(const std::string &stored)
+{
+    if (!IsBinary(stored))
+    {
+        return stored;
+    }
+    return Str2Hex(stored.substr(1));
+}
+
+std::string db_format::StoredToBytes(const std::string &stored)
+{
+    if (!IsBinary(stored))
+    {
+        return Hex2Str(stored);
+    }
+    return stored.substr(1);
+}
+
+void DBFormatMigration::Start()
+{
+    if (_thread.joinable())
+    {
+        return;
+    }
+    uint32_t version = 0;
+    DBReader dbReader;
+    if (dbReader.GetDBFormatVersion(version) == DBStatus::DB_SUCCESS && version >= db_format::kBinaryFormat)
+    {
+        return;
+    }
+    _stop = false;
+    _thread = std::thread(&DBFormatMigration::_Work, this);
+}
+
+void DBFormatMigration::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_stopMutex);
+        _stop = true;
+    }
+    _stopCv.notify_all();
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+void DBFormatMigration::_Work()
+{
+    INFOLOG("db format migration start");
+    for (auto family : {Family::kMptNode, Family::kContractCode})
+    {
+        if (_Migrate(family) != 0)
+        {
+            INFOLOG("db format migration interrupted");
+            return;
+        }
+    }
+
+    uint32_t retryIntervalMs = kRetryMinIntervalMs;
+    while (!_stop)
+    {
+        DBReadWriter dbReadWriter;
+        if (dbReadWriter.SetDBFormatVersion(db_format::kBinaryFormat) == DBStatus::DB_SUCCESS
+            && dbReadWriter.TransactionCommit() == DBStatus::DB_SUCCESS)
+        {
+            INFOLOG("db format migration finish");
+            return;
+        }
+        WARNLOG("db format migration fail to save version, retry in {} ms", retryIntervalMs);
+        _Sleep(retryIntervalMs);
+        retryIntervalMs = std::min(retryIntervalMs * 2, kRetryMaxIntervalMs);
+    }
+}
+
+int DBFormatMigration::_Migrate(Family family)
+{
+    std::string startKey;
+    uint64_t converted = 0;
+    uint32_t retryIntervalMs = kRetryMinIntervalMs;
+    while (!_stop)
+    {
+        std::string lastKey;
+        uint64_t batchConverted = 0;
+        int ret = _MigrateBatch(family, startKey, lastKey, batchConverted);
+        if (ret < 0)
+        {
+            // Mostly write conflicts with block saving, the same batch is tried again later
+            WARNLOG("db format migration family:{} batch failed, ret:{}, retry in {} ms", static_cast<int>(family), ret, retryIntervalMs);
+            _Sleep(retryIntervalMs);
+            retryIntervalMs = std::min(retryIntervalMs * 2, kRetryMaxIntervalMs);
+            continue;
+        }
+        retryIntervalMs = kRetryMinIntervalMs;
+        converted += batchConverted;
+
+        if (ret == 0)
+        {
+            DEBUGLOG("db format migration family:{} converted:{}", static_cast<int>(family), converted);
+            return 0;
+        }
+        // The smallest key after the last one read
+        startKey = lastKey + '\0';
+        _Sleep(kBatchIntervalMs);
+    }
+    return 1;
+}
+
+int DBFormatMigration::_MigrateBatch(Family family, const std::string &startKey, std::string &lastKey, uint64_t &converted)
+{
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    DBReader dbReader;
+    auto ret = family == Family::kMptNode
+        ? dbReader.GetMptEntries(startKey, kBatchSize, keys, values)
+        : dbReader.GetContractCodeEntries(startKey, kBatchSize, keys, values);
+    if (ret != DBStatus::DB_SUCCESS)
+    {
+        return -1;
+    }
+
+    DBReadWriter dbReadWriter("DBFormatMigration");
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (db_format::IsBinary(values[i]))
+        {
+            continue;
+        }
+        ret = family == Family::kMptNode
+            ? dbReadWriter.ConvertMptValueToBinary(keys[i])
+            : dbReadWriter.ConvertContractCodeToBinary(keys[i]);
+        if (ret != DBStatus::DB_SUCCESS && ret != DBStatus::DB_NOT_FOUND)
+        {
+            return -2;
+        }
+        ++converted;
+    }
+    if (dbReadWriter.TransactionCommit() != DBStatus::DB_SUCCESS)
+    {
+        return -3;
+    }
+
+    if (keys.size() < kBatchSize)
+    {
+        return 0;
+    }
+    lastKey = keys.back();
+    return 1;
+}
+
+void DBFormatMigration::_Sleep(uint32_t ms)
+{
+    std::unique_lock<std::mutex> lock(_stopMutex);
+    _stopCv.wait_for(lock, std::chrono::milliseconds(ms), [this]{ return _stop.load(); });
+}
@@ -0,0 +1,136 @@
+/**
+ * *****************************************************************************
+ * @file        db_format.h
+ * @brief       Storage format of contract trie nodes and contract code. Format 1
+ *              keeps them as hex strings, format 2 as raw bytes behind a tag byte.
+ *              Readers accept both, so the database can be migrated online.
+ * @date        2024-06-24
+ * @copyright   tfsc
+ * *****************************************************************************
+ */
+#ifndef TFS_DB_FORMAT_H_
+#define TFS_DB_FORMAT_H_
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <cstdint>
+#include <condition_variable>
+
+namespace db_format
+{
+    const uint32_t kHexFormat = 1;
+    const uint32_t kBinaryFormat = 2;
+    // Never a hex digit, so a stored value is binary exactly when it starts with it
+    const char kBinaryTag = '\x01';
+
+    /**
+     * @brief       Encode a hex value for storage. A value that does not round-trip
+     *              through hex is kept as it is, so reads return exactly what was written.
+     * 
+     * @param       hex:
+     * @return      std::string
+     */
+    std::string HexToStored(const std::string &hex);
+
+    /**
+     * @brief       Decode a stored value of either format back to hex
+     * 
+     * @param       stored:
+     * @return      std::string the value in hex as it was written
+     */
+    std::string StoredToHex(const std::string &stored);
+
+    /**
+     * @brief       Decode a stored value of either format to raw bytes
+     * 
+     * @param       stored:
+     * @return      std::string the raw bytes of the value
+     */
+    std::string StoredToBytes(const std::string &stored);
+
+    /**
+     * @brief       Whether a stored value is in the binary format
+     * 
+     * @param       stored:
+     * @return      true 
+     * @return      false hex format
+     */
+    inline bool IsBinary(const std::string &stored)
+    {
+        return !stored.empty() && stored[0] == kBinaryTag;
+    }
+}
+
+/**
+ * @brief       Rewrites hex encoded trie nodes and contract code to the binary format
+ *              in the background, then records format 2
+ */
+class DBFormatMigration
+{
+public:
+    DBFormatMigration() = default;
+    ~DBFormatMigration() { Stop(); }
+    DBFormatMigration(DBFormatMigration &&) = delete;
+    DBFormatMigration(const DBFormatMigration &) = delete;
+    DBFormatMigration &operator=(DBFormatMigration &&) = delete;
+    DBFormatMigration &operator=(const DBFormatMigration &) = delete;
+
+    /**
+     * @brief       Start migrating unless the database is already in the binary format
+     * 
+     */
+    void Start();
+
+    /**
+     * @brief       Interrupt the migration, it resumes on the next start
+     * 
+     */
+    void Stop();
+
+    static const size_t kBatchSize = 1000;
+    static const uint32_t kBatchIntervalMs = 20;
+    // A failed batch is retried after this interval, doubled on every failure in a row up to the maximum
+    static constexpr uint32_t kRetryMinIntervalMs = 100;
+    static constexpr uint32_t kRetryMaxIntervalMs = 60 * 1000;
+
+private:
+    enum class Family
+    {
+        kMptNode,
+        kContractCode
+    };
+
+    void _Work();
+    /**
+     * @brief       Convert all values of a family, retrying failed batches until done or stopped
+     * 
+     * @param       family:
+     * @return      int 0 done, > 0 interrupted
+     */
+    int _Migrate(Family family);
+    /**
+     * @brief       Convert the values of one batch and commit them
+     * 
+     * @param       family:
+     * @param       startKey: first key of the batch
+     * @param       lastKey: last key of the batch
+     * @param       converted: number of values converted
+     * @return      int 0 last batch, 1 more batches follow, < 0 error
+     */
+    int _MigrateBatch(Family family, const std::string &startKey, std::string &lastKey, uint64_t &converted);
+    /**
+     * @brief       Sleep, returning early when stopped
+     * 
+     * @param       ms:
+     */
+    void _Sleep(uint32_t ms);
+
+    std::thread _thread;
+    std::atomic<bool> _stop = false;
+    std::mutex _stopMutex;
+    std::condition_variable _stopCv;
+};
+
+#endif
@@ -0,0 +1,359 @@
+#include "db/db_snapshot.h"
+
+#include <fstream>
+#include <memory>
+#include <filesystem>
+
+#include <openssl/sha.h>
+
+#include "rocksdb/sst_file_writer.h"
+#include "db/rocksdb.h"
+#include "include/logging.h"
+#include "utils/magic_singleton.h"
+
+namespace
+{
+    const char kMagic[8] = {'T', 'F', 'S', 'S', 'N', 'A', 'P', '1'};
+    // kBlockTopKey and kBlockHeight2BlockHashKey in db_api.cpp
+    const std::string kBlockTopKey = "blktop_";
+    const std::string kBlockHeight2BlockHashKey = "blkht2blkhs_";
+
+    std::string ToHex(const unsigned char *data, size_t len)
+    {
+        static const char kDigits[] = "0123456789abcdef";
+        std::string hex;
+        hex.reserve(len * 2);
+        for (size_t i = 0; i < len; ++i)
+        {
+            hex.push_back(kDigits[data[i] >> 4]);
+            hex.push_back(kDigits[data[i] & 0xf]);
+        }
+        return hex;
+    }
+
+    // Writes the snapshot stream and hashes it on the way
+    class HashingWriter
+    {
+    public:
+        explicit HashingWriter(std::ofstream &out) : _out(out) { SHA256_Init(&_ctx); }
+
+        void Write(const void *data, size_t len)
+        {
+            _out.write(static_cast<const char *>(data), len);
+            SHA256_Update(&_ctx, data, len);
+        }
+        template <typename T>
+        void WriteInt(T value)
+        {
+            unsigned char bytes[sizeof(T)];
+            for (size_t i = 0; i < sizeof(T); ++i)
+            {
+                bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+            }
+            Write(bytes, sizeof(T));
+        }
+        void WriteString(const rocksdb::Slice &str)
+        {
+            WriteInt<uint32_t>(str.size());
+            Write(str.data(), str.size());
+        }
+        std::string Finish()
+        {
+            unsigned char digest[SHA256_DIGEST_LENGTH];
+            SHA256_Final(digest, &_ctx);
+            _out.write(reinterpret_cast<const char *>(digest), sizeof(digest));
+            return ToHex(digest, sizeof(digest));
+        }
+
+    private:
+        std::ofstream &_out;
+        SHA256_CTX _ctx;
+    };
+
+    // Reads the snapshot stream and hashes it on the way
+    class HashingReader
+    {
+    public:
+        explicit HashingReader(std::ifstream &in) : _in(in) { SHA256_Init(&_ctx); }
+
+        bool Read(void *data, size_t len)
+        {
+            if (!_in.read(static_cast<char *>(data), len))
+            {
+                return false;
+            }
+            SHA256_Update(&_ctx, data, len);
+            return true;
+        }
+        template <typename T>
+        bool ReadInt(T &value)
+        {
+            unsigned char bytes[sizeof(T)];
+            if (!Read(bytes, sizeof(T)))
+            {
+                return false;
+            }
+            value = 0;
+            for (size_t i = 0; i < sizeof(T); ++i)
+            {
+                value |= static_cast<T>(bytes[i]) << (8 * i);
+            }
+            return true;
+        }
+        bool ReadString(std::string &str)
+        {
+            uint32_t len = 0;
+            if (!ReadInt(len))
+            {
+                return false;
+            }
+            str.resize(len);
+            return Read(str.data(), len);
+        }
+        // The stored digest, and whether it matches what was read
+        bool Finish(std::string &commitment)
+        {
+            unsigned char digest[SHA256_DIGEST_LENGTH];
+            unsigned char stored[SHA256_DIGEST_LENGTH];
+            SHA256_Final(digest, &_ctx);
+            if (!_in.read(reinterpret_cast<char *>(stored), sizeof(stored)))
+            {
+                return false;
+            }
+            commitment = ToHex(stored, sizeof(stored));
+            return std::equal(digest, digest + sizeof(digest), stored);
+        }
+
+    private:
+        std::ifstream &_in;
+        SHA256_CTX _ctx;
+    };
+
+    bool IsExcluded(const rocksdb::Slice &key)
+    {
+        for (const auto &prefix : DBSnapshot::kExcludedPrefixes)
+        {
+            if (key.starts_with(prefix))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+// Per address transaction history, written for the query interfaces and never read by consensus
+const std::vector<std::string> DBSnapshot::kExcludedPrefixes = {"addr2txraw_", "addr2blkhs_", "addr2txtop_"};
+
+int DBSnapshot::Export(const std::string &path, Info &info)
+{
+    auto rocksdb = MagicSingleton<RocksDB>::GetInstance();
+    if (!rocksdb->IsInitSuccess())
+    {
+        ERRORLOG("rocksdb not init");
+        return -1;
+    }
+    auto db = rocksdb->db_;
+
+    const rocksdb::Snapshot *snapshot = db->GetSnapshot();
+    std::shared_ptr<void> releaseSnapshot(nullptr, [db, snapshot](void *){ db->ReleaseSnapshot(snapshot); });
+    rocksdb::ReadOptions readOptions;
+    readOptions.snapshot = snapshot;
+    readOptions.fill_cache = false;
+
+    std::string top;
+    auto status = db->Get(readOptions, kBlockTopKey, &top);
+    if (!status.ok())
+    {
+        ERRORLOG("snapshot get top failed {}", status.ToString());
+        return -2;
+    }
+    try
+    {
+        info.height = std::stoull(top);
+    }
+    catch (const std::exception &e)
+    {
+        ERRORLOG("snapshot bad top {}: {}", top, e.what());
+        return -7;
+    }
+    db->Get(readOptions, kBlockHeight2BlockHashKey + top, &info.blockHashes);
+
+    // The entry count goes in the header, so count first under the same snapshot
+    info.entries = 0;
+    {
+        std::unique_ptr<rocksdb::Iterator> it(db->NewIterator(readOptions));
+        for (it->SeekToFirst(); it->Valid(); it->Next())
+        {
+            if (!IsExcluded(it->key()))
+            {
+                ++info.entries;
+            }
+        }
+        if (!it->status().ok())
+        {
+            ERRORLOG("snapshot iterate failed {}", it->status().ToString());
+            return -3;
+        }
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        ERRORLOG("cannot open snapshot file {}", path);
+        return -4;
+    }
+    HashingWriter writer(out);
+    writer.Write(kMagic, sizeof(kMagic));
+    writer.WriteInt<uint32_t>(kVersion);
+    writer.WriteInt<uint64_t>(info.height);
+    writer.WriteString(info.blockHashes);
+    writer.WriteInt<uint64_t>(info.entries);
+
+    std::unique_ptr<rocksdb::Iterator> it(db->NewIterator(readOptions));
+    for (it->SeekToFirst(); it->Valid(); it->Next())
+    {
+        if (IsExcluded(it->key()))
+        {
+            continue;
+        }
+        writer.WriteString(it->key());
+        writer.WriteString(it->value());
+    }
+    if (!it->status().ok())
+    {
+        ERRORLOG("snapshot iterate failed {}", it->status().ToString());
+        return -5;
+    }
+    info.commitment = writer.Finish();
+    out.flush();
+    if (!out)
+    {
+        ERRORLOG("write snapshot file {} failed", path);
+        return -6;
+    }
+    INFOLOG("snapshot exported height:{} entries:{} commitment:{}", info.height, info.entries, info.commitment);
+    return 0;
+}
+
+int DBSnapshot::Import(const std::string &path, const std::string &expectedCommitment, Info &info)
+{
+    // The file's own commitment only proves it is intact, not that it is the chain's state
+    if (expectedCommitment.empty())
+    {
+        ERRORLOG("snapshot {} imported without an expected commitment", path);
+        return -13;
+    }
+
+    auto rocksdb = MagicSingleton<RocksDB>::GetInstance();
+    if (!rocksdb->IsInitSuccess())
+    {
+        ERRORLOG("rocksdb not init");
+        return -1;
+    }
+    auto db = rocksdb->db_;
+    {
+        std::unique_ptr<rocksdb::Iterator> it(db->NewIterator(rocksdb::ReadOptions()));
+        it->SeekToFirst();
+        if (it->Valid())
+        {
+            ERRORLOG("snapshot can only be imported into an empty database");
+            return -2;
+        }
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        ERRORLOG("cannot open snapshot file {}", path);
+        return -3;
+    }
+    HashingReader reader(in);
+    char magic[sizeof(kMagic)];
+    uint32_t version = 0;
+    if (!reader.Read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kMagic)
+        || !reader.ReadInt(version) || version != kVersion
+        || !reader.ReadInt(info.height) || !reader.ReadString(info.blockHashes) || !reader.ReadInt(info.entries))
+    {
+        ERRORLOG("bad snapshot header {}", path);
+        return -4;
+    }
+
+    // The SST files are written next to the database and moved into it on ingestion
+    std::filesystem::path sstDir = rocksdb->db_path_ + ".snapshot";
+    std::error_code ec;
+    std::filesystem::remove_all(sstDir, ec);
+    std::filesystem::create_directories(sstDir, ec);
+    if (ec)
+    {
+        ERRORLOG("cannot create {}: {}", sstDir.string(), ec.message());
+        return -5;
+    }
+    std::shared_ptr<void> removeSstDir(nullptr, [sstDir](void *){ std::error_code ec; std::filesystem::remove_all(sstDir, ec); });
+
+    rocksdb::Options options;
+    rocksdb::SstFileWriter sstWriter(rocksdb::EnvOptions(), options);
+    std::vector<std::string> sstFiles;
+    std::string key;
+    std::string value;
+    for (uint64_t i = 0; i < info.entries; ++i)
+    {
+        if (i % kEntriesPerSst == 0)
+        {
+            if (!sstFiles.empty() && !sstWriter.Finish().ok())
+            {
+                ERRORLOG("finish sst {} failed", sstFiles.back());
+                return -6;
+            }
+            sstFiles.push_back((sstDir / ("snapshot_" + std::to_string(sstFiles.size()) + ".sst")).string());
+            auto status = sstWriter.Open(sstFiles.back());
+            if (!status.ok())
+            {
+                ERRORLOG("open sst {} failed {}", sstFiles.back(), status.ToString());
+                return -7;
+            }
+        }
+        if (!reader.ReadString(key) || !reader.ReadString(value))
+        {
+            ERRORLOG("snapshot truncated at entry {}", i);
+            return -8;
+        }
+        // Fails on keys out of order, which a well formed snapshot never has
+        auto status = sstWriter.Put(key, value);
+        if (!status.ok())
+        {
+            ERRORLOG("sst put failed at entry {}: {}", i, status.ToString());
+            return -9;
+        }
+    }
+    if (!sstFiles.empty() && !sstWriter.Finish().ok())
+    {
+        ERRORLOG("finish sst {} failed", sstFiles.back());
+        return -6;
+    }
+
+    if (!reader.Finish(info.commitment))
+    {
+        ERRORLOG("snapshot {} does not match its commitment", path);
+        return -10;
+    }
+    if (expectedCommitment != info.commitment)
+    {
+        ERRORLOG("snapshot commitment {} is not the expected {}", info.commitment, expectedCommitment);
+        return -11;
+    }
+
+    if (!sstFiles.empty())
+    {
+        rocksdb::IngestExternalFileOptions ingestOptions;
+        ingestOptions.move_files = true;
+        auto status = db->IngestExternalFile(sstFiles, ingestOptions);
+        if (!status.ok())
+        {
+            ERRORLOG("ingest snapshot failed {}", status.ToString());
+            return -12;
+        }
+    }
+    INFOLOG("snapshot imported height:{} entries:{} commitment:{}", info.height, info.entries, info.commitment);
+    return 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * *****************************************************************************
+ * @file        db_snapshot.h
+ * @brief       State snapshot at a checkpoint height, for bootstrapping a node without
+ *              replaying the chain up to it
+ * @date        2024-06-24
+ * @copyright   tfsc
+ * *****************************************************************************
+ */
+#ifndef TFS_DB_SNAPSHOT_H_
+#define TFS_DB_SNAPSHOT_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief       A snapshot file holds every key of the database at a checkpoint, in key order,
+ *              except the per address history indexes that only serve queries. That covers
+ *              the UTXO set, balances, stake/invest/bonus indexes, contract code and tries, and
+ *              the blocks and sum hashes sync checks against.
+ *
+ *              Layout, integers little endian:
+ *                  magic "TFSSNAP1", u32 version, u64 height, u32 n + checkpoint block hashes,
+ *                  u64 entry count, entries of u32 n + key and u32 n + value,
+ *                  32 byte sha256 of everything before it
+ *              The hex of that sha256 is the commitment a snapshot is published and checked by.
+ */
+class DBSnapshot
+{
+public:
+    struct Info
+    {
+        uint64_t height = 0;
+        // Block hashes at the checkpoint height as the database stores them
+        std::string blockHashes;
+        uint64_t entries = 0;
+        std::string commitment;
+    };
+
+    /**
+     * @brief       Write the database as of now to path
+     *
+     * @param       path:
+     * @param       info:
+     * @return      int 0 success, < 0 error
+     */
+    static int Export(const std::string &path, Info &info);
+
+    /**
+     * @brief       Bulk load a snapshot into an empty database through SST ingestion.
+     *              Nothing is ingested unless the file matches its commitment and that is
+     *              the expected one.
+     *
+     * @param       path:
+     * @param       expectedCommitment: published by the exporting node, required
+     * @param       info:
+     * @return      int 0 success, < 0 error
+     */
+    static int Import(const std::string &path, const std::string &expectedCommitment, Info &info);
+
+    static const uint32_t kVersion = 1;
+    // Entries per ingested SST file
+    static const uint64_t kEntriesPerSst = 1000000;
+    // Prefixes left out of a snapshot
+    static const std::vector<std::string> kExcludedPrefixes;
+};
+
+#endif
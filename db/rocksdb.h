@@ -61,6 +61,7 @@ private:
     friend class BackgroundErrorListener;
     friend class RocksDBReader;
     friend class RocksDBReadWriter;
+    friend class DBSnapshot;
     std::string db_path_;
     rocksdb::TransactionDB *db_;
     std::mutex is_init_success_mutex_;
@@ -97,3 +97,31 @@ bool RocksDBReader::ReadData(const std::string &key, std::string &value, rocksdb
     }
     return false;
 }
+
+bool RocksDBReader::ReadByPrefix(const std::string &prefix, const std::string &startKey, size_t limit,
+                                 std::vector<std::string> &keys, std::vector<std::string> &values)
+{
+    keys.clear();
+    values.clear();
+    if (!rocksdb_->IsInitSuccess())
+    {
+        ERRORLOG("rocksdb not init");
+        return false;
+    }
+    std::unique_ptr<rocksdb::Iterator> it(rocksdb_->db_->NewIterator(read_options_));
+    for (it->Seek(startKey < prefix ? prefix : startKey); it->Valid() && keys.size() < limit; it->Next())
+    {
+        if (!it->key().starts_with(prefix))
+        {
+            break;
+        }
+        keys.push_back(it->key().ToString());
+        values.push_back(it->value().ToString());
+    }
+    if (!it->status().ok())
+    {
+        ERRORLOG("rocksdb ReadByPrefix failed prefix:{} info:({})", prefix, it->status().ToString());
+        return false;
+    }
+    return true;
+}
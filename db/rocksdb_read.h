@@ -35,6 +35,19 @@ public:
      * @return      false
      */
     bool ReadData(const std::string &key, std::string &value, rocksdb::Status &retStatus);
+    /**
+     * @brief       Read up to limit entries whose key starts with prefix, from startKey on
+     * 
+     * @param       prefix:
+     * @param       startKey: 
+     * @param       limit: 
+     * @param       keys: 
+     * @param       values: 
+     * @return      true
+     * @return      false
+     */
+    bool ReadByPrefix(const std::string &prefix, const std::string &startKey, size_t limit,
+                      std::vector<std::string> &keys, std::vector<std::string> &values);
 
 private:
     rocksdb::ReadOptions read_options_;
@@ -76,6 +76,44 @@ bool RocksDBReadWriter::TransactionRollBack(rocksdb::Status &retStatus)
     return true;
 }
 
+bool RocksDBReadWriter::SetSavePoint()
+{
+    if (nullptr == txn_)
+    {
+        ERRORLOG("transaction is null");
+        return false;
+    }
+    txn_->SetSavePoint();
+    return true;
+}
+
+bool RocksDBReadWriter::RollbackToSavePoint(rocksdb::Status &retStatus)
+{
+    if (nullptr == txn_)
+    {
+        ERRORLOG("transaction is null");
+        retStatus = rocksdb::Status::Aborted();
+        return false;
+    }
+    retStatus = txn_->RollbackToSavePoint();
+    if (!retStatus.ok())
+    {
+        ERRORLOG("{} transction rollback to save point failed code:({}),subcode:({}),severity:({}),info:({})",
+                 txn_name_, retStatus.code(), retStatus.subcode(), retStatus.severity(), retStatus.ToString());
+        return false;
+    }
+    return true;
+}
+
+uint64_t RocksDBReadWriter::GetNumKeys()
+{
+    if (nullptr == txn_)
+    {
+        return 0;
+    }
+    return txn_->GetNumKeys();
+}
+
 bool RocksDBReadWriter::MultiReadData(const std::vector<rocksdb::Slice> &keys, std::vector<std::string> &values, std::vector<rocksdb::Status> &retStatus)
 {
     if (!rocksdb_->IsInitSuccess())
@@ -38,6 +38,27 @@ public:
      * @return      false
      */
     bool TransactionRollBack(rocksdb::Status &retStatus);
+    /**
+     * @brief       Mark the transaction so later writes can be undone without losing earlier ones
+     * 
+     * @return      true
+     * @return      false
+     */
+    bool SetSavePoint();
+    /**
+     * @brief       Undo the writes since the last save point
+     * 
+     * @param       retStatus: 
+     * @return      true
+     * @return      false
+     */
+    bool RollbackToSavePoint(rocksdb::Status &retStatus);
+    /**
+     * @brief       Number of keys the transaction holds locks on
+     * 
+     * @return      uint64_t
+     */
+    uint64_t GetNumKeys();
     /**
      * @brief
      * 
@@ -98,10 +119,8 @@ public:
      * @return      false
      */
     bool DeleteData(const std::string &key, rocksdb::Status &retStatus);
-
-private:
     /**
-     * @brief
+     * @brief       Read a key and lock it until the transaction ends
      * 
      * @param       key:
      * @param       value:
@@ -111,6 +130,7 @@ private:
      */
     bool ReadForUpdate(const std::string &key, std::string &value, rocksdb::Status &retStatus);
 
+private:
     std::string txn_name_;
     std::shared_ptr<RocksDB> rocksdb_;
     rocksdb::Transaction *txn_;
@@ -112,7 +112,8 @@ int main(int argc, char* argv[])
 		else if (strcmp(argv[i], "--help") == 0)
 		{
 			ERRORLOG("The parameter is Help!");
-			std::cout << argv[0] << ": --help version:" << global::kCompatibleVersion << " \n -m show Menu\n -s value, signature fee\n -p value, package fee" << std::endl;
+			std::cout << argv[0] << ": --help version:" << global::kCompatibleVersion << " \n -m show Menu\n -s value, signature fee\n -p value, package fee"
+					  << "\n --export-snapshot file, write the state of a stopped node to file\n --import-snapshot file commitment, bootstrap an empty node from file" << std::endl;
 			return 4;
 		}
 		else if (strcmp(argv[i], "-t") == 0)
@@ -125,6 +126,30 @@ int main(int argc, char* argv[])
 			showMenu = true;
 			MagicSingleton<TFSbenchmark>::GetInstance()->OpenBenchmark2();
 		}
+		else if (strcmp(argv[i], "--export-snapshot") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				std::cout << "Missing snapshot file!" << std::endl;
+				return 4;
+			}
+			return ExportSnapshot(argv[i + 1]) == 0 ? 0 : 6;
+		}
+		else if (strcmp(argv[i], "--import-snapshot") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				std::cout << "Missing snapshot file!" << std::endl;
+				return 4;
+			}
+			if (i + 2 >= argc)
+			{
+				std::cout << "Missing snapshot commitment!" << std::endl;
+				return 4;
+			}
+			snapshot::gImportPath = argv[++i];
+			snapshot::gImportCommitment = argv[++i];
+		}
 		else
 		{
 			ERRORLOG("Parameter parsing error!");
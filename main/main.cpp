@@ -19,6 +19,7 @@
 #include "utils/account_manager.h"
 #include "ca/block_http_callback.h"
 #include "ca/block_stroage.h"
+#include "db/db_snapshot.h"
 
 void Menu()
 {
@@ -36,12 +37,13 @@ void Menu()
 		std::cout << "8.Deploy contract"  << std::endl;
 		std::cout << "9.Call contract"  << std::endl;
 		std::cout << "10.Account Manager" << std::endl;
+		std::cout << "11.EVM Benchmark" << std::endl;
 		std::cout << "0.Exit" << std::endl;
 
 		std::string strKey;
 		std::cout << "Please input your choice: "<< std::endl;
 		std::cin >> strKey;	    
-		std::regex pattern("^[0-9]|([1][0])$");
+		std::regex pattern("^[0-9]|([1][0-1])$");
 		if(!std::regex_match(strKey, pattern))
         {
             std::cout << "Invalid input." << std::endl;
@@ -85,6 +87,9 @@ void Menu()
 			case 10:
 				HandleAccountManger();
 				break;
+			case 11:
+				TestEvmExecuteBenchmark();
+				break;
 			default:
                 std::cout << "Invalid input." << std::endl;
                 continue;
@@ -160,6 +165,12 @@ bool InitAccount()
 	return true;
 }
 
+namespace snapshot
+{
+    std::string gImportPath;
+    std::string gImportCommitment;
+}
+
 int InitRocksDb()
 {
     if (!DBInit("./data.db"))
@@ -167,6 +178,20 @@ int InitRocksDb()
         return -1;
     }
 
+    // The imported top stands in for block 0, sync carries on from the checkpoint
+    if (!snapshot::gImportPath.empty())
+    {
+        DBSnapshot::Info info;
+        int ret = DBSnapshot::Import(snapshot::gImportPath, snapshot::gImportCommitment, info);
+        if (ret != 0)
+        {
+            ERRORLOG("import snapshot {} failed, ret:{}", snapshot::gImportPath, ret);
+            std::cout << "Failed to import snapshot, ret: " << ret << std::endl;
+            return -9;
+        }
+        std::cout << "Imported snapshot at height " << info.height << ", commitment: " << info.commitment << std::endl;
+    }
+
     DBReadWriter dbReadWriter;
     uint64_t top = 0;
     if (DBStatus::DB_SUCCESS != dbReadWriter.GetBlockTop(top))
@@ -234,6 +259,34 @@ int InitRocksDb()
     return 0;
 }
 
+int ExportSnapshot(const std::string &path)
+{
+	if (!InitConfig() || !InitLog())
+	{
+		std::cout << "Failed to initialize config or log!" << std::endl;
+		return -1;
+	}
+	// The database is locked by a running node, so export from a stopped one
+	if (!DBInit("./data.db"))
+	{
+		std::cout << "Failed to open database!" << std::endl;
+		return -2;
+	}
+
+	DBSnapshot::Info info;
+	int ret = DBSnapshot::Export(path, info);
+	if (ret != 0)
+	{
+		std::cout << "Failed to export snapshot, ret: " << ret << std::endl;
+	}
+	else
+	{
+		std::cout << "Exported snapshot at height " << info.height << " with " << info.entries << " entries\n"
+				  << "commitment: " << info.commitment << std::endl;
+	}
+	DBDestory();
+	return ret;
+}
 
 bool Check()
 {
@@ -1,6 +1,8 @@
 #ifndef TFS_MAIN_H
 #define TFS_MAIN_H
 
+#include <string>
+
  
 void Menu();
 bool Init();
@@ -9,6 +11,16 @@ bool InitLog();
 bool InitAccount();
 int  InitRocksDb();
 
+/*********State Snapshot*********/
+
+namespace snapshot
+{
+    // Set by --import-snapshot, loaded into an empty database by InitRocksDb
+    extern std::string gImportPath;
+    extern std::string gImportCommitment;
+}
+int ExportSnapshot(const std::string &path);
+
 /*********Check Consistency*********/
 
 bool Check();
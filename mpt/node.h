@@ -15,6 +15,8 @@
 #include <cstddef> 
 #include <memory>
 #include <array>
+#include <string>
+#include <variant>
 
 class HashNode
 {
@@ -47,39 +49,8 @@ public:
 	bool dirty{false};
 };
 
-template<class T> class packing;
-class Object
-{
-public:
-	Object() {}
-	~Object() {}
-	template <typename T> T* ToSonClass() 
-	{
-		if (typeid(packing<T>).hash_code() != hashCode) {
-			return nullptr;
-		}
-
-		return &(((packing<T>*)this)->data);
-	}
-public:
-	size_t hashCode;
-	std::string name;
-};
-typedef std::shared_ptr<Object> nodePtr;
-
-template<class T>
-class packing :public Object
-{
-public:
-	packing(T inputData) {
-		data = inputData;
-		hashCode = typeid(*this).hash_code();
-		name = typeid(T).name();
-	}
-	~packing() {}
-public:
-	T data;
-};
+class MptNode;
+typedef std::shared_ptr<MptNode> nodePtr;
 
 class FullNode
 {
@@ -101,4 +72,34 @@ public:
 	NodeFlag nodeFlags;
 };
 
+/**
+ * @brief       A trie node, one of the four node kinds
+ */
+class MptNode
+{
+public:
+	template <typename T> explicit MptNode(T inputData) : data(std::move(inputData)) {}
+	~MptNode() {}
+
+	template <typename T> bool Is() const
+	{
+		return std::holds_alternative<T>(data);
+	}
+	template <typename T> T* ToSonClass()
+	{
+		return std::get_if<T>(&data);
+	}
+	template <typename T> const T* ToSonClass() const
+	{
+		return std::get_if<T>(&data);
+	}
+public:
+	std::variant<HashNode, ValueNode, ShortNode, FullNode> data;
+};
+
+template <typename T> nodePtr NewNode(T inputData)
+{
+	return std::make_shared<MptNode>(std::move(inputData));
+}
+
 #endif
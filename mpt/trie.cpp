@@ -1,6 +1,10 @@
 #include "node.h"
 
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <algorithm>
+#include <functional>
 #include <iostream>
 #include <map>
 
@@ -82,12 +86,77 @@ void Trie::GetBlockStorage(std::pair<std::string, std::string>& rootHash, std::m
     return;
 }
 
+static nodePtr CloneNode(const nodePtr& n)
+{
+    if (n == NULL)
+    {
+        return NULL;
+    }
+    if (auto sn = n->ToSonClass<ShortNode>())
+    {
+        return NewNode(ShortNode{ sn->nodeKey, CloneNode(sn->nodeVal), sn->nodeFlags });
+    }
+    if (auto fn = n->ToSonClass<FullNode>())
+    {
+        FullNode copy;
+        copy.flags = fn->flags;
+        for (size_t i = 0; i < fn->children.size(); ++i)
+        {
+            copy.children[i] = CloneNode(fn->children[i]);
+        }
+        return NewNode(copy);
+    }
+    // Hash and value nodes are never modified in place
+    return n;
+}
+
+nodePtr MptNodeCache::Get(const std::string& contractAddr, const std::string& hash)
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    auto it = _index.find(contractAddr + "_" + hash);
+    if (it == _index.end())
+    {
+        return NULL;
+    }
+    _lru.splice(_lru.begin(), _lru, it->second);
+    return it->second->second;
+}
+
+void MptNodeCache::Add(const std::string& contractAddr, const std::string& hash, const nodePtr& node)
+{
+    std::string key = contractAddr + "_" + hash;
+    std::lock_guard<std::mutex> lck(_mutex);
+    auto it = _index.find(key);
+    if (it != _index.end())
+    {
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return;
+    }
+    _lru.emplace_front(key, node);
+    _index[key] = _lru.begin();
+    if (_lru.size() > kMaxNodes)
+    {
+        _index.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+}
+
+bool MptNodeCache::Contains(const std::string& contractAddr, const std::string& hash)
+{
+    std::lock_guard<std::mutex> lck(_mutex);
+    return _index.find(contractAddr + "_" + hash) != _index.end();
+}
+
 nodePtr Trie::ResolveHash(nodePtr n, std::string prefix) const
 {
-    std::string strSha1;
     auto v = n->ToSonClass<HashNode>();
 
-    return DescendKey(v->data);
+    nodePtr resolved = DescendKey(v->data);
+    if (resolved != NULL && prefix.length() < kPrefetchDepth && resolved->Is<FullNode>())
+    {
+        Prefetch(*resolved->ToSonClass<FullNode>());
+    }
+    return resolved;
 }
 ReturnNode Trie::Get(nodePtr n, std::string key, int pos) const
 {
@@ -95,11 +164,11 @@ ReturnNode Trie::Get(nodePtr n, std::string key, int pos) const
     {
         return ReturnNode{NULL, NULL};
     }
-    else if (n->name == typeid(ValueNode).name())
+    else if (n->Is<ValueNode>())
     {
         return ReturnNode{ n, n };
     }
-    else if (n->name == typeid(ShortNode).name())
+    else if (n->Is<ShortNode>())
     {
         auto sn = n->ToSonClass<ShortNode>();
 
@@ -114,7 +183,7 @@ ReturnNode Trie::Get(nodePtr n, std::string key, int pos) const
         }
         return ReturnNode{r.valueNode, n};
     }
-    else if (n->name == typeid(FullNode).name())
+    else if (n->Is<FullNode>())
     {
         auto fn = n->ToSonClass<FullNode>();
         ReturnNode r = Get(fn->children[Toint(key[pos])], key, pos + 1);
@@ -124,7 +193,7 @@ ReturnNode Trie::Get(nodePtr n, std::string key, int pos) const
         }
         return ReturnNode{ r.valueNode, n };
     }
-    else if (n->name == typeid(HashNode).name())
+    else if (n->Is<HashNode>())
     {
         auto hashnode = n->ToSonClass<HashNode>();
         nodePtr child = ResolveHash(n, key.substr(0, pos));
@@ -149,10 +218,9 @@ ReturnVal Trie::Insert(nodePtr n, std::string prefix, std::string key, nodePtr v
 {
     if (n == NULL)
     {
-        return ReturnVal{ true, std::shared_ptr<packing<ShortNode>>(
-                new packing<ShortNode>(ShortNode{key, value, newFlag()})), 0 };
+        return ReturnVal{ true, NewNode(ShortNode{key, value, newFlag()}), 0 };
     }
-    else if (n->name == typeid(ShortNode).name())
+    else if (n->Is<ShortNode>())
     {
         auto sn = n->ToSonClass<ShortNode>();
         int matchlen = PrefixLen(key, sn->nodeKey);
@@ -165,8 +233,7 @@ ReturnVal Trie::Insert(nodePtr n, std::string prefix, std::string key, nodePtr v
                 return ReturnVal{ false, n, r.err };
             }
             return ReturnVal{ true,
-            std::shared_ptr<packing<ShortNode>>(
-                new packing<ShortNode>(ShortNode{sn->nodeKey, r.node, newFlag()})), 0 };
+            NewNode(ShortNode{sn->nodeKey, r.node, newFlag()}), 0 };
         }
         FullNode fn;
         fn.flags = newFlag();
@@ -185,8 +252,7 @@ ReturnVal Trie::Insert(nodePtr n, std::string prefix, std::string key, nodePtr v
         {
             return ReturnVal{ false, 0, r.err };
         }
-        auto branch = std::shared_ptr<packing<FullNode>>(
-            new packing<FullNode>(fn));
+        auto branch = NewNode(fn);
         // Replace this ShortNode with the branch if it occurs at index 0.
         if (matchlen == 0)
         {
@@ -194,10 +260,9 @@ ReturnVal Trie::Insert(nodePtr n, std::string prefix, std::string key, nodePtr v
         }
 
 
-        return ReturnVal{ true, std::shared_ptr<packing<ShortNode>>(
-                new packing<ShortNode>(ShortNode{sn->nodeKey.substr(0,matchlen), branch, newFlag()})), 0 };
+        return ReturnVal{ true, NewNode(ShortNode{sn->nodeKey.substr(0,matchlen), branch, newFlag()}), 0 };
     }
-    else if (n->name == typeid(FullNode).name())
+    else if (n->Is<FullNode>())
     {
         auto fn = n->ToSonClass<FullNode>();
         ReturnVal r = Insert(fn->children[Toint(key[0])], prefix + key[0], key.substr(1), value);
@@ -209,7 +274,7 @@ ReturnVal Trie::Insert(nodePtr n, std::string prefix, std::string key, nodePtr v
         fn->children[Toint(key[0])] = r.node;
         return ReturnVal{ true, n, 0 };
     }
-    else if (n->name == typeid(HashNode).name())
+    else if (n->Is<HashNode>())
     {
         auto rn = ResolveHash(n, prefix);
 
@@ -239,8 +304,7 @@ nodePtr Trie::Update(std::string key, std::string value)
     std::string k = WapperKey(key);
     if (value.length() != 0)
     {
-        auto vn = std::shared_ptr<packing<ValueNode>>(
-            new packing<ValueNode>(ValueNode{ value }));
+        auto vn = NewNode(ValueNode{ value });
         ReturnVal r = Insert(this->root, "", k, vn);
         this->root = r.node;
     }
@@ -249,6 +313,13 @@ nodePtr Trie::Update(std::string key, std::string value)
 
 nodePtr Trie::DescendKey(std::string key) const
 {
+    auto nodeCache = MagicSingleton<MptNodeCache>::GetInstance();
+    nodePtr cached = nodeCache->Get(contractAddr, key);
+    if (cached != NULL)
+    {
+        return CloneNode(cached);
+    }
+
     DBReader dataReader;
     std::string value;
 
@@ -257,14 +328,80 @@ nodePtr Trie::DescendKey(std::string key) const
         this->contractDataCache->get(contractAddr + "_" + key, value);
     }
     
-    if(value.empty() && dataReader.GetMptValueByMptKey(contractAddr + "_" + key, value) != 0)
+    bool isHex = !value.empty();
+    if(value.empty() && dataReader.GetMptNodeBytesByMptKey(contractAddr + "_" + key, value) != 0)
     {
         ERRORLOG("GetContractStorageByKey error");
     }
-    dev::bytes bs = dev::fromHex(value);
     if (value == "") return NULL;
+    nodePtr decoded = isHex ? DecodeValue(key, value) : DecodeBytes(key, value);
+    if (decoded == NULL)
+    {
+        return NULL;
+    }
+    nodeCache->Add(contractAddr, key, decoded);
+    return CloneNode(decoded);
+}
+
+nodePtr Trie::DecodeValue(const std::string& hash, const std::string& value) const
+{
+    dev::bytes bs = dev::fromHex(value);
     dev::RLP r = dev::RLP(bs);
-    return DecodeNode(key, r);  // if not, it must be a list
+    return DecodeNode(hash, r);  // if not, it must be a list
+}
+
+nodePtr Trie::DecodeBytes(const std::string& hash, const std::string& value) const
+{
+    dev::RLP r = dev::RLP(value);
+    return DecodeNode(hash, r);
+}
+
+void Trie::Prefetch(const FullNode& fn) const
+{
+    auto nodeCache = MagicSingleton<MptNodeCache>::GetInstance();
+    std::vector<std::string> hashes;
+    std::vector<std::string> mptKeys;
+    for (int i = 0; i < 16; ++i)
+    {
+        auto child = fn.children[i];
+        if (child == NULL || !child->Is<HashNode>())
+        {
+            continue;
+        }
+        const std::string& childHash = child->ToSonClass<HashNode>()->data;
+        std::string value;
+        if (nodeCache->Contains(contractAddr, childHash)
+            || (this->contractDataCache != nullptr && this->contractDataCache->get(contractAddr + "_" + childHash, value)))
+        {
+            continue;
+        }
+        hashes.push_back(childHash);
+        mptKeys.push_back(contractAddr + "_" + childHash);
+    }
+    if (mptKeys.size() < 2)
+    {
+        return;
+    }
+
+    DBReader dataReader;
+    std::vector<std::string> values;
+    dataReader.GetMptValuesByMptKeys(mptKeys, values);
+    if (values.size() != mptKeys.size())
+    {
+        return;
+    }
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        if (values[i].empty())
+        {
+            continue;
+        }
+        nodePtr decoded = DecodeBytes(hashes[i], values[i]);
+        if (decoded != NULL)
+        {
+            nodeCache->Add(contractAddr, hashes[i], decoded);
+        }
+    }
 }
 nodePtr Trie::DecodeShort(std::string hash, dev::RLP const& r) const
 {
@@ -275,17 +412,14 @@ nodePtr Trie::DecodeShort(std::string hash, dev::RLP const& r) const
     {
         auto v = DecodeRef(r[1]);
 
-        return std::shared_ptr<packing<ShortNode>>(
-            new packing<ShortNode>(ShortNode{ r[0].toString(),v, flag }));
+        return NewNode(ShortNode{ r[0].toString(),v, flag });
     }
     else
     {
 
-        auto v = std::shared_ptr<packing<ValueNode>>(
-            new packing<ValueNode>(ValueNode{ r[1][0].toString() }));
+        auto v = NewNode(ValueNode{ r[1][0].toString() });
 
-        return std::shared_ptr<packing<ShortNode>>(
-            new packing<ShortNode>(ShortNode{ r[0].toString(),v, flag }));
+        return NewNode(ShortNode{ r[0].toString(),v, flag });
     };
 }
 nodePtr Trie::DecodeFull(std::string hash, dev::RLP const& r) const
@@ -304,8 +438,7 @@ nodePtr Trie::DecodeFull(std::string hash, dev::RLP const& r) const
         }
     }
 
-    return std::shared_ptr<packing<FullNode>>(
-        new packing<FullNode>(fn));
+    return NewNode(fn);
 }
 nodePtr Trie::DecodeRef(dev::RLP const& r) const
 {
@@ -318,8 +451,7 @@ nodePtr Trie::DecodeRef(dev::RLP const& r) const
 
     else if (r.isData() && r.size() == 66)
     {
-        return std::shared_ptr<packing<HashNode>>(
-            new packing<HashNode>(HashNode{ r[0].toString() }));
+        return NewNode(HashNode{ r[0].toString() });
     }
     else if (r.isList())
     {
@@ -342,14 +474,13 @@ nodePtr Trie::DecodeNode(std::string hash, dev::RLP const& r) const
 
 nodePtr Trie::hash(nodePtr n)
 {
-    if (n->name == typeid(ShortNode).name())
+    if (n->Is<ShortNode>())
     {
         auto sn = n->ToSonClass<ShortNode>();
 
         if (!sn->nodeFlags.hash.data.empty())
         {
-            return std::shared_ptr<packing<HashNode>>(
-                new packing<HashNode>(sn->nodeFlags.hash));
+            return NewNode(sn->nodeFlags.hash);
         }
 
         auto hashed = HashShortNodeChildren(n);
@@ -359,14 +490,13 @@ nodePtr Trie::hash(nodePtr n)
         return hashed;
 
     }
-    else if (n->name == typeid(FullNode).name())
+    else if (n->Is<FullNode>())
     {
         auto fn = n->ToSonClass<FullNode>();
 
         if (!fn->flags.hash.data.empty())
         {
-            return std::shared_ptr<packing<HashNode>>(
-                new packing<HashNode>(fn->flags.hash));
+            return NewNode(fn->flags.hash);
         }
 
         auto hashed = HashFullNodeChildren(n);
@@ -389,7 +519,7 @@ nodePtr Trie::HashShortNodeChildren(nodePtr n)
 
     auto vn = sn->nodeVal;
 
-    if (vn->name == typeid(ShortNode).name() || vn->name == typeid(FullNode).name())
+    if (vn->Is<ShortNode>() || vn->Is<FullNode>())
     {
 
         sn->nodeFlags.hash = *hash(vn)->ToSonClass<HashNode>();
@@ -415,8 +545,7 @@ nodePtr Trie::HashFullNodeChildren(nodePtr n)
         }
     }
 
-    return ToHash(std::shared_ptr<packing<FullNode>>(
-        new packing<FullNode>(collapsed)));
+    return ToHash(NewNode(collapsed));
 }
 nodePtr Trie::ToHash(nodePtr n)
 {
@@ -429,12 +558,11 @@ nodePtr Trie::ToHash(nodePtr n)
     
     HashNode hashnode;
     hashnode.data = strSha256;
-    return std::shared_ptr<packing<HashNode>>(
-        new packing<HashNode>(hashnode));
+    return NewNode(hashnode);
 }
 dev::RLPStream Trie::Encode(nodePtr n)
 {
-    if (n->name == typeid(ShortNode).name())
+    if (n->Is<ShortNode>())
     {
         dev::RLPStream rlp(2);
         auto sn = n->ToSonClass<ShortNode>();
@@ -442,7 +570,7 @@ dev::RLPStream Trie::Encode(nodePtr n)
         rlp.append(Encode(sn->nodeVal).out());
         return rlp;
     }
-    else if (n->name == typeid(FullNode).name())
+    else if (n->Is<FullNode>())
     {
         dev::RLPStream rlp(17);
         auto fn = n->ToSonClass<FullNode>();
@@ -459,7 +587,7 @@ dev::RLPStream Trie::Encode(nodePtr n)
         }
         return rlp;
     }
-    else if (n->name == typeid(ValueNode).name())
+    else if (n->Is<ValueNode>())
     {
         dev::RLPStream rlp;
         auto vn = n->ToSonClass<ValueNode>();
@@ -467,7 +595,7 @@ dev::RLPStream Trie::Encode(nodePtr n)
         rlp << vn->data;
         return rlp;
     }
-    else if (n->name == typeid(HashNode).name())
+    else if (n->Is<HashNode>())
     {
         dev::RLPStream rlp;
         auto hashnode = n->ToSonClass<HashNode>();
@@ -478,21 +606,21 @@ dev::RLPStream Trie::Encode(nodePtr n)
     return dev::RLPStream();
 }
 
-nodePtr Trie::Store(nodePtr n) {
+nodePtr Trie::Store(nodePtr n, WriteSet& writes) {
 
-    if (n->name != typeid(ShortNode).name() && n->name != typeid(FullNode).name())
+    if (!n->Is<ShortNode>() && !n->Is<FullNode>())
     {
         return n;
     }
     else
     {
         HashNode hash;
-        if (n->name == typeid(ShortNode).name())
+        if (n->Is<ShortNode>())
         {
             auto sn = n->ToSonClass<ShortNode>();
             hash = sn->nodeFlags.hash;
         }
-        else if(n->name == typeid(FullNode).name())
+        else if(n->Is<FullNode>())
         {
             auto fn = n->ToSonClass<FullNode>();
             hash = fn->flags.hash;
@@ -500,68 +628,64 @@ nodePtr Trie::Store(nodePtr n) {
         // No leaf-callback used, but there's still a database. Do serial
         // insertion
         dev::RLPStream rlp = Encode(n);
-        std::string strSha1;
         dev::bytes data = rlp.out();
-        std::string stringData = dev::toHex(data);
 
-        dirtyHash[hash.data] = stringData;
+        writes.emplace_back(hash.data, dev::toHex(data));
 
-        return std::shared_ptr<packing<HashNode>>(
-            new packing<HashNode>(hash));
+        return NewNode(hash);
     }
 
 }
-nodePtr Trie::Commit(nodePtr n)
+nodePtr Trie::Commit(nodePtr n, WriteSet& writes, bool parallel)
 {
-    if (n->name == typeid(ShortNode).name())
+    if (n->Is<ShortNode>())
     {
         auto sn = n->ToSonClass<ShortNode>();
         if (!sn->nodeFlags.dirty && !sn->nodeFlags.hash.data.empty())
         {
-            return std::shared_ptr<packing<HashNode>>(
-                new packing<HashNode>(sn->nodeFlags.hash));
+            return NewNode(sn->nodeFlags.hash);
         }
 
         auto vn = sn->nodeVal;
-        if (vn->name == typeid(FullNode).name())
+        if (vn->Is<FullNode>())
         {
-            auto childV = Commit(vn);
+            auto childV = Commit(vn, writes, parallel);
             sn->nodeVal = childV;
         }
-        auto hashed = Store(n);
-        if (hashed->name == typeid(HashNode).name())
+        auto hashed = Store(n, writes);
+        if (hashed->Is<HashNode>())
         {
             return hashed;
         }
         return n;
     }
-    else if (n->name == typeid(FullNode).name())
+    else if (n->Is<FullNode>())
     {
         auto fn = n->ToSonClass<FullNode>();
         if (!fn->flags.dirty && !fn->flags.hash.data.empty())
         {
-            return std::shared_ptr<packing<HashNode>>(
-                new packing<HashNode>(fn->flags.hash));
+            return NewNode(fn->flags.hash);
         }
-        std::array<nodePtr, 17> hashedKids = commitChildren(n);
+        std::array<nodePtr, 17> hashedKids = commitChildren(n, writes, parallel);
         fn->children = hashedKids;
-        auto hashed = Store(n);
-        if (hashed->name == typeid(HashNode).name())
+        auto hashed = Store(n, writes);
+        if (hashed->Is<HashNode>())
         {
             return hashed;
         }
         return n;
     }
-    else if (n->name == typeid(HashNode).name())
+    else if (n->Is<HashNode>())
     {
         return n;
     }
     return NULL;
 }
-std::array<nodePtr, 17> Trie::commitChildren(nodePtr n)
+std::array<nodePtr, 17> Trie::commitChildren(nodePtr n, WriteSet& writes, bool parallel)
 {
     auto fn = n->ToSonClass<FullNode>();
     std::array<nodePtr, 17> children;
+    std::vector<int> dirty;
     for (int i = 0; i < 16; i++)
     {
         auto child = fn->children[i];
@@ -569,15 +693,34 @@ std::array<nodePtr, 17> Trie::commitChildren(nodePtr n)
         {
             continue;
         }
-        if (child->name == typeid(HashNode).name())
+        if (!IsDirty(child))
         {
-            children[i] = child;
+            children[i] = Commit(child, writes);
             continue;
         }
+        dirty.push_back(i);
+    }
 
-        auto hashed = Commit(child);
-        children[i] = hashed;
+    if (parallel && dirty.size() >= kParallelMinChildren)
+    {
+        // The children are disjoint subtrees, each one is committed into its own write set
+        std::vector<WriteSet> childWrites(dirty.size());
+        RunInParallel(dirty.size(), [&](size_t k) {
+            children[dirty[k]] = Commit(fn->children[dirty[k]], childWrites[k]);
+        });
+        for (auto& childWrite : childWrites)
+        {
+            writes.insert(writes.end(), std::make_move_iterator(childWrite.begin()), std::make_move_iterator(childWrite.end()));
+        }
+    }
+    else
+    {
+        for (int i : dirty)
+        {
+            children[i] = Commit(fn->children[i], writes);
+        }
     }
+
     if (fn->children[16] != NULL)
     {
         children[16] = fn->children[16];
@@ -585,13 +728,127 @@ std::array<nodePtr, 17> Trie::commitChildren(nodePtr n)
     return children;
 }
 
+void Trie::HashChildrenInParallel(nodePtr n)
+{
+    if (n->Is<ShortNode>())
+    {
+        auto sn = n->ToSonClass<ShortNode>();
+        if (!sn->nodeFlags.hash.data.empty() || !sn->nodeVal->Is<FullNode>())
+        {
+            return;
+        }
+        n = sn->nodeVal;
+    }
+    if (!n->Is<FullNode>())
+    {
+        return;
+    }
+    auto fn = n->ToSonClass<FullNode>();
+    if (!fn->flags.hash.data.empty())
+    {
+        return;
+    }
+
+    std::vector<nodePtr> unhashed;
+    for (int i = 0; i < 16; i++)
+    {
+        auto child = fn->children[i];
+        if (child == NULL)
+        {
+            continue;
+        }
+        if ((child->Is<ShortNode>() && child->ToSonClass<ShortNode>()->nodeFlags.hash.data.empty())
+            || (child->Is<FullNode>() && child->ToSonClass<FullNode>()->flags.hash.data.empty()))
+        {
+            unhashed.push_back(child);
+        }
+    }
+    if (unhashed.size() < kParallelMinChildren)
+    {
+        return;
+    }
+
+    // Hashes are cached in the node flags, the hash of the parent then reuses them
+    RunInParallel(unhashed.size(), [&](size_t k) { hash(unhashed[k]); });
+}
+
+bool Trie::IsDirty(const nodePtr& n)
+{
+    if (auto sn = n->ToSonClass<ShortNode>())
+    {
+        return sn->nodeFlags.dirty || sn->nodeFlags.hash.data.empty();
+    }
+    if (auto fn = n->ToSonClass<FullNode>())
+    {
+        return fn->flags.dirty || fn->flags.hash.data.empty();
+    }
+    return false;
+}
+
+size_t Trie::CountDirty(const nodePtr& n, size_t limit)
+{
+    if (n == NULL || !IsDirty(n))
+    {
+        return 0;
+    }
+    size_t count = 1;
+    if (auto sn = n->ToSonClass<ShortNode>())
+    {
+        count += CountDirty(sn->nodeVal, limit - count);
+    }
+    else if (auto fn = n->ToSonClass<FullNode>())
+    {
+        for (int i = 0; i < 16 && count < limit; i++)
+        {
+            count += CountDirty(fn->children[i], limit - count);
+        }
+    }
+    return count;
+}
+
+void Trie::RunInParallel(size_t count, const std::function<void(size_t)>& task)
+{
+    // The calling thread takes tasks as well
+    size_t threads = std::min<size_t>(count, std::max(std::thread::hardware_concurrency(), 1u)) - 1;
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t k = next++; k < count; k = next++)
+        {
+            task(k);
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
 void Trie::Save()
 {
     if(root == NULL)
     {
         return;
     }
+    // Threads only pay off for large changes on a machine with more than one core
+    bool parallel = std::thread::hardware_concurrency() > 1
+        && CountDirty(root, kParallelMinDirtyNodes) >= kParallelMinDirtyNodes;
+    if (parallel)
+    {
+        HashChildrenInParallel(root);
+    }
     hash(root);
 
-    this->root = Commit(root);
+    WriteSet writes;
+    this->root = Commit(root, writes, parallel);
+    for (auto& [nodeHash, encoded] : writes)
+    {
+        dirtyHash.insert_or_assign(std::move(nodeHash), std::move(encoded));
+    }
 }
@@ -10,12 +10,16 @@
 #ifndef TFS_MPT_TRIE_H_
 #define TFS_MPT_TRIE_H_
 
+#include <list>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <iostream>
 #include <map>
 #include <string>
 #include <unordered_map>
 #include <shared_mutex>
+#include <vector>
 
 #include <boost/algorithm/hex.hpp>
 #include <boost/uuid/detail/sha1.hpp>
@@ -71,6 +75,51 @@ private:
     mutable std::shared_mutex contractDataMapMutex;
 };
 
+/**
+ * @brief       Decoded trie nodes shared by every Trie, keyed by contract and node hash.
+ *              A node is addressed by the hash of its encoding so an entry never goes
+ *              stale. Cached nodes are never modified, Trie works on copies of them.
+ */
+class MptNodeCache
+{
+public:
+    /**
+     * @brief       
+     * 
+     * @param       contractAddr: 
+     * @param       hash: 
+     * @return      nodePtr nullptr if not cached
+     */
+    nodePtr Get(const std::string& contractAddr, const std::string& hash);
+
+    /**
+     * @brief       
+     * 
+     * @param       contractAddr: 
+     * @param       hash: 
+     * @param       node: must not be modified afterwards
+     */
+    void Add(const std::string& contractAddr, const std::string& hash, const nodePtr& node);
+
+    /**
+     * @brief       
+     * 
+     * @param       contractAddr: 
+     * @param       hash: 
+     * @return      true 
+     * @return      false 
+     */
+    bool Contains(const std::string& contractAddr, const std::string& hash);
+
+    static const size_t kMaxNodes = 65536;
+
+private:
+    std::mutex _mutex;
+    // Most recently used first
+    std::list<std::pair<std::string, nodePtr>> _lru;
+    std::unordered_map<std::string, std::list<std::pair<std::string, nodePtr>>::iterator> _index;
+};
+
 class Trie
 {
 public:
@@ -88,8 +137,7 @@ public:
     Trie(std::string roothash, std::string ContractAddr) 
     {
         this->contractAddr = ContractAddr;
-        auto roothashnode = std::shared_ptr<packing<HashNode>>(
-            new packing<HashNode>(HashNode{ roothash }));
+        auto roothashnode = NewNode(HashNode{ roothash });
         root = ResolveHash(roothashnode, "");
     }
 
@@ -103,8 +151,7 @@ public:
     {
         this->contractAddr = ContractAddr;
         this->contractDataCache = contractDataCache;
-        auto roothashnode = std::shared_ptr<packing<HashNode>>(
-            new packing<HashNode>(HashNode{ roothash }));
+        auto roothashnode = NewNode(HashNode{ roothash });
         root = ResolveHash(roothashnode, "");
     }
 
@@ -123,6 +170,10 @@ public:
     nodePtr Update(std::string key, std::string value);
 
     nodePtr DescendKey(std::string key) const;
+    nodePtr DecodeValue(const std::string& hash, const std::string& value) const;
+    // value is the rlp encoding itself rather than its hex
+    nodePtr DecodeBytes(const std::string& hash, const std::string& value) const;
+    void Prefetch(const FullNode& fn) const;
     nodePtr DecodeShort(std::string hash, dev::RLP const& r) const;
     nodePtr DecodeFull(std::string hash, dev::RLP const& r) const;
     nodePtr DecodeRef(dev::RLP const& r) const;
@@ -134,9 +185,19 @@ public:
     nodePtr ToHash(nodePtr n);
     dev::RLPStream Encode(nodePtr n);
 
-    nodePtr Store(nodePtr n);
-    nodePtr Commit(nodePtr n);
-    std::array<nodePtr, 17>commitChildren(nodePtr n);
+    // Encoded dirty nodes by hash, collected by Commit
+    using WriteSet = std::vector<std::pair<std::string, std::string>>;
+
+    nodePtr Store(nodePtr n, WriteSet& writes);
+    nodePtr Commit(nodePtr n, WriteSet& writes, bool parallel = false);
+    std::array<nodePtr, 17>commitChildren(nodePtr n, WriteSet& writes, bool parallel = false);
+    void HashChildrenInParallel(nodePtr n);
+    // Whether Commit has to store the node
+    static bool IsDirty(const nodePtr& n);
+    // Dirty nodes in the subtree of n, counting stops at limit
+    static size_t CountDirty(const nodePtr& n, size_t limit);
+    // Run task(0) to task(count - 1) on at most one thread per core, the caller included
+    static void RunInParallel(size_t count, const std::function<void(size_t)>& task);
 
     void Save();
 
@@ -147,11 +208,19 @@ public:
     int Toint(char c) const;
 
     void GetBlockStorage(std::pair<std::string, std::string>& rootHash, std::map<std::string, std::string>& dirtyHash);
+
+    // Full nodes this close to the root get all their children loaded in one read
+    static const size_t kPrefetchDepth = 2;
+    // The dirty subtrees under the top full node are hashed and committed on several
+    // threads when there are at least this many of them and the trie has at least
+    // kParallelMinDirtyNodes dirty nodes, smaller saves are not worth starting threads
+    static const size_t kParallelMinChildren = 4;
+    static const size_t kParallelMinDirtyNodes = 512;
 public:
     mutable nodePtr root;
     std::string contractAddr;
     std::map<std::string, std::string> dirtyHash;
-     mutable ContractDataCache* contractDataCache;
+     mutable ContractDataCache* contractDataCache = nullptr;
 };
 #endif
 
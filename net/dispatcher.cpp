@@ -1,10 +1,17 @@
 #include "dispatcher.h"
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include <utility>
 #include <string>
+#include <algorithm>
+#include <shared_mutex>
 
 #include "./global.h"
 #include "./key_exchange.h"
+#include "./msg_type.h"
 #include "../utils/magic_singleton.h"
 
 #include "../common/global.h"
@@ -12,11 +19,94 @@
 #include "../include/logging.h"
 #include "../proto/common.pb.h"
 #include "../utils/compress.h"
+#include "../common/proto_arena.h"
 
-int ProtobufDispatcher::Handle(const MsgData &data)
+namespace
 {
-    CommonMsg commonMsg;
+    // Task pools, in the order Handle tries them
+    enum Pool
+    {
+        kBlockPool,
+        kSaveBlockPool,
+        kBroadcastPool,
+        kCaPool,
+        kNetPool,
+        kTxPool,
+        kSyncBlockPool,
+        kPoolCount
+    };
+
+    using CallbackMaps = std::array<const std::map<const std::string, ProtoCallBack> *, kPoolCount>;
+
+    struct TypeEntry
+    {
+        std::string name;
+        const Descriptor *descriptor = nullptr;
+        const Message *prototype = nullptr;
+        // Key exchange messages travel before there is a key
+        bool plaintext = false;
+        std::array<ProtoCallBack, kPoolCount> handlers;
+    };
+
+    struct TypeCounter
+    {
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint64_t> bytes{0};
+    };
+
+    /**
+     * @brief       What Handle needs per message type, indexed by msg_type id. It is kept here
+     *              rather than in ProtobufDispatcher so that the class layout stays the one the
+     *              prebuilt ca_core library was built with.
+     */
+    struct TypeTable
+    {
+        std::shared_mutex mutex;
+        // Filled from the callback maps on the first message of a type, cleared when they change
+        std::vector<std::shared_ptr<const TypeEntry>> entries = std::vector<std::shared_ptr<const TypeEntry>>(msg_type::kCount);
+        uint64_t generation = 0;
+
+        std::vector<TypeCounter> counters = std::vector<TypeCounter>(msg_type::kCount);
+        // Types without an id
+        std::mutex otherMutex;
+        std::map<std::string, std::pair<uint32_t, uint64_t>> otherCounts;
+    };
+
+    TypeTable &GetTypeTable()
+    {
+        static TypeTable table;
+        return table;
+    }
+
+    std::shared_ptr<const TypeEntry> BuildEntry(const std::string &name, const CallbackMaps &maps)
+    {
+        auto entry = std::make_shared<TypeEntry>();
+        entry->name = name;
+        entry->descriptor = google::protobuf::DescriptorPool::generated_pool()->FindMessageTypeByName(name);
+        if (entry->descriptor)
+        {
+            entry->prototype = google::protobuf::MessageFactory::generated_factory()->GetPrototype(entry->descriptor);
+        }
+        entry->plaintext = (name == "KeyExchangeRequest" || name == "KeyExchangeResponse");
+        for (size_t pool = 0; pool < kPoolCount; ++pool)
+        {
+            auto found = maps[pool]->find(name);
+            if (found != maps[pool]->end())
+            {
+                entry->handlers[pool] = found->second;
+            }
+        }
+        return entry;
+    }
+}
+
+int ProtobufDispatcher::Handle(MsgData &data)
+{
+    // The envelope and the ciphertext are done with before this returns
+    ScratchArena scratch;
+    auto &commonMsg = *scratch.Create<CommonMsg>();
     int ret = commonMsg.ParseFromString(data.pack.data);
+    std::string().swap(data.pack.data);
     if (!ret)
     {
         ERRORLOG("parse CommonMsg error");
@@ -24,10 +114,28 @@ int ProtobufDispatcher::Handle(const MsgData &data)
     }
 
     std::string type = commonMsg.type();
+    // Peers that predate the type id only send the name
+    auto typeId = msg_type::GetId(commonMsg);
+    if (typeId >= msg_type::kCount)
+    {
+        typeId = 0;
+    }
+    if (typeId == 0)
+    {
+        typeId = msg_type::IdByName(type);
+    }
+
+    auto &table = GetTypeTable();
+    if (typeId != 0)
+    {
+        table.counters[typeId].count.fetch_add(1, std::memory_order_relaxed);
+        table.counters[typeId].bytes.fetch_add(commonMsg.data().size(), std::memory_order_relaxed);
+    }
+    else
     {
-        std::lock_guard<std::mutex> lock(global::g_mutexReqCntMap);
-        global::g_reqCntMap[type].first += 1;
-        global::g_reqCntMap[type].second += commonMsg.data().size();
+        std::lock_guard<std::mutex> lock(table.otherMutex);
+        table.otherCounts[type].first += 1;
+        table.otherCounts[type].second += commonMsg.data().size();
     }
     
     if (commonMsg.version() != global::kNetVersion)
@@ -36,23 +144,47 @@ int ProtobufDispatcher::Handle(const MsgData &data)
         return -2;
     }
 
-    if (type.size() == 0)
+    if (typeId == 0 && type.size() == 0)
     {
         ERRORLOG("handle type is empty");
         return -3;
     }
 
-    const Descriptor *des = google::protobuf::DescriptorPool::generated_pool()->FindMessageTypeByName(type);
-    if (!des)
+    const CallbackMaps maps = {&_blockProtocbs, &_saveBlockProtocbs, &_broadcastProtocbs, &_caProtocbs,
+                               &_netProtocbs, &_txProtocbs, &_syncBlockProtocbs};
+    std::shared_ptr<const TypeEntry> entry;
+    if (typeId != 0)
+    {
+        uint64_t generation = 0;
+        {
+            std::shared_lock<std::shared_mutex> lock(table.mutex);
+            entry = table.entries[typeId];
+            generation = table.generation;
+        }
+        if (entry == nullptr)
+        {
+            entry = BuildEntry(msg_type::kNames[typeId], maps);
+            std::unique_lock<std::shared_mutex> lock(table.mutex);
+            if (table.generation == generation && table.entries[typeId] == nullptr)
+            {
+                table.entries[typeId] = entry;
+            }
+        }
+    }
+    else
+    {
+        entry = BuildEntry(type, maps);
+    }
+
+    if (!entry->descriptor)
     {
-        ERRORLOG("cannot create Descriptor for {}", type.c_str());
+        ERRORLOG("cannot create Descriptor for {}", entry->name.c_str());
         return -4;
     }
 
-    const Message *proto = google::protobuf::MessageFactory::generated_factory()->GetPrototype(des);
-    if (!proto)
+    if (!entry->prototype)
     {
-        ERRORLOG("cannot create Message for {}", type.c_str());
+        ERRORLOG("cannot create Message for {}", entry->name.c_str());
         return -5;
     }
 
@@ -64,12 +196,12 @@ int ProtobufDispatcher::Handle(const MsgData &data)
     }
     else
     {
-        subSerializeMsg = std::move(commonMsg.data());
+        subSerializeMsg = std::move(*commonMsg.mutable_data());
     }
       std::string str_plaintext;
-    if(type != "KeyExchangeRequest" && type != "KeyExchangeResponse")
+    if(!entry->plaintext)
     {
-        Ciphertext ciphertext;
+        auto &ciphertext = *scratch.Create<Ciphertext>();
         if(!ciphertext.ParseFromString(subSerializeMsg))
         {
             ERRORLOG("ParseFromString Ciphertext fail!!!");
@@ -105,66 +237,88 @@ int ProtobufDispatcher::Handle(const MsgData &data)
     {
         str_plaintext = std::move(subSerializeMsg);
     }
-    MessagePtr subMsg(proto->New());
+    // The message lives on its own arena, kept alive by every copy of subMsg
+    auto arena = MakeSharedArena(str_plaintext.size());
+    MessagePtr subMsg(arena, entry->prototype->New(arena.get()));
     ret = subMsg->ParseFromString(str_plaintext);
     if (!ret)
     {
-        ERRORLOG("bad msg for protobuf for {}", type.c_str());
+        ERRORLOG("bad msg for protobuf for {}", entry->name.c_str());
         return -11;
     }
 
     auto taskPool = MagicSingleton<TaskPool>::GetInstance();
-    std::string name = subMsg->GetDescriptor()->name();
+    const auto &handlers = entry->handlers;
 
-    auto blockMap = _blockProtocbs.find(name);
-    if (blockMap != _blockProtocbs.end())
+    if (handlers[kBlockPool])
     {
-        taskPool->CommitBlockTask(blockMap->second, subMsg, data);
+        taskPool->CommitBlockTask(handlers[kBlockPool], subMsg, data);
         return 0;
     }
 
-    auto saveBlockmap = _saveBlockProtocbs.find(name);
-    if (saveBlockmap != _saveBlockProtocbs.end())
+    if (handlers[kSaveBlockPool])
     {
-        taskPool->CommitSaveBlockTask(saveBlockmap->second, subMsg, data);
+        taskPool->CommitSaveBlockTask(handlers[kSaveBlockPool], subMsg, data);
     }
 
-    auto broadcastMap= _broadcastProtocbs.find(name);
-    if (broadcastMap != _broadcastProtocbs.end())
+    if (handlers[kBroadcastPool])
     {
-        taskPool->CommitBroadcastTask(broadcastMap->second, subMsg, data);
+        taskPool->CommitBroadcastTask(handlers[kBroadcastPool], subMsg, data);
         return 0;
     }
 
-    auto caMap = _caProtocbs.find(name);
-    if (caMap != _caProtocbs.end())
+    if (handlers[kCaPool])
     {
-        taskPool->CommitCaTask(caMap->second, subMsg, data);
+        taskPool->CommitCaTask(handlers[kCaPool], subMsg, data);
         return 0;
     }
 
-    auto netMap = _netProtocbs.find(name);
-    if (netMap != _netProtocbs.end())
+    if (handlers[kNetPool])
     {
-        taskPool->CommitNetTask(netMap->second, subMsg, data);
+        taskPool->CommitNetTask(handlers[kNetPool], subMsg, data);
         return 0;
     }
-    auto txMap = _txProtocbs.find(name);
-    if (txMap != _txProtocbs.end())
+    if (handlers[kTxPool])
     {
-        taskPool->CommitTxTask(txMap->second, subMsg, data);
+        taskPool->CommitTxTask(handlers[kTxPool], subMsg, data);
         return 0;
     }
-    auto syncBlockMap = _syncBlockProtocbs.find(name);
-    if (syncBlockMap != _syncBlockProtocbs.end())
+    if (handlers[kSyncBlockPool])
     {
-        taskPool->CommitSyncBlockTask(syncBlockMap->second, subMsg, data);
+        taskPool->CommitSyncBlockTask(handlers[kSyncBlockPool], subMsg, data);
         return 0;
     }
 
     return -12;
 }
 
+void ProtobufDispatcher::_ResetTypeTable()
+{
+    auto &table = GetTypeTable();
+    std::unique_lock<std::shared_mutex> lock(table.mutex);
+    std::fill(table.entries.begin(), table.entries.end(), nullptr);
+    ++table.generation;
+}
+
+std::map<std::string, std::pair<uint32_t, uint64_t>> ProtobufDispatcher::GetReqCount() const
+{
+    auto &table = GetTypeTable();
+    std::map<std::string, std::pair<uint32_t, uint64_t>> reqCount;
+    {
+        std::lock_guard<std::mutex> lock(table.otherMutex);
+        reqCount = table.otherCounts;
+    }
+    for (uint32_t id = 1; id < msg_type::kCount; ++id)
+    {
+        auto count = table.counters[id].count.load(std::memory_order_relaxed);
+        if (count != 0)
+        {
+            reqCount[msg_type::kNames[id]] = {count, table.counters[id].bytes.load(std::memory_order_relaxed)};
+        }
+    }
+    return reqCount;
+}
+
 void ProtobufDispatcher::TaskInfo(std::ostringstream& oss)
 {
     auto taskPool = MagicSingleton<TaskPool>::GetInstance();
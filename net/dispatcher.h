@@ -23,10 +23,10 @@ public:
     /**
      * @brief       
      * 
-     * @param       data 
+     * @param       data: its packed payload is released once parsed
      * @return      int 
      */
-    int Handle(const MsgData &data);
+    int Handle(MsgData &data);
 
     /**
      * @brief       
@@ -160,7 +160,21 @@ public:
      * @param       oss 
      */
     void TaskInfo(std::ostringstream& oss);
+
+    /**
+     * @brief       Number of calls and bytes received per message type
+     * 
+     * @return      std::map<std::string, std::pair<uint32_t, uint64_t>> 
+     */
+    std::map<std::string, std::pair<uint32_t, uint64_t>> GetReqCount() const;
 private:
+    /**
+     * @brief       Drop the handlers Handle has looked up by type id, called whenever a callback
+     *              map changes
+     * 
+     */
+    void _ResetTypeTable();
+
     /**
      * @brief       
      * 
@@ -185,6 +199,7 @@ void ProtobufDispatcher::CaRegisterCallback(std::function<int(const std::shared_
     {
         return cb(std::static_pointer_cast<T>(msg), from);
     };
+    _ResetTypeTable();
 }
 
 template <typename T>
@@ -194,6 +209,7 @@ void ProtobufDispatcher::NetRegisterCallback(std::function<int(const std::shared
     {
         return cb(std::static_pointer_cast<T>(msg), from);
     };
+    _ResetTypeTable();
 }
 
 
@@ -204,6 +220,7 @@ void ProtobufDispatcher::BroadcastRegisterCallback(std::function<int(const std::
     {
         return cb(std::static_pointer_cast<T>(msg), from);
     };
+    _ResetTypeTable();
 }
 
 template <typename T>
@@ -213,6 +230,7 @@ void ProtobufDispatcher::TxRegisterCallback(std::function<int(const std::shared_
     {
         return cb(std::static_pointer_cast<T>(msg), from);
     };
+    _ResetTypeTable();
 }
 
 template <typename T>
@@ -222,6 +240,7 @@ void ProtobufDispatcher::SyncBlockRegisterCallback(std::function<int(const std::
     {
         return cb(std::static_pointer_cast<T>(msg), from);
     };
+    _ResetTypeTable();
 }
 
 template <typename T>
@@ -231,6 +250,7 @@ void ProtobufDispatcher::SaveBlockRegisterCallback(std::function<int(const std::
     {
         return cb(std::static_pointer_cast<T>(msg), from);
     };
+    _ResetTypeTable();
 }
 
 template <typename T>
@@ -240,46 +260,54 @@ void ProtobufDispatcher::BlockRegisterCallback(std::function<int(const std::shar
     {
         return cb(std::static_pointer_cast<T>(msg), from);
     };
+    _ResetTypeTable();
 }
 
 template <typename T>
 void ProtobufDispatcher::CaUnregisterCallback()
 {
     _caProtocbs.erase(T::descriptor()->name());
+    _ResetTypeTable();
 }
 template <typename T>
 void ProtobufDispatcher::NetUnregisterCallback()
 {
     _netProtocbs.erase(T::descriptor()->name());
+    _ResetTypeTable();
 }
 
 template <typename T>
 void ProtobufDispatcher::BroadcastUnregisterCallback()
 {
     _broadcastProtocbs.erase(T::descriptor()->name());
+    _ResetTypeTable();
 }
 
 template <typename T>
 void ProtobufDispatcher::TxUnregisterCallback()
 {
     _txProtocbs.erase(T::descriptor()->name());
+    _ResetTypeTable();
 }
 
 template <typename T>
 void ProtobufDispatcher::SyncBlockUnregisterCallback()
 {
     _syncBlockProtocbs.erase(T::descriptor()->name());
+    _ResetTypeTable();
 }
 
 template <typename T>
 void ProtobufDispatcher::SaveBlockUnregisterCallback()
 {
     _saveBlockProtocbs.erase(T::descriptor()->name());
+    _ResetTypeTable();
 }
 
 template <typename T>
 void ProtobufDispatcher::BlockUnregisterCallback()
 {
     _blockProtocbs.erase(T::descriptor()->name());
+    _ResetTypeTable();
 }
 #endif
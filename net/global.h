@@ -35,6 +35,7 @@ namespace global
     extern std::condition_variable_any g_condListenThread;
     extern bool g_ListenThreadInited;
 
+    // Kept for the prebuilt ca_core library, requests are counted by ProtobufDispatcher::GetReqCount
     extern std::mutex g_mutexReqCntMap;
     extern std::map<std::string, std::pair<uint32_t, uint64_t>> g_reqCntMap;
     extern int g_broadcastThreshold;
@@ -93,9 +93,9 @@ int HandleRegisterNodeReq(const std::shared_ptr<RegisterNodeReq> &registerNode,
 	//MagicSingleton<PeerNode>::GetInstance()->DisconnectNode(node);
 
 	//Multiple registration of the same IP address is prohibited
-	std::vector<Node> pubNodeList = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-	auto result = std::find_if(pubNodeList.begin(), pubNodeList.end(),[&from](auto & node){ return from.ip == node.publicIp;});
-	if(result != pubNodeList.end())
+	auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+	auto result = std::find_if(peerTable->byAddress.begin(), peerTable->byAddress.end(),[&from](auto & item){ return from.ip == item.second->publicIp;});
+	if(result != peerTable->byAddress.end())
 	{
 		return ret -= 1;
 	}
@@ -720,16 +720,9 @@ void initCyclicTargetAddresses(const std::shared_ptr<BuildBlockBroadcastMsg>& ms
 
 void initCyclicNodeList(Cycliclist<std::string>& cyclicNodeList) 
 {
-	std::vector<std::string> nodeListAddrs;
-	std::vector<Node> nodeList = MagicSingleton<PeerNode>::GetInstance()->GetNodelist();
-	
-	for(auto &node : nodeList)
-	{
-		nodeListAddrs.push_back(node.address);
-	}
-	std::sort(nodeListAddrs.begin(),nodeListAddrs.end());
-
-	for(auto & addr : nodeListAddrs)
+	// The table is already ordered by address
+	auto peerTable = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+	for(auto & [addr, node] : peerTable->byAddress)
 	{
 		DEBUGLOG("broadcast cyclic list addr : {}", addr);
 		cyclicNodeList.push_back(addr);
@@ -6,23 +6,162 @@
 #include <functional>
 
 #include "../common/config.h"
+#include "../common/global.h"
+#include "../include/scope_guard.h"
 #include "../utils/magic_singleton.h"
 
 
 std::thread HttpServer::_listenThread;
 std::map<const std::string, HttpCallBack> HttpServer::_cbs;
+std::map<const std::string, uint32_t> HttpServer::_routeLimits;
 std::map<const std::string, JsonRpcCallBack> HttpServer::rpcCbs;
 
+HttpTaskQueue::HttpTaskQueue(size_t threadNum, size_t maxPending)
+  : _maxPending(maxPending), _shutdown(false)
+{
+  for(size_t i = 0; i < threadNum; ++i)
+  {
+    _threads.emplace_back(&HttpTaskQueue::_Work, this);
+  }
+}
+
+void HttpTaskQueue::enqueue(std::function<void()> fn)
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _notFull.wait(lock, [this] { return _jobs.size() < _maxPending || _shutdown; });
+  _jobs.push_back(std::move(fn));
+  _notEmpty.notify_one();
+}
+
+void HttpTaskQueue::shutdown()
+{
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _shutdown = true;
+  }
+  _notEmpty.notify_all();
+  _notFull.notify_all();
+
+  for(auto &t : _threads)
+  {
+    t.join();
+  }
+}
+
+void HttpTaskQueue::_Work()
+{
+  for(;;)
+  {
+    std::function<void()> fn;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _notEmpty.wait(lock, [this] { return !_jobs.empty() || _shutdown; });
+      if(_shutdown && _jobs.empty())
+      {
+        break;
+      }
+      fn = std::move(_jobs.front());
+      _jobs.pop_front();
+    }
+    _notFull.notify_one();
+    fn();
+  }
+}
+
+bool RouteLimiter::TryAcquire()
+{
+  uint32_t running = _running.load(std::memory_order_relaxed);
+  do
+  {
+    if(running >= _maxConcurrent)
+    {
+      return false;
+    }
+  } while(!_running.compare_exchange_weak(running, running + 1, std::memory_order_acquire, std::memory_order_relaxed));
+  return true;
+}
+
+void RouteLimiter::Release()
+{
+  _running.fetch_sub(1, std::memory_order_release);
+}
+
+bool KeepAliveCappedServer::process_and_close_socket(socket_t sock)
+{
+  size_t running = _keepAliveConnections.load(std::memory_order_relaxed);
+  bool keepAlive = false;
+  while(running < _maxKeepAliveConnections)
+  {
+    if(_keepAliveConnections.compare_exchange_weak(running, running + 1, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+      keepAlive = true;
+      break;
+    }
+  }
+  ON_SCOPE_EXIT{
+    if(keepAlive)
+    {
+      _keepAliveConnections.fetch_sub(1, std::memory_order_release);
+    }
+  };
+
+  auto ret = detail::process_server_socket(
+      sock, keepAlive ? keep_alive_max_count_ : 1, read_timeout_sec_, read_timeout_usec_,
+      write_timeout_sec_, write_timeout_usec_,
+      [this](Stream &strm, bool closeConnection, bool &connectionClosed) {
+        return process_request(strm, closeConnection, connectionClosed, nullptr);
+      });
+
+  detail::shutdown_socket(sock);
+  detail::close_socket(sock);
+  return ret;
+}
+
 void HttpServer::Work()
 {
   using namespace httplib;
 
-  Server svr;
+  KeepAliveCappedServer svr(kMaxKeepAliveConnections);
+  svr.new_task_queue = [] { return new HttpTaskQueue(global::kHttpThreadNumber, kMaxPendingConnections); };
+  svr.set_keep_alive_max_count(kKeepAliveMaxCount);
+  svr.set_read_timeout(kReadTimeoutSecond);
+  svr.set_write_timeout(kWriteTimeoutSecond);
+  svr.set_payload_max_length(kPayloadMaxLength);
 
   for(auto item: _cbs)
   {
-    svr.Get(item.first.c_str(), item.second);
-    svr.Post(item.first.c_str(), item.second);
+    HttpCallBack handler = item.second;
+    auto limit = _routeLimits.find(item.first);
+    if(limit != _routeLimits.end())
+    {
+      auto limiter = std::make_shared<RouteLimiter>(limit->second);
+      handler = [limiter, cb = item.second](const Request &req, Response &res)
+      {
+        if(!limiter->TryAcquire())
+        {
+          res.status = 503;
+          res.set_header("Retry-After", "1");
+          res.set_content(R"({"jsonrpc":"2.0","error":{"code":-32005,"message":"Server busy"},"id":""})", "application/json");
+          return;
+        }
+        // Released when the request is done, for a streamed response that is when httplib
+        // drops the content provider, since the provider does the expensive rendering
+        std::shared_ptr<void> token(nullptr, [limiter](void *){ limiter->Release(); });
+        cb(req, res);
+        if(res.content_provider_)
+        {
+          res.content_provider_resource_releaser_ = [token, releaser = std::move(res.content_provider_resource_releaser_)]()
+          {
+            if(releaser)
+            {
+              releaser();
+            }
+          };
+        }
+      };
+    }
+    svr.Get(item.first.c_str(), handler);
+    svr.Post(item.first.c_str(), handler);
   }
 
   int port = 8080;
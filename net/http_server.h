@@ -12,22 +12,87 @@
 
 #include <map>
 #include <list>
+#include <deque>
 #include <mutex>
+#include <atomic>
 #include <vector>
 #include <string>
 #include <thread>
 #include <vector>
 #include <iostream>
+#include <condition_variable>
 
 #include "./httplib.h"
 
 #include "../utils/json.hpp"
+#include "../common/global.h"
 
 using namespace httplib;
 
 typedef std::function<void(const Request &, Response &)> HttpCallBack;
 typedef std::function<nlohmann::json(const nlohmann::json &)> JsonRpcCallBack;
 
+/**
+ * @brief       Bounded connection queue for httplib. When all workers are busy and
+ *              the queue is full, enqueue blocks the accept loop so that further
+ *              connections wait in the kernel backlog instead of spawning work.
+ */
+class HttpTaskQueue : public httplib::TaskQueue
+{
+public:
+	HttpTaskQueue(size_t threadNum, size_t maxPending);
+	~HttpTaskQueue() override = default;
+	HttpTaskQueue(const HttpTaskQueue &) = delete;
+	HttpTaskQueue &operator=(const HttpTaskQueue &) = delete;
+
+	void enqueue(std::function<void()> fn) override;
+	void shutdown() override;
+
+private:
+	void _Work();
+
+	std::vector<std::thread> _threads;
+	std::deque<std::function<void()>> _jobs;
+	size_t _maxPending;
+	bool _shutdown;
+	std::mutex _mutex;
+	std::condition_variable _notEmpty;
+	std::condition_variable _notFull;
+};
+
+/**
+ * @brief       Limits the number of requests of one route handled at the same time
+ */
+class RouteLimiter
+{
+public:
+	explicit RouteLimiter(uint32_t maxConcurrent) : _maxConcurrent(maxConcurrent), _running(0) {}
+
+	bool TryAcquire();
+	void Release();
+
+private:
+	const uint32_t _maxConcurrent;
+	std::atomic<uint32_t> _running;
+};
+
+/**
+ * @brief       httplib server that lets only a few connections at a time stay open between
+ *              requests. Any other connection is closed after one request, so idle keep-alive
+ *              clients can never hold all the workers.
+ */
+class KeepAliveCappedServer : public httplib::Server
+{
+public:
+	explicit KeepAliveCappedServer(size_t maxKeepAliveConnections)
+		: _maxKeepAliveConnections(maxKeepAliveConnections), _keepAliveConnections(0) {}
+
+private:
+	bool process_and_close_socket(socket_t sock) override;
+
+	const size_t _maxKeepAliveConnections;
+	std::atomic<size_t> _keepAliveConnections;
+};
 
 class HttpServer
 {
@@ -63,6 +128,19 @@ public:
 		HttpServer::_cbs[pattern] = handler;
 	}
 
+	/**
+	 * @brief       
+	 * 
+	 * @param       pattern 
+	 * @param       handler 
+	 * @param       maxConcurrent maximum requests of this route served at once, the rest get 503
+	 */
+	static void RegisterCallback(std::string pattern, HttpCallBack handler, uint32_t maxConcurrent)
+	{
+		HttpServer::_cbs[pattern] = handler;
+		HttpServer::_routeLimits[pattern] = maxConcurrent;
+	}
+
 	/**
 	 * @brief       
 	 * 
@@ -75,10 +153,19 @@ public:
 	}
 
 	static std::map<const std::string, JsonRpcCallBack> rpcCbs;
+
+	static const size_t kMaxPendingConnections = 256;
+	static const size_t kKeepAliveMaxCount = 100;
+	// Connections kept alive at once, the other half of the workers stays free for new clients
+	static const size_t kMaxKeepAliveConnections = global::kHttpThreadNumber / 2;
+	static const time_t kReadTimeoutSecond = 5;
+	static const time_t kWriteTimeoutSecond = 5;
+	static const size_t kPayloadMaxLength = 8 * 1024 * 1024;
 private:
     friend std::string PrintCache(int where);
     static std::thread _listenThread;
 	static std::map<const std::string, HttpCallBack> _cbs;
+	static std::map<const std::string, uint32_t> _routeLimits;
 };
 
 /**
@@ -0,0 +1,117 @@
+#include "./msg_type.h"
+
+#include <unordered_map>
+
+#include "../proto/common.pb.h"
+
+namespace msg_type
+{
+    const char* const kNames[] = {
+        "",
+        "RegisterNodeReq",
+        "RegisterNodeAck",
+        "SyncNodeReq",
+        "SyncNodeAck",
+        "CheckTxReq",
+        "CheckTxAck",
+        "GetUtxoHashReq",
+        "GetUtxoHashAck",
+        "PrintMsgReq",
+        "PingReq",
+        "PongReq",
+        "EchoReq",
+        "EchoAck",
+        "TestNetAck",
+        "TestNetReq",
+        "NodeHeightChangedReq",
+        "NodeAddrChangedReq",
+        "KeyExchangeRequest",
+        "KeyExchangeResponse",
+        "BuildBlockBroadcastMsg",
+        "GetBlockReq",
+        "GetBalanceReq",
+        "GetNodeInfoReq",
+        "GetStakeListReq",
+        "GetInvestListReq",
+        "GetUtxoReq",
+        "GetAllInvestAddressReq",
+        "GetAllStakeNodeListReq",
+        "GetSignCountListReq",
+        "GetHeightReq",
+        "GetBonusListReq",
+        "GetSDKReq",
+        "ConfirmTransactionReq",
+        "GetRestInvestAmountReq",
+        "MultiSignTxReq",
+        "BlockStatus",
+        "FastSyncGetHashReq",
+        "FastSyncGetHashAck",
+        "FastSyncGetBlockReq",
+        "FastSyncGetBlockAck",
+        "SyncGetSumHashReq",
+        "SyncGetSumHashAck",
+        "SyncGetHeightHashReq",
+        "SyncGetHeightHashAck",
+        "SyncGetBlockReq",
+        "SyncGetBlockAck",
+        "SyncFromZeroGetSumHashReq",
+        "SyncFromZeroGetSumHashAck",
+        "SyncFromZeroGetBlockReq",
+        "SyncFromZeroGetBlockAck",
+        "SyncNodeHashReq",
+        "SyncNodeHashAck",
+        "GetBlockByUtxoReq",
+        "GetBlockByUtxoAck",
+        "GetBlockByHashReq",
+        "GetBlockByHashAck",
+        "SeekPreHashByHightReq",
+        "SeekPreHashByHightAck",
+        "GetCheckSumHashReq",
+        "GetCheckSumHashAck",
+        "TxMsgReq",
+        "ContractTxMsgReq",
+        "ContractPackagerMsg",
+        "BlockMsg",
+        "newSeekContractPreHashReq",
+        "newSeekContractPreHashAck",
+    };
+    const uint32_t kCount = sizeof(kNames) / sizeof(kNames[0]);
+
+    uint32_t IdByName(const std::string& name)
+    {
+        static const std::unordered_map<std::string, uint32_t> ids = []()
+        {
+            std::unordered_map<std::string, uint32_t> ids;
+            for (uint32_t id = 1; id < kCount; ++id)
+            {
+                ids.emplace(kNames[id], id);
+            }
+            return ids;
+        }();
+
+        auto found = ids.find(name);
+        return found == ids.end() ? 0 : found->second;
+    }
+
+    void SetId(CommonMsg& msg, uint32_t id)
+    {
+        if (id != 0)
+        {
+            msg.GetReflection()->MutableUnknownFields(&msg)->AddVarint(kFieldNumber, id);
+        }
+    }
+
+    uint32_t GetId(const CommonMsg& msg)
+    {
+        const auto& fields = msg.GetReflection()->GetUnknownFields(msg);
+        for (int i = 0; i < fields.field_count(); ++i)
+        {
+            const auto& field = fields.field(i);
+            if (field.number() == kFieldNumber && field.type() == google::protobuf::UnknownField::TYPE_VARINT)
+            {
+                return static_cast<uint32_t>(field.varint());
+            }
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,66 @@
+/**
+ * *****************************************************************************
+ * @file        msg_type.h
+ * @brief       Numeric wire ids of the message types, carried in field 9 of CommonMsg
+ * @date        2024-06-24
+ * @copyright   tfsc
+ * *****************************************************************************
+ */
+#ifndef _MSG_TYPE_H_
+#define _MSG_TYPE_H_
+
+#include <cstdint>
+#include <string>
+
+class CommonMsg;
+
+namespace msg_type
+{
+    // The id is not declared in common.proto. It travels as an unknown field, so CommonMsg
+    // keeps the layout the prebuilt ca_core library was built with
+    const int kFieldNumber = 9;
+
+    // Names by id. The list is append only, an id never changes meaning, and 0 is
+    // reserved for a sender that only sets CommonMsg.type
+    extern const char* const kNames[];
+    extern const uint32_t kCount;
+
+    /**
+     * @brief       
+     * 
+     * @param       name: 
+     * @return      uint32_t 0 if the type has no id
+     */
+    uint32_t IdByName(const std::string& name);
+
+    /**
+     * @brief       
+     * 
+     * @param       msg: 
+     * @param       id: 
+     */
+    void SetId(CommonMsg& msg, uint32_t id);
+
+    /**
+     * @brief       
+     * 
+     * @param       msg: 
+     * @return      uint32_t 0 if the sender did not set one
+     */
+    uint32_t GetId(const CommonMsg& msg);
+
+    /**
+     * @brief       Id of T, looked up once per type
+     * 
+     * @tparam T 
+     * @return      uint32_t 
+     */
+    template <typename T>
+    uint32_t Id()
+    {
+        static const uint32_t id = IdByName(T::descriptor()->name());
+        return id;
+    }
+}
+
+#endif
@@ -17,6 +17,7 @@
 
 #include "../proto/net.pb.h"
 #include "../proto/common.pb.h"
+#include "./msg_type.h"
 #include "../utils/compress.h"
 #include "../common/global.h"
 
@@ -88,6 +89,7 @@ template <typename T>
 bool Pack::InitCommonMsg(CommonMsg& msg, T& submsg, int32_t encrypt, int32_t compress)
 {
 	msg.set_type(submsg.descriptor()->name());
+	msg_type::SetId(msg, msg_type::Id<T>());
 	msg.set_version(global::kNetVersion);
 	msg.set_encrypt(encrypt);
 	
@@ -120,6 +122,7 @@ template <typename T>
 bool Pack::InitCommonMsg(CommonMsg & msg, T& submsg, const EcdhKey &key, int32_t encrypt, int32_t compress)
 {
 	msg.set_type(submsg.descriptor()->name());
+	msg_type::SetId(msg, msg_type::Id<T>());
 	msg.set_version(global::kNetVersion);
 	msg.set_encrypt(encrypt);
 	const std::string& str_plaintext = submsg.SerializeAsString();
@@ -17,6 +17,37 @@
 #include "../net/global.h"
 #include "../common/config.h"
 
+const Node * PeerTable::FindByAddress(const std::string &address) const
+{
+	auto it = byAddress.find(address);
+	return it == byAddress.end() ? nullptr : it->second.get();
+}
+
+const Node * PeerTable::FindByFd(int32_t fd) const
+{
+	auto it = byFd.find(fd);
+	return it == byFd.end() ? nullptr : it->second.get();
+}
+
+void PeerNode::_Publish(std::map<std::string, PeerTable::NodePtr> &&byAddress)
+{
+	auto table = std::make_shared<PeerTable>();
+	table->byAddress = std::move(byAddress);
+	table->byFd.reserve(table->byAddress.size());
+	for (auto & [addr, node] : table->byAddress)
+	{
+		if (node->fd > 0)
+		{
+			table->byFd.emplace(node->fd, node);
+		}
+		if (node->IsConnected())
+		{
+			table->connected.push_back(node);
+		}
+	}
+	std::atomic_store_explicit(&_table, PeerTablePtr(std::move(table)), std::memory_order_release);
+}
+
 bool PeerNode::Add(const Node& node)
 {
 	uint64_t chainHeight = 0;
@@ -25,8 +56,9 @@ bool PeerNode::Add(const Node& node)
 		return false;
 	}
 
-	std::unique_lock<std::shared_mutex> lck(_mutexForNodes);
-	if(_nodeMap.size() >= global::ca::KMinSyncQualNodes && node.height > chainHeight + global::ca::KChainHighThreshold)
+	std::lock_guard<std::mutex> lck(_mutexForNodes);
+	auto table = GetPeerTable();
+	if(table->byAddress.size() >= global::ca::KMinSyncQualNodes && node.height > chainHeight + global::ca::KChainHighThreshold)
 	{
 		return false;
 	}
@@ -39,12 +71,13 @@ bool PeerNode::Add(const Node& node)
 	{
 		return false;
 	}
-	auto itr = _nodeMap.find(node.address);
-	if (itr != _nodeMap.end())
+	if (table->byAddress.find(node.address) != table->byAddress.end())
 	{
 		return false;
 	}
-	this->_nodeMap[node.address] = node;
+	auto byAddress = table->byAddress;
+	byAddress[node.address] = std::make_shared<const Node>(node);
+	_Publish(std::move(byAddress));
 
 	return true;
 }
@@ -57,19 +90,21 @@ bool PeerNode::Update(const Node & node)
 		return false;
 	}
 
-	if(_nodeMap.size() >= global::ca::KMinSyncQualNodes && node.height > chainHeight + global::ca::KChainHighThreshold)
+	if(GetNodelistSize() >= global::ca::KMinSyncQualNodes && node.height > chainHeight + global::ca::KChainHighThreshold)
 	{
 		return false;
 	}
 
 	{
-		std::unique_lock<std::shared_mutex> lck(_mutexForNodes);
-		auto itr = this->_nodeMap.find(node.address);
-		if (itr == this->_nodeMap.end())
+		std::lock_guard<std::mutex> lck(_mutexForNodes);
+		auto table = GetPeerTable();
+		if (table->byAddress.find(node.address) == table->byAddress.end())
 		{
 			return false;
 		}
-		this->_nodeMap[node.address] = node;
+		auto byAddress = table->byAddress;
+		byAddress[node.address] = std::make_shared<const Node>(node);
+		_Publish(std::move(byAddress));
 	}
 
 	return true;
@@ -77,8 +112,10 @@ bool PeerNode::Update(const Node & node)
 
 bool PeerNode::AddOrUpdate(Node node)
 {
-	std::unique_lock<std::shared_mutex> lck(_mutexForNodes);
-	this->_nodeMap[node.address] = node;
+	std::lock_guard<std::mutex> lck(_mutexForNodes);
+	auto byAddress = GetPeerTable()->byAddress;
+	byAddress[node.address] = std::make_shared<const Node>(std::move(node));
+	_Publish(std::move(byAddress));
 	
 	return true;
 }
@@ -86,30 +123,33 @@ bool PeerNode::AddOrUpdate(Node node)
 void PeerNode::DeleteNode(std::string Addr)
 {
 	DEBUGLOG("DeleteNode addr:{}", Addr);
-	std::unique_lock<std::shared_mutex> lck(_mutexForNodes);
-	auto nodeIt = _nodeMap.find(Addr);
+	std::lock_guard<std::mutex> lck(_mutexForNodes);
+	auto table = GetPeerTable();
+	const Node * node = table->FindByAddress(Addr);
 	
-	if (nodeIt != _nodeMap.end())
+	if (node != nullptr)
 	{
-		int fd = nodeIt->second.fd;
+		int fd = node->fd;
 		if(fd > 0)
 		{
 			MagicSingleton<EpollMode>::GetInstance()->DeleteEpollEvent(fd);
 			close(fd);
 		}	
-		u32 ip = nodeIt->second.publicIp;
-		u16 port = nodeIt->second.publicPort;
+		u32 ip = node->publicIp;
+		u16 port = node->publicPort;
 		if(!MagicSingleton<BufferCrol>::GetInstance()->DeleteBuffer(ip, port))
 		{
 			ERRORLOG(RED "DeleteBuffer ERROR ip:({}), port:({}) " RESET, IpPort::IpSz(ip), port);
 		}
 
-		MagicSingleton<UnregisterNode>::GetInstance()->DeleteSpiltNodeList(nodeIt->first);			
-		nodeIt = _nodeMap.erase(nodeIt);
+		MagicSingleton<UnregisterNode>::GetInstance()->DeleteSpiltNodeList(Addr);
+		auto byAddress = table->byAddress;
+		byAddress.erase(Addr);
+		_Publish(std::move(byAddress));
 	}
 	else
 	{
-		DEBUGLOG("Not found  {} in _nodeMap", Addr);
+		DEBUGLOG("Not found  {} in node table", Addr);
 	}
 }
 
@@ -133,34 +173,29 @@ void PeerNode::CloseFd(int fd)
 void PeerNode::DeleteByFd(int fd)
 {
 	DEBUGLOG("DeleteNode ip:{}", IpPort::IpSz(IpPort::GetPeerNip(fd)));
-	std::unique_lock<std::shared_mutex> lck(_mutexForNodes);
-	auto nodeIt = _nodeMap.begin();
-	for(; nodeIt != _nodeMap.end(); ++nodeIt)
-	{
-        if(nodeIt->second.fd == fd)
-		{
-			break;
-		}	
-    }
-
-	u32 ip = nodeIt->second.publicIp;
-	u16 port = nodeIt->second.publicPort;
+	std::lock_guard<std::mutex> lck(_mutexForNodes);
+	auto table = GetPeerTable();
+	const Node * node = table->FindByFd(fd);
 
-	if (nodeIt != _nodeMap.end())
+	if (node != nullptr)
 	{
+		u32 ip = node->publicIp;
+		u16 port = node->publicPort;
 		if(!MagicSingleton<BufferCrol>::GetInstance()->DeleteBuffer(ip, port))
 		{
 			ERRORLOG(RED "DeleteBuffer ERROR ip:({}), port:({})" RESET, IpPort::IpSz(ip), port);
 		}
 
-		MagicSingleton<UnregisterNode>::GetInstance()->DeleteSpiltNodeList(nodeIt->first);		
-		nodeIt = _nodeMap.erase(nodeIt);
+		MagicSingleton<UnregisterNode>::GetInstance()->DeleteSpiltNodeList(node->address);		
+		auto byAddress = table->byAddress;
+		byAddress.erase(node->address);
+		_Publish(std::move(byAddress));
 	}
 	else
 	{
 		if(!MagicSingleton<BufferCrol>::GetInstance()->DeleteBuffer(fd))
 		{
-			ERRORLOG(RED "DeleteBuffer ERROR ip:({}), port:({})" RESET, IpPort::IpSz(ip), port);
+			ERRORLOG(RED "DeleteBuffer ERROR fd:({})" RESET, fd);
 		}
 	}
 
@@ -219,29 +254,28 @@ std::string PeerNode::NodelistInfo(std::vector<Node> & nodeList)
 
 bool PeerNode::FindNodeByFd(int fd, Node &node)
 {
-	std::shared_lock<std::shared_mutex> lck(_mutexForNodes);
-	for (auto x : _nodeMap)
+	auto table = GetPeerTable();
+	const Node * found = table->FindByFd(fd);
+	if (found == nullptr)
 	{
-		if (x.second.fd == fd)
-		{
-			node = x.second;
-			return true;
-		}
+		return false;
 	}
-	return false;
+	node = *found;
+	return true;
 }
 
 bool PeerNode::PeerNodeVerifyNodeId(const int fd, const std::string &peerId)
 {
-	Node node;
-    if(!MagicSingleton<PeerNode>::GetInstance()->FindNodeByFd(fd, node))
+	auto table = MagicSingleton<PeerNode>::GetInstance()->GetPeerTable();
+	const Node * node = table->FindByFd(fd);
+    if(node == nullptr)
     {
-        ERRORLOG("Invalid message peerNode_id:{}, node.address:{}", peerId, node.address);
+        ERRORLOG("Invalid message peerNode_id:{}, fd:{} not found", peerId, fd);
         return false;
     }
-    if(peerId != node.address)
+    if(peerId != node->address)
     {
-        ERRORLOG("Invalid message peerNode_id:{}, node.address:{}", peerId, node.address);
+        ERRORLOG("Invalid message peerNode_id:{}, node.address:{}", peerId, node->address);
         return false;
     }
 	return true;
@@ -250,57 +284,61 @@ bool PeerNode::PeerNodeVerifyNodeId(const int fd, const std::string &peerId)
 // find node
 bool PeerNode::FindNode(std::string const &Addr, Node &x)
 {
-	std::shared_lock<std::shared_mutex> lck(_mutexForNodes);
-
-	std::string strId = Addr;
-	auto it = _nodeMap.find(strId);
-	if (it != _nodeMap.end())
+	auto table = GetPeerTable();
+	const Node * found = table->FindByAddress(Addr);
+	if (found == nullptr)
 	{
-		x = it->second;
-		return true;
+		return false;
 	}
-	return false;
+	x = *found;
+	return true;
 }
 
 std::vector<Node> PeerNode::GetNodelist(NodeType type, bool mustAlive)
 {
-	std::shared_lock<std::shared_mutex> lck(_mutexForNodes);
+	auto table = GetPeerTable();
 	std::vector<Node> rst;
-	auto cb = _nodeMap.cbegin(), ce = _nodeMap.cend();
-	for (; cb != ce; ++cb)
+	if(type != NODE_ALL && type != NODE_PUBLIC)
+	{
+		return rst;
+	}
+	if(mustAlive)
+	{
+		rst.reserve(table->connected.size());
+		for (auto & node : table->connected)
+		{
+			rst.push_back(*node);
+		}
+	}
+	else
 	{
-		if(type == NODE_ALL || (type == NODE_PUBLIC))
+		rst.reserve(table->byAddress.size());
+		for (auto & [addr, node] : table->byAddress)
 		{
-			if(mustAlive)
-			{
-				if(cb->second.IsConnected())
-				{
-					rst.push_back(cb->second);
-				}
-			}else{
-				rst.push_back(cb->second);
-			}
+			rst.push_back(*node);
 		}
 	}
 	return rst;
 }
 void PeerNode::GetNodelist(std::map<std::string, bool>& nodeAddrs, NodeType type, bool mustAlive)
 {
-	std::shared_lock<std::shared_mutex> lck(_mutexForNodes);
-	auto cb = _nodeMap.cbegin(), ce = _nodeMap.cend();
-	for (; cb != ce; ++cb)
+	auto table = GetPeerTable();
+	if(type != NODE_ALL && type != NODE_PUBLIC)
+	{
+		return;
+	}
+	if(mustAlive)
+	{
+		for (auto & node : table->connected)
+		{
+			nodeAddrs[node->address] = false;
+		}
+	}
+	else
 	{
-		if(type == NODE_ALL || (type == NODE_PUBLIC))
+		for (auto & [addr, node] : table->byAddress)
 		{
-			if(mustAlive)
-			{
-				if(cb->second.IsConnected())
-				{
-					nodeAddrs[cb->first] = false;
-				}
-			}else{
-				nodeAddrs[cb->first] = false;
-			}
+			nodeAddrs[addr] = false;
 		}
 	}
 	return;
@@ -308,8 +346,7 @@ void PeerNode::GetNodelist(std::map<std::string, bool>& nodeAddrs, NodeType type
 
 uint64_t PeerNode::GetNodelistSize()
 {
-	std::shared_lock<std::shared_mutex> lck(_mutexForNodes);
-	return _nodeMap.size();
+	return GetPeerTable()->byAddress.size();
 }
 
 // Refresh threads
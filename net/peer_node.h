@@ -14,8 +14,10 @@
 #include <cstdint>
 #include <map>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <vector>
+#include <unordered_map>
 #include <string>
 #include <thread>
 #include <vector>
@@ -33,6 +35,24 @@ enum NodeType
 	NODE_PUBLIC
 };
 
+/**
+ * @brief       Immutable view of the node list. A change builds a new table that
+ *              shares the unchanged nodes and replaces the published one as a whole,
+ *              readers keep using the table they loaded without any lock
+ */
+struct PeerTable
+{
+	using NodePtr = std::shared_ptr<const Node>;
+
+	std::map<std::string, NodePtr> byAddress;
+	std::unordered_map<int32_t, NodePtr> byFd;
+	std::vector<NodePtr> connected;		// ordered by address
+
+	const Node * FindByAddress(const std::string &address) const;
+	const Node * FindByFd(int32_t fd) const;
+};
+using PeerTablePtr = std::shared_ptr<const PeerTable>;
+
 
 class PeerNode
 {
@@ -71,6 +91,13 @@ public:
 	 */
 	static bool PeerNodeVerifyNodeId(const int fd, const std::string &peerId);
 	
+	/**
+	 * @brief       Get the current node table, cheap and never blocks on writers
+	 * 
+	 * @return      PeerTablePtr 
+	 */
+	PeerTablePtr GetPeerTable() const { return std::atomic_load_explicit(&_table, std::memory_order_acquire); }
+
 	/**
 	 * @brief       Get the Nodelist object
 	 * 
@@ -358,10 +385,18 @@ public:
 
 	
 private:
+	/**
+	 * @brief       Build the indexes of a new node map and publish it
+	 * 
+	 * @param       byAddress 
+	 */
+	void _Publish(std::map<std::string, PeerTable::NodePtr> &&byAddress);
+
     friend std::string PrintCache(int where);
-	//List of public network nodes
-	std::shared_mutex _mutexForNodes;
-	std::map<std::string, Node> _nodeMap;
+	//List of public network nodes, _mutexForNodes only serializes writers
+	std::mutex _mutexForNodes;
+	// Only accessed through std::atomic_load/std::atomic_store, std::atomic<std::shared_ptr> needs gcc 12
+	PeerTablePtr _table = std::make_shared<const PeerTable>();
 
 	std::mutex _mutexForCurr;
 	Node _currNode;
@@ -4,6 +4,7 @@
 #include <evmc/hex.hpp>
 #include <evmone/evmone.h>
 #include "db/db_api.h"
+#include "utils/magic_singleton.h"
 #include "../utils/keccak_cryopp.hpp"
 evmc_address evm_utils::StringToEvmAddr(const std::string& addr)
 {
@@ -91,51 +92,115 @@ uint32_t evm_utils::EvmcUint256beToUint32(evmc_uint256be value)
 
 int evm_utils::GetContractCode(const std::string& contractAddress, bytes& code)
 {
+    ContractCodePtr cached;
+    int ret = GetContractCode(contractAddress, cached);
+    if (ret != 0)
+    {
+        return ret;
+    }
+    code = cached->code;
+    return 0;
+}
+
+evm_utils::ContractCodePtr evm_utils::MakeContractCode(const bytes& code)
+{
+    auto contractCode = std::make_shared<ContractCode>();
+    contractCode->code = code;
+    contractCode->hash = {};
+    std::string hash = Keccak256Crypt(std::string(reinterpret_cast<const char*>(code.data()), code.size()));
+    auto by = evmc::from_hex(hash);
+    if (by.has_value())
+    {
+        memcpy(contractCode->hash.bytes, by->data(), std::min(by->size(), sizeof(contractCode->hash.bytes)));
+    }
+    return contractCode;
+}
+
+int evm_utils::GetContractCode(const std::string& contractAddress, ContractCodePtr& code)
+{
+    return MagicSingleton<ContractCodeCache>::GetInstance()->Get(contractAddress, code);
+}
+
+int evm_utils::ContractCodeCache::Get(const std::string& contractAddress, ContractCodePtr& code)
+{
+    // Code read inside a DBReadThrough scope may be rolled back, and a cached entry may be stale there
+    bool cached = !DBReadThrough::IsActive();
+    uint64_t generation = 0;
+    if (cached)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _index.find(contractAddress);
+        if (found != _index.end())
+        {
+            _lru.splice(_lru.begin(), _lru, found->second);
+            code = found->second->second;
+            return 0;
+        }
+        generation = _generation;
+    }
+
     DBReader dbReader;
     std::string strCode;
-    if(dbReader.GetContractCodeByContractAddr(contractAddress, strCode) != DB_SUCCESS)
+    if(dbReader.GetContractCodeBytesByContractAddr(contractAddress, strCode) != DB_SUCCESS)
     {
         ERRORLOG("can't get deploy hash of contract {}", contractAddress)
         return 1;
     }
-
-    code = StringTobytes(strCode);
-    if (code.empty())
+    if (strCode.empty())
     {
         ERRORLOG("fail to convert contract code to hex format");
         return -4;
     }
-//    std::string txRaw;
-//    if(dbReader.GetTransactionByHash(deployHash, txRaw) != DB_SUCCESS)
-//    {
-//        ERRORLOG("can't get contract belonged transaction {} string", deployHash);
-//        return -1;
-//    }
-//
-//    CTransaction transaction;
-//    if(!transaction.ParseFromString(txRaw))
-//    {
-//        ERRORLOG("contract belonged transaction parse failed!");
-//        return -2;
-//    }
-//
-//    try
-//    {
-//        nlohmann::json dataJson = nlohmann::json::parse(transaction.data());
-//        const auto& txInfo = dataJson["TxInfo"].get<nlohmann::json>();
-//        const auto& strCode = txInfo["Output"].get<std::string>();
-//        if(strCode.empty())
-//        {
-//            ERRORLOG("contract belonged transaction doesn't hold contract code");
-//            return -3;
-//        }
-//
-//    }
-//    catch(const std::exception& e)
-//    {
-//        ERRORLOG("can't parse deploy contract transaction");
-//        return -5;
-//    }
 
+    code = MakeContractCode(bytes(strCode.begin(), strCode.end()));
+    if (cached)
+    {
+        _Add(contractAddress, code, generation);
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+void evm_utils::ContractCodeCache::_Add(const std::string& contractAddress, const ContractCodePtr& code, uint64_t generation)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (generation != _generation || _index.count(contractAddress) != 0 || code->code.size() > kMaxBytes)
+    {
+        return;
+    }
+    _lru.emplace_front(contractAddress, code);
+    _index[contractAddress] = _lru.begin();
+    _bytes += code->code.size();
+    while (_bytes > kMaxBytes)
+    {
+        auto& last = _lru.back();
+        _bytes -= last.second->code.size();
+        _index.erase(last.first);
+        _lru.pop_back();
+    }
+}
+
+void evm_utils::ContractCodeCache::Invalidate(const std::string& contractAddress)
+{
+    Invalidate(std::set<std::string>{contractAddress});
+}
+
+void evm_utils::ContractCodeCache::Invalidate(const std::set<std::string>& contractAddresses)
+{
+    if (contractAddresses.empty())
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_generation;
+    for (const auto& contractAddress : contractAddresses)
+    {
+        auto found = _index.find(contractAddress);
+        if (found == _index.end())
+        {
+            continue;
+        }
+        _bytes -= found->second->second->code.size();
+        _lru.erase(found->second);
+        _index.erase(found);
+    }
+}
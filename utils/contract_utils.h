@@ -13,6 +13,11 @@
 #include <future>
 #include <chrono>
 #include <ostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
 #include <evmc/hex.hpp>
 #include <evmone/evmone.h>
 
@@ -94,6 +99,78 @@ namespace evm_utils
     std::string BytesToString(const bytes& content);
 
     int GetContractCode(const std::string& contractAddress, bytes& code);
+
+    /**
+     * @brief       Runtime code of a contract together with its keccak256 hash
+     */
+    struct ContractCode
+    {
+        bytes code;
+        bytes32 hash;
+    };
+    using ContractCodePtr = std::shared_ptr<const ContractCode>;
+
+    /**
+     * @brief       
+     * 
+     * @param       code: 
+     * @return      ContractCodePtr 
+     */
+    ContractCodePtr MakeContractCode(const bytes& code);
+
+    /**
+     * @brief       Same as above but shares the code through ContractCodeCache instead of copying it
+     * 
+     * @param       contractAddress: 
+     * @param       code: 
+     * @return      int 0 success, 1 contract not found, < 0 error
+     */
+    int GetContractCode(const std::string& contractAddress, ContractCodePtr& code);
+
+    /**
+     * @brief       Deployed contract code shared by every EvmHost, bounded by total code size.
+     *              Entries are immutable, DBReadWriter drops the ones its committed
+     *              transactions change.
+     */
+    class ContractCodeCache
+    {
+    public:
+        /**
+         * @brief       Get the code from the cache or load it from the database
+         * 
+         * @param       contractAddress: 
+         * @param       code: 
+         * @return      int 0 success, 1 contract not found, < 0 error
+         */
+        int Get(const std::string& contractAddress, ContractCodePtr& code);
+
+        /**
+         * @brief       
+         * 
+         * @param       contractAddress: 
+         */
+        void Invalidate(const std::string& contractAddress);
+
+        /**
+         * @brief       
+         * 
+         * @param       contractAddresses: 
+         */
+        void Invalidate(const std::set<std::string>& contractAddresses);
+
+        static const size_t kMaxBytes = 64 * 1024 * 1024;
+
+    private:
+        void _Add(const std::string& contractAddress, const ContractCodePtr& code, uint64_t generation);
+
+        std::mutex _mutex;
+        // Bumped by every invalidation, a load that raced with one is not cached
+        uint64_t _generation = 0;
+        size_t _bytes = 0;
+        // Most recently used first
+        std::list<std::pair<std::string, ContractCodePtr>> _lru;
+        std::unordered_map<std::string, std::list<std::pair<std::string, ContractCodePtr>>::iterator> _index;
+    };
 }
 
 
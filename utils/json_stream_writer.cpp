@@ -0,0 +1,196 @@
+#include "./json_stream_writer.h"
+
+#include <charconv>
+
+
+JsonStreamWriter &JsonStreamWriter::BeginObject()
+{
+    _BeforeValue();
+    _buffer.push_back('{');
+    _hasElement.push_back(false);
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::EndObject()
+{
+    _buffer.push_back('}');
+    _hasElement.pop_back();
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::BeginArray()
+{
+    _BeforeValue();
+    _buffer.push_back('[');
+    _hasElement.push_back(false);
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::EndArray()
+{
+    _buffer.push_back(']');
+    _hasElement.pop_back();
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::Key(std::string_view key)
+{
+    _BeforeValue();
+    _buffer.push_back('"');
+    Escape(key, _buffer);
+    _buffer.append("\":");
+    _afterKey = true;
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::String(std::string_view value)
+{
+    _BeforeValue();
+    _buffer.push_back('"');
+    Escape(value, _buffer);
+    _buffer.push_back('"');
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::Int(int64_t value)
+{
+    _BeforeValue();
+    char buf[24];
+    auto ret = std::to_chars(buf, buf + sizeof(buf), value);
+    _buffer.append(buf, ret.ptr - buf);
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::Uint(uint64_t value)
+{
+    _BeforeValue();
+    char buf[24];
+    auto ret = std::to_chars(buf, buf + sizeof(buf), value);
+    _buffer.append(buf, ret.ptr - buf);
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::Bool(bool value)
+{
+    _BeforeValue();
+    _buffer.append(value ? "true" : "false");
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::Null()
+{
+    _BeforeValue();
+    _buffer.append("null");
+    return *this;
+}
+
+JsonStreamWriter &JsonStreamWriter::Raw(std::string_view json)
+{
+    _BeforeValue();
+    _buffer.append(json);
+    return *this;
+}
+
+std::string JsonStreamWriter::Take()
+{
+    std::string out;
+    out.swap(_buffer);
+    return out;
+}
+
+namespace
+{
+    // Length of the well-formed UTF-8 sequence starting at value[pos], 0 if it is not one
+    size_t Utf8SequenceLength(std::string_view value, size_t pos)
+    {
+        auto byte = [&](size_t i) { return static_cast<unsigned char>(value[pos + i]); };
+        auto inRange = [&](size_t i, unsigned char lo, unsigned char hi) {
+            return pos + i < value.size() && byte(i) >= lo && byte(i) <= hi;
+        };
+
+        unsigned char c = byte(0);
+        if (c < 0x80)
+        {
+            return 1;
+        }
+        if (c >= 0xc2 && c <= 0xdf)
+        {
+            return inRange(1, 0x80, 0xbf) ? 2 : 0;
+        }
+        if (c >= 0xe0 && c <= 0xef)
+        {
+            unsigned char lo = c == 0xe0 ? 0xa0 : 0x80;
+            unsigned char hi = c == 0xed ? 0x9f : 0xbf;
+            return inRange(1, lo, hi) && inRange(2, 0x80, 0xbf) ? 3 : 0;
+        }
+        if (c >= 0xf0 && c <= 0xf4)
+        {
+            unsigned char lo = c == 0xf0 ? 0x90 : 0x80;
+            unsigned char hi = c == 0xf4 ? 0x8f : 0xbf;
+            return inRange(1, lo, hi) && inRange(2, 0x80, 0xbf) && inRange(3, 0x80, 0xbf) ? 4 : 0;
+        }
+        return 0;
+    }
+}
+
+void JsonStreamWriter::Escape(std::string_view value, std::string &out)
+{
+    static const char *kHex = "0123456789abcdef";
+    for (size_t pos = 0; pos < value.size();)
+    {
+        unsigned char c = static_cast<unsigned char>(value[pos]);
+        switch (c)
+        {
+        case '"':  out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\b': out.append("\\b"); break;
+        case '\f': out.append("\\f"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (c < 0x20)
+            {
+                out.append("\\u00");
+                out.push_back(kHex[c >> 4]);
+                out.push_back(kHex[c & 0x0f]);
+            }
+            else if (c < 0x80)
+            {
+                out.push_back(static_cast<char>(c));
+            }
+            else if (auto len = Utf8SequenceLength(value, pos); len != 0)
+            {
+                out.append(value.substr(pos, len));
+                pos += len;
+                continue;
+            }
+            else
+            {
+                // The document must stay valid JSON once streaming has begun, so instead of
+                // failing like nlohmann::json::dump() each invalid byte becomes U+FFFD
+                out.append("\\ufffd");
+            }
+            break;
+        }
+        ++pos;
+    }
+}
+
+void JsonStreamWriter::_BeforeValue()
+{
+    if (_afterKey)
+    {
+        _afterKey = false;
+        return;
+    }
+    if (_hasElement.empty())
+    {
+        return;
+    }
+    if (_hasElement.back())
+    {
+        _buffer.push_back(',');
+    }
+    _hasElement.back() = true;
+}
@@ -0,0 +1,71 @@
+/**
+ * *****************************************************************************
+ * @file        json_stream_writer.h
+ * @brief       Append-only JSON writer that emits text without building a DOM
+ * @date        2024-06-12
+ * @copyright   tfsc
+ * *****************************************************************************
+ */
+#ifndef _JSON_STREAM_WRITER_H_
+#define _JSON_STREAM_WRITER_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+class JsonStreamWriter
+{
+public:
+    JsonStreamWriter() = default;
+    ~JsonStreamWriter() = default;
+
+    JsonStreamWriter &BeginObject();
+    JsonStreamWriter &EndObject();
+    JsonStreamWriter &BeginArray();
+    JsonStreamWriter &EndArray();
+
+    /**
+     * @brief       Write an object key, the next value call is its value
+     *
+     * @param       key:
+     */
+    JsonStreamWriter &Key(std::string_view key);
+
+    JsonStreamWriter &String(std::string_view value);
+    JsonStreamWriter &Int(int64_t value);
+    JsonStreamWriter &Uint(uint64_t value);
+    JsonStreamWriter &Bool(bool value);
+    JsonStreamWriter &Null();
+
+    /**
+     * @brief       Write an already serialized JSON value as is
+     *
+     * @param       json:
+     */
+    JsonStreamWriter &Raw(std::string_view json);
+
+    /**
+     * @brief       Bytes written since construction or the last Clear()
+     */
+    const std::string &Buffer() const { return _buffer; }
+
+    /**
+     * @brief       Move the written bytes out, nesting state is kept so that
+     *              writing can continue with the next piece of the document
+     */
+    std::string Take();
+    void Clear() { _buffer.clear(); }
+    void Reserve(size_t size) { _buffer.reserve(size); }
+
+    static void Escape(std::string_view value, std::string &out);
+
+private:
+    void _BeforeValue();
+
+    std::string _buffer;
+    std::vector<bool> _hasElement;
+    bool _afterKey = false;
+};
+
+#endif
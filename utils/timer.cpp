@@ -1,5 +1,5 @@
 #include "timer.hpp"
-#include <future>
+#include "magic_singleton.h"
 
 CTimer::CTimer(const std::string sTimerName):m_bExpired(true), m_bTryExpired(false), m_bLoop(false)
 {
@@ -19,31 +19,17 @@ bool CTimer::Start(unsigned int msTime, std::function<void()> task, bool bLoop,
     m_nCount = 0;
 
     if (async) {
-        DeleteThread();
-        m_Thread.reset(new std::thread([this, msTime, task]() {
-            if (!m_sName.empty()) {
-#if (defined(__ANDROID__) || defined(ANDROID))      //Android Compatible with Android
-                pthread_setname_np(pthread_self(), m_sName.c_str());
-#elif defined(__APPLE__)                            //Compatible with Apple systems
-                pthread_setname_np(m_sName.c_str());    // Sets the thread (timer) name
-#endif
-            }
-            
-            while (!m_bTryExpired) {
-                m_ThreadCon.wait_for(m_ThreadLock, std::chrono::milliseconds(msTime));  //dormancy
-                if (!m_bTryExpired) {
-                    task();     //Perform tasks
-
-                    m_nCount ++;
-                    if (!m_bLoop) {
-                        break;
-                    }
-                }
+        std::lock_guard<std::mutex> lock(m_TimerLock);
+        if (!m_Wheel) {
+            m_Wheel = MagicSingleton<TimerWheel>::GetInstance();
+        }
+        m_Timer = m_Wheel->Schedule(msTime, bLoop ? msTime : 0, [this, task]() {
+            task();     //Perform tasks
+            m_nCount ++;
+            if (!m_bLoop) {
+                m_bExpired = true;      // Task execution completed (indicates that an existing task has expired)
             }
-            
-            m_bExpired = true;      // Task execution completed (indicates that an existing task has expired)
-            m_bTryExpired = false;  // In order to load the task again next time
-        }));
+        }, m_sName);
     } else {
         std::this_thread::sleep_for(std::chrono::milliseconds(msTime));
         if (!m_bTryExpired) {
@@ -58,28 +44,21 @@ bool CTimer::Start(unsigned int msTime, std::function<void()> task, bool bLoop,
 
 void CTimer::Cancel()
 {
-    if (m_bExpired || m_bTryExpired || !m_Thread) {
+    if (m_bExpired || m_bTryExpired) {
         return;
     }
-    
-    m_bTryExpired = true;
-    m_ThreadCon.notify_all();     
-    if (m_Thread->joinable()) {
-        m_Thread->join();
-    }
-    else
+
+    TimerWheel::TimerPtr timer;
     {
-        m_Thread->detach();
+        std::lock_guard<std::mutex> lock(m_TimerLock);
+        timer = std::move(m_Timer);
     }
-
-}
-
-void CTimer::DeleteThread()
-{
-    if (m_Thread) {
-        m_ThreadCon.notify_all();   //Wake from sleep
-        m_Thread->join();           //Wait for the thread to exit
-        m_Thread.reset();        
+    if (!timer) {
+        return;
     }
+    
+    m_bTryExpired = true;
+    m_Wheel->Cancel(timer);   //Waits for a running task unless called from it
+    m_bExpired = true;
+    m_bTryExpired = false;  // In order to load the task again next time
 }
-
@@ -10,6 +10,11 @@
 #include <string>
 #include <condition_variable>
 
+#include "timer_wheel.h"
+
+/**
+ * Asynchronous tasks run on the shared TimerWheel rather than on a thread of their own
+ */
 class CTimer
 {
 public:
@@ -93,9 +98,6 @@ public:
     }
     
     
-private:
-    void DeleteThread();    //Delete a task thread
-
 public:
     int m_nCount = 0;   //Number of cycles
     
@@ -106,9 +108,9 @@ private:
     std::atomic_bool m_bTryExpired;    //Equipment expires loaded tasks (markers)
     std::atomic_bool m_bLoop;          //Whether to loop or not
     
-    std::unique_ptr<std::thread> m_Thread;
-    std::mutex m_ThreadLock;
-    std::condition_variable_any m_ThreadCon;
+    std::shared_ptr<TimerWheel> m_Wheel;       //Held so that the wheel outlives every started timer
+    TimerWheel::TimerPtr m_Timer;              //Cancellation token of the scheduled task
+    std::mutex m_TimerLock;
 };
 
 #endif /* CTimer_hpp */
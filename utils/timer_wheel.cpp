@@ -0,0 +1,260 @@
+#include "utils/timer_wheel.h"
+
+#include <chrono>
+#include <algorithm>
+
+#include "include/logging.h"
+
+TimerWheel::TimerWheel()
+{
+    _slots[0].resize(1u << kRootBits);
+    for (uint32_t level = 1; level < kLevels; ++level)
+    {
+        _slots[level].resize(1u << kLevelBits);
+    }
+    _startMs = _NowMs();
+
+    for (uint32_t i = 0; i < kMinWorkers; ++i)
+    {
+        _workers.emplace_back(&TimerWheel::_ExecutorWork, this);
+    }
+    _tickThread = std::thread(&TimerWheel::_TickWork, this);
+}
+
+TimerWheel::~TimerWheel()
+{
+    {
+        std::unique_lock<std::mutex> lck(_mutex);
+        _stop = true;
+    }
+    _cvReady.notify_all();
+    _cvDone.notify_all();
+
+    if (_tickThread.joinable())
+    {
+        _tickThread.join();
+    }
+    for (auto &worker : _workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+}
+
+TimerWheel::TimerPtr TimerWheel::Schedule(uint32_t delayMs, uint32_t intervalMs, std::function<void()> task, const std::string &name)
+{
+    auto timer = std::make_shared<Timer>();
+    timer->_name = name;
+    timer->_task = std::move(task);
+    timer->_intervalMs = intervalMs;
+
+    std::unique_lock<std::mutex> lck(_mutex);
+    if (_stop)
+    {
+        timer->_finished = true;
+        return timer;
+    }
+    timer->_dueMs = _NowMs() + delayMs;
+    _Insert(timer);
+    ++_pending;
+    return timer;
+}
+
+void TimerWheel::Cancel(const TimerPtr &timer)
+{
+    if (timer == nullptr)
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lck(_mutex);
+    timer->_cancelled = true;
+    if (timer->_running && timer->_runningThread != std::this_thread::get_id())
+    {
+        _cvDone.wait(lck, [&timer]() { return !timer->_running; });
+    }
+    // A cancelled timer left in a slot is dropped when its slot expires
+    timer->_finished = true;
+}
+
+TimerWheel::Stats TimerWheel::GetStats()
+{
+    std::unique_lock<std::mutex> lck(_mutex);
+    Stats stats;
+    stats.fired = _fired;
+    stats.totalDriftMs = _totalDriftMs;
+    stats.maxDriftMs = _maxDriftMs;
+    stats.pending = _pending;
+    stats.workers = _workers.size();
+    return stats;
+}
+
+uint64_t TimerWheel::_NowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TimerWheel::_Insert(const TimerPtr &timer)
+{
+    // Round up so that a task never runs before it is due
+    uint64_t expireTick = (timer->_dueMs - _startMs + kTickMs - 1) / kTickMs;
+    expireTick = std::max(expireTick, _currentTick);
+    timer->_expireTick = expireTick;
+
+    uint64_t delta = expireTick - _currentTick;
+    if (delta < (1ull << kRootBits))
+    {
+        _slots[0][expireTick & ((1u << kRootBits) - 1)].push_back(timer);
+        return;
+    }
+
+    uint32_t level = 1;
+    while (level < kLevels - 1 && delta >= (1ull << (kRootBits + level * kLevelBits)))
+    {
+        ++level;
+    }
+    uint32_t shift = kRootBits + (level - 1) * kLevelBits;
+    if (delta >= (1ull << (kRootBits + (kLevels - 1) * kLevelBits)))
+    {
+        // Beyond the outermost level, park it in the farthest slot and let cascading bring it closer
+        expireTick = _currentTick + (1ull << (shift + kLevelBits)) - 1;
+    }
+    _slots[level][(expireTick >> shift) & ((1u << kLevelBits) - 1)].push_back(timer);
+}
+
+void TimerWheel::_Cascade(uint32_t level)
+{
+    uint32_t shift = kRootBits + (level - 1) * kLevelBits;
+    auto slot = std::move(_slots[level][(_currentTick >> shift) & ((1u << kLevelBits) - 1)]);
+    _slots[level][(_currentTick >> shift) & ((1u << kLevelBits) - 1)].clear();
+    for (auto &timer : slot)
+    {
+        if (timer->_cancelled)
+        {
+            --_pending;
+            continue;
+        }
+        _Insert(timer);
+    }
+}
+
+void TimerWheel::_Expire(std::vector<TimerPtr> &slot)
+{
+    for (auto &timer : slot)
+    {
+        if (timer->_cancelled)
+        {
+            --_pending;
+            continue;
+        }
+        if (timer->_expireTick > _currentTick)
+        {
+            // Parked beyond the outermost level, not due yet
+            _Insert(timer);
+            continue;
+        }
+        _ready.push_back(timer);
+    }
+    slot.clear();
+}
+
+void TimerWheel::_TickWork()
+{
+    std::unique_lock<std::mutex> lck(_mutex);
+    while (!_stop)
+    {
+        // Wake up against the absolute tick schedule so that late wakeups do not accumulate
+        uint64_t nowTick = (_NowMs() - _startMs) / kTickMs;
+        bool expired = false;
+        while (_currentTick <= nowTick)
+        {
+            uint32_t index = _currentTick & ((1u << kRootBits) - 1);
+            for (uint32_t level = 1; level < kLevels && index == 0; ++level)
+            {
+                _Cascade(level);
+                index = (_currentTick >> (kRootBits + (level - 1) * kLevelBits)) & ((1u << kLevelBits) - 1);
+            }
+
+            auto &slot = _slots[0][_currentTick & ((1u << kRootBits) - 1)];
+            expired = expired || !slot.empty();
+            _Expire(slot);
+            ++_currentTick;
+        }
+
+        if (expired && !_ready.empty())
+        {
+            // Long running tasks must not hold back the others, add a worker when none is free
+            if (_idleWorkers < _ready.size() && _workers.size() < kMaxWorkers)
+            {
+                _workers.emplace_back(&TimerWheel::_ExecutorWork, this);
+                DEBUGLOG("timer wheel workers grow to {}", _workers.size());
+            }
+            _cvReady.notify_all();
+        }
+
+        auto wakeup = std::chrono::steady_clock::time_point(std::chrono::milliseconds(_startMs + _currentTick * kTickMs));
+        _cvReady.wait_until(lck, wakeup, [this]() { return _stop; });
+    }
+}
+
+void TimerWheel::_ExecutorWork()
+{
+    std::unique_lock<std::mutex> lck(_mutex);
+    while (true)
+    {
+        ++_idleWorkers;
+        _cvReady.wait(lck, [this]() { return _stop || !_ready.empty(); });
+        --_idleWorkers;
+        if (_stop)
+        {
+            break;
+        }
+
+        TimerPtr timer = std::move(_ready.front());
+        _ready.pop_front();
+        if (timer->_cancelled)
+        {
+            --_pending;
+            continue;
+        }
+
+        uint64_t now = _NowMs();
+        uint64_t drift = now - std::min(now, timer->_dueMs);
+        ++_fired;
+        _totalDriftMs += drift;
+        _maxDriftMs = std::max(_maxDriftMs, drift);
+
+        timer->_running = true;
+        timer->_runningThread = std::this_thread::get_id();
+        lck.unlock();
+        try
+        {
+            timer->_task();
+        }
+        catch (const std::exception &e)
+        {
+            ERRORLOG("timer {} task throws: {}", timer->_name, e.what());
+        }
+        ++timer->_count;
+        lck.lock();
+        timer->_running = false;
+        timer->_runningThread = std::thread::id();
+        _Finish(timer);
+        _cvDone.notify_all();
+    }
+}
+
+void TimerWheel::_Finish(const TimerPtr &timer)
+{
+    if (timer->_intervalMs == 0 || timer->_cancelled || _stop)
+    {
+        timer->_finished = true;
+        --_pending;
+        return;
+    }
+    // Fixed delay after the previous run, like the former thread per timer
+    timer->_dueMs = _NowMs() + timer->_intervalMs;
+    _Insert(timer);
+}
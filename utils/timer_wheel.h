@@ -0,0 +1,128 @@
+/**
+ * *****************************************************************************
+ * @file        timer_wheel.h
+ * @brief       Hierarchical timer wheel that runs the periodic and one-shot tasks
+ *              of every CTimer on a small shared executor
+ * @date        2024-06-18
+ * @copyright   tfsc
+ * *****************************************************************************
+ */
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+class TimerWheel
+{
+public:
+    /**
+     * @brief       Scheduled task, also the cancellation token returned by Schedule
+     */
+    class Timer
+    {
+    public:
+        const std::string &GetName() const { return _name; }
+        uint64_t GetCount() const { return _count; }
+        bool IsFinished() const { return _finished; }
+
+    private:
+        friend class TimerWheel;
+
+        std::string _name;
+        std::function<void()> _task;
+        uint32_t _intervalMs = 0;
+        uint64_t _expireTick = 0;
+        uint64_t _dueMs = 0;
+        std::atomic<uint64_t> _count = 0;
+        std::atomic_bool _cancelled = false;
+        std::atomic_bool _finished = false;
+        bool _running = false;
+        std::thread::id _runningThread;
+    };
+    using TimerPtr = std::shared_ptr<Timer>;
+
+    struct Stats
+    {
+        uint64_t fired = 0;
+        uint64_t totalDriftMs = 0;  // sum of (start of run - due time)
+        uint64_t maxDriftMs = 0;
+        uint64_t pending = 0;       // timers in the wheel or waiting for a worker
+        uint64_t workers = 0;
+    };
+
+    TimerWheel();
+    ~TimerWheel();
+    TimerWheel(TimerWheel &&) = delete;
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(TimerWheel &&) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    /**
+     * @brief       Run task after delayMs, then every intervalMs after the previous run
+     *              finished. A timer never runs concurrently with itself.
+     *
+     * @param       delayMs:
+     * @param       intervalMs: 0 runs the task once
+     * @param       task:
+     * @param       name:
+     * @return      TimerPtr
+     */
+    TimerPtr Schedule(uint32_t delayMs, uint32_t intervalMs, std::function<void()> task, const std::string &name = "");
+
+    /**
+     * @brief       Stop the timer from running again. Unless called from the task
+     *              itself, waits for a run in progress to return.
+     *
+     * @param       timer:
+     */
+    void Cancel(const TimerPtr &timer);
+
+    Stats GetStats();
+
+    static const uint32_t kTickMs = 10;
+    static const uint32_t kMinWorkers = 2;
+    static const uint32_t kMaxWorkers = 32;
+
+private:
+    static const uint32_t kRootBits = 8;
+    static const uint32_t kLevelBits = 6;
+    static const uint32_t kLevels = 4;
+
+    static uint64_t _NowMs();
+    void _TickWork();
+    void _ExecutorWork();
+    void _Insert(const TimerPtr &timer);
+    void _Cascade(uint32_t level);
+    void _Expire(std::vector<TimerPtr> &slot);
+    void _Finish(const TimerPtr &timer);
+
+    std::mutex _mutex;
+    std::condition_variable _cvReady;
+    std::condition_variable _cvDone;
+    bool _stop = false;
+
+    uint64_t _startMs = 0;
+    uint64_t _currentTick = 0;
+    std::vector<std::vector<TimerPtr>> _slots[kLevels];
+    uint64_t _pending = 0;
+
+    std::deque<TimerPtr> _ready;
+    uint32_t _idleWorkers = 0;
+    std::vector<std::thread> _workers;
+    std::thread _tickThread;
+
+    uint64_t _fired = 0;
+    uint64_t _totalDriftMs = 0;
+    uint64_t _maxDriftMs = 0;
+};
+
+#endif